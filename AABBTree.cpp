@@ -0,0 +1,394 @@
+#include "AABBTree.hpp"
+
+static AABB Fatten(const AABB& bounds) {
+    glm::vec3 margin(AABBTree::FatMargin);
+    return AABB{ bounds.min - margin, bounds.max + margin };
+}
+
+int AABBTree::Insert(const AABB& bounds, uint32_t userData) {
+    int leaf = AllocateNode();
+    nodes[leaf].bounds = Fatten(bounds);
+    nodes[leaf].userData = userData;
+
+    InsertLeaf(leaf);
+    leafCount++;
+    return leaf;
+}
+
+void AABBTree::Remove(int proxy) {
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    leafCount--;
+}
+
+bool AABBTree::Update(int proxy, const AABB& bounds) {
+    if (nodes[proxy].bounds.Contains(bounds)) {
+        return false;
+    }
+
+    nodes[proxy].bounds = Fatten(bounds);
+
+    // Grow or shrink the ancestors, stopping where a box comes out unchanged
+    for (int index = nodes[proxy].parent; index != Null; index = nodes[index].parent) {
+        const Node& node = nodes[index];
+        AABB refit = AABB::Union(nodes[node.child1].bounds, nodes[node.child2].bounds);
+        if (refit.min == node.bounds.min && refit.max == node.bounds.max) break;
+        SetBounds(index, refit);
+    }
+    return true;
+}
+
+bool AABBTree::NeedsRebuild() const {
+    return leafCount > 2 && internalArea > RebuildFactor * rebuiltAreaPerLeaf * leafCount;
+}
+
+void AABBTree::Rebuild() {
+    buildLeaves.clear();
+    for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+        if (nodes[i].height == 0) {
+            buildLeaves.push_back(i);
+        }
+        else if (nodes[i].height > 0) {
+            FreeNode(i);
+        }
+    }
+
+    internalArea = 0.0;
+    root = buildLeaves.empty() ? Null : BuildRange(0, buildLeaves.size());
+    if (root != Null) {
+        nodes[root].parent = Null;
+    }
+    rebuiltAreaPerLeaf = leafCount > 0 ? internalArea / leafCount : 0.0;
+}
+
+void AABBTree::Clear() {
+    nodes.clear();
+    root = Null;
+    freeList = Null;
+    leafCount = 0;
+    internalArea = 0.0;
+    rebuiltAreaPerLeaf = 0.0;
+}
+
+float AABBTree::GetCost() const {
+    if (root == Null || nodes[root].IsLeaf()) return 0.0f;
+
+    float rootArea = nodes[root].bounds.SurfaceArea();
+    return rootArea > 0.0f ? static_cast<float>(internalArea / rootArea) : 0.0f;
+}
+
+int AABBTree::AllocateNode() {
+    int index;
+    if (freeList == Null) {
+        index = static_cast<int>(nodes.size());
+        nodes.emplace_back();
+    }
+    else {
+        index = freeList;
+        freeList = nodes[index].parent;
+    }
+
+    nodes[index] = Node();
+    nodes[index].height = 0;
+    return index;
+}
+
+void AABBTree::FreeNode(int index) {
+    if (!nodes[index].IsLeaf()) {
+        internalArea -= nodes[index].bounds.SurfaceArea();
+    }
+
+    nodes[index] = Node();
+    nodes[index].parent = freeList;
+    freeList = index;
+}
+
+void AABBTree::SetBounds(int index, const AABB& bounds) {
+    if (!nodes[index].IsLeaf()) {
+        internalArea += bounds.SurfaceArea() - nodes[index].bounds.SurfaceArea();
+    }
+    nodes[index].bounds = bounds;
+}
+
+void AABBTree::InsertLeaf(int leaf) {
+    if (root == Null) {
+        root = leaf;
+        nodes[root].parent = Null;
+        return;
+    }
+
+    // Walk down towards the sibling that grows the tree's surface area the least
+    AABB leafBounds = nodes[leaf].bounds;
+    int index = root;
+    while (!nodes[index].IsLeaf()) {
+        const Node& node = nodes[index];
+        float area = node.bounds.SurfaceArea();
+        float combinedArea = AABB::Union(node.bounds, leafBounds).SurfaceArea();
+
+        // Pairing the leaf with this node, or the least any descent has to add on the way down
+        float cost = 2.0f * combinedArea;
+        float inheritance = 2.0f * (combinedArea - area);
+
+        auto descentCost = [&](int child) {
+            const Node& childNode = nodes[child];
+            float grown = AABB::Union(childNode.bounds, leafBounds).SurfaceArea();
+            return (childNode.IsLeaf() ? grown : grown - childNode.bounds.SurfaceArea()) + inheritance;
+        };
+
+        float cost1 = descentCost(node.child1);
+        float cost2 = descentCost(node.child2);
+        if (cost < cost1 && cost < cost2) break;
+
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = AllocateNode();
+
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[newParent].height = nodes[sibling].height + 1;
+    SetBounds(newParent, AABB::Union(leafBounds, nodes[sibling].bounds));
+
+    if (oldParent != Null) {
+        if (nodes[oldParent].child1 == sibling) {
+            nodes[oldParent].child1 = newParent;
+        }
+        else {
+            nodes[oldParent].child2 = newParent;
+        }
+    }
+    else {
+        root = newParent;
+    }
+
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    Refit(oldParent);
+}
+
+void AABBTree::RemoveLeaf(int leaf) {
+    if (leaf == root) {
+        root = Null;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent != Null) {
+        if (nodes[grandParent].child1 == parent) {
+            nodes[grandParent].child1 = sibling;
+        }
+        else {
+            nodes[grandParent].child2 = sibling;
+        }
+        nodes[sibling].parent = grandParent;
+        FreeNode(parent);
+        Refit(grandParent);
+    }
+    else {
+        root = sibling;
+        nodes[sibling].parent = Null;
+        FreeNode(parent);
+    }
+    nodes[leaf].parent = Null;
+}
+
+void AABBTree::Refit(int index) {
+    while (index != Null) {
+        index = Balance(index);
+
+        const Node& child1 = nodes[nodes[index].child1];
+        const Node& child2 = nodes[nodes[index].child2];
+        nodes[index].height = 1 + std::max(child1.height, child2.height);
+        SetBounds(index, AABB::Union(child1.bounds, child2.bounds));
+
+        index = nodes[index].parent;
+    }
+}
+
+// Rotates the taller grandchild up when the children of iA differ in height by more than one
+int AABBTree::Balance(int iA) {
+    Node& a = nodes[iA];
+    if (a.IsLeaf() || a.height < 2) return iA;
+
+    int iB = a.child1;
+    int iC = a.child2;
+    Node& b = nodes[iB];
+    Node& c = nodes[iC];
+    int balance = c.height - b.height;
+
+    if (balance > 1) {
+        int iF = c.child1;
+        int iG = c.child2;
+        Node& f = nodes[iF];
+        Node& g = nodes[iG];
+
+        // C takes A's place, A becomes C's first child
+        c.child1 = iA;
+        c.parent = a.parent;
+        a.parent = iC;
+
+        if (c.parent != Null) {
+            if (nodes[c.parent].child1 == iA) {
+                nodes[c.parent].child1 = iC;
+            }
+            else {
+                nodes[c.parent].child2 = iC;
+            }
+        }
+        else {
+            root = iC;
+        }
+
+        // The taller of C's children stays with C, the other moves to A
+        int iKeep = f.height > g.height ? iF : iG;
+        int iMove = f.height > g.height ? iG : iF;
+        c.child2 = iKeep;
+        a.child2 = iMove;
+        nodes[iMove].parent = iA;
+
+        SetBounds(iA, AABB::Union(b.bounds, nodes[iMove].bounds));
+        SetBounds(iC, AABB::Union(a.bounds, nodes[iKeep].bounds));
+        a.height = 1 + std::max(b.height, nodes[iMove].height);
+        c.height = 1 + std::max(a.height, nodes[iKeep].height);
+        return iC;
+    }
+
+    if (balance < -1) {
+        int iD = b.child1;
+        int iE = b.child2;
+        Node& d = nodes[iD];
+        Node& e = nodes[iE];
+
+        // B takes A's place, A becomes B's first child
+        b.child1 = iA;
+        b.parent = a.parent;
+        a.parent = iB;
+
+        if (b.parent != Null) {
+            if (nodes[b.parent].child1 == iA) {
+                nodes[b.parent].child1 = iB;
+            }
+            else {
+                nodes[b.parent].child2 = iB;
+            }
+        }
+        else {
+            root = iB;
+        }
+
+        int iKeep = d.height > e.height ? iD : iE;
+        int iMove = d.height > e.height ? iE : iD;
+        b.child2 = iKeep;
+        a.child1 = iMove;
+        nodes[iMove].parent = iA;
+
+        SetBounds(iA, AABB::Union(c.bounds, nodes[iMove].bounds));
+        SetBounds(iB, AABB::Union(a.bounds, nodes[iKeep].bounds));
+        a.height = 1 + std::max(c.height, nodes[iMove].height);
+        b.height = 1 + std::max(a.height, nodes[iKeep].height);
+        return iB;
+    }
+
+    return iA;
+}
+
+int AABBTree::BuildRange(size_t begin, size_t end) {
+    if (end - begin == 1) {
+        return buildLeaves[begin];
+    }
+
+    AABB centers{ nodes[buildLeaves[begin]].bounds.GetCenter(), nodes[buildLeaves[begin]].bounds.GetCenter() };
+    for (size_t i = begin + 1; i < end; ++i) {
+        glm::vec3 center = nodes[buildLeaves[i]].bounds.GetCenter();
+        centers.min = glm::min(centers.min, center);
+        centers.max = glm::max(centers.max, center);
+    }
+
+    glm::vec3 extent = centers.max - centers.min;
+    int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+
+    auto first = buildLeaves.begin() + begin;
+    auto last = buildLeaves.begin() + end;
+    size_t mid = begin;
+
+    if (extent[axis] > 0.0f) {
+        // Binned SAH: bucket the centers along the widest axis and split where
+        // area * count summed over both sides is smallest
+        constexpr int BinCount = 16;
+        AABB binBounds[BinCount];
+        size_t binCounts[BinCount] = {};
+        float scale = BinCount / extent[axis];
+
+        auto binOf = [&](int leaf) {
+            int bin = static_cast<int>((nodes[leaf].bounds.GetCenter()[axis] - centers.min[axis]) * scale);
+            return std::min(bin, BinCount - 1);
+        };
+
+        for (size_t i = begin; i < end; ++i) {
+            int leaf = buildLeaves[i];
+            int bin = binOf(leaf);
+            binBounds[bin] = binCounts[bin] == 0 ? nodes[leaf].bounds : AABB::Union(binBounds[bin], nodes[leaf].bounds);
+            binCounts[bin]++;
+        }
+
+        float rightCost[BinCount] = {};
+        AABB accumulated;
+        size_t count = 0;
+        for (int bin = BinCount - 1; bin > 0; --bin) {
+            if (binCounts[bin] > 0) {
+                accumulated = count == 0 ? binBounds[bin] : AABB::Union(accumulated, binBounds[bin]);
+                count += binCounts[bin];
+            }
+            rightCost[bin] = count > 0 ? accumulated.SurfaceArea() * count : 0.0f;
+        }
+
+        int bestSplit = -1;
+        float bestCost = 0.0f;
+        count = 0;
+        for (int split = 1; split < BinCount; ++split) {
+            int bin = split - 1;
+            if (binCounts[bin] > 0) {
+                accumulated = count == 0 ? binBounds[bin] : AABB::Union(accumulated, binBounds[bin]);
+                count += binCounts[bin];
+            }
+            if (count == 0 || count == end - begin) continue;
+
+            float cost = accumulated.SurfaceArea() * count + rightCost[split];
+            if (bestSplit < 0 || cost < bestCost) {
+                bestSplit = split;
+                bestCost = cost;
+            }
+        }
+
+        if (bestSplit > 0) {
+            mid = std::partition(first, last, [&](int leaf) { return binOf(leaf) < bestSplit; }) - buildLeaves.begin();
+        }
+    }
+
+    // All centers on one spot or in one bin: split by count instead
+    if (mid == begin || mid == end) {
+        mid = begin + (end - begin) / 2;
+        std::nth_element(first, buildLeaves.begin() + mid, last, [&](int l, int r) {
+            return nodes[l].bounds.GetCenter()[axis] < nodes[r].bounds.GetCenter()[axis];
+        });
+    }
+
+    int child1 = BuildRange(begin, mid);
+    int child2 = BuildRange(mid, end);
+
+    int node = AllocateNode();
+    nodes[node].child1 = child1;
+    nodes[node].child2 = child2;
+    nodes[node].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+    SetBounds(node, AABB::Union(nodes[child1].bounds, nodes[child2].bounds));
+    nodes[child1].parent = node;
+    nodes[child2].parent = node;
+    return node;
+}
\ No newline at end of file
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "Frustum.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+struct AABB {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    static AABB Union(const AABB& a, const AABB& b) {
+        return AABB{ glm::min(a.min, b.min), glm::max(a.max, b.max) };
+    }
+
+    bool Contains(const AABB& other) const {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+
+    bool Overlaps(const AABB& other) const {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+
+    float SurfaceArea() const {
+        glm::vec3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+
+    // Box around this box after transforming it by matrix
+    AABB Transformed(const glm::mat4& matrix) const {
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(GetCenter(), 1.0f));
+        glm::vec3 extent = (max - min) * 0.5f;
+        glm::vec3 worldExtent = glm::abs(glm::vec3(matrix[0])) * extent.x +
+            glm::abs(glm::vec3(matrix[1])) * extent.y +
+            glm::abs(glm::vec3(matrix[2])) * extent.z;
+        return AABB{ center - worldExtent, center + worldExtent };
+    }
+
+    // Slab test. entry is where the ray enters the box, 0 when it starts inside.
+    bool IntersectsRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& entry) const {
+        glm::vec3 t1 = (min - origin) * inverseDirection;
+        glm::vec3 t2 = (max - origin) * inverseDirection;
+        glm::vec3 tMin = glm::min(t1, t2);
+        glm::vec3 tMax = glm::max(t1, t2);
+
+        entry = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+        float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+        return entry <= exit;
+    }
+};
+
+// Dynamic bounding volume hierarchy over boxes that move. Leaves are inserted with the surface area
+// heuristic and kept balanced by rotations, moved leaves are refit in place, and the whole tree is
+// rebuilt top-down with binned SAH once refits have made it noticeably worse than after the last
+// build. Proxies are leaf node indices and stay valid across rebuilds until removed. Queries share
+// one traversal stack, so a callback must not start another query on the same tree.
+class AABBTree {
+public:
+    static constexpr int Null = -1;
+
+    // Leaves are stored grown by this much on every side so small moves need no refit
+    static constexpr float FatMargin = 0.1f;
+
+    int Insert(const AABB& bounds, uint32_t userData);
+    void Remove(int proxy);
+
+    // Refits the leaf and its ancestors unless the stored box still contains bounds. Returns true
+    // when the tree changed.
+    bool Update(int proxy, const AABB& bounds);
+
+    uint32_t GetUserData(int proxy) const { return nodes[proxy].userData; }
+    const AABB& GetFatBounds(int proxy) const { return nodes[proxy].bounds; }
+
+    // True once the summed surface area of the internal nodes per leaf has grown RebuildFactor
+    // times past what the last Rebuild left
+    bool NeedsRebuild() const;
+    void Rebuild();
+
+    void Clear();
+
+    size_t GetProxyCount() const { return leafCount; }
+    int GetHeight() const { return root == Null ? 0 : nodes[root].height; }
+    // Summed surface area of the internal nodes divided by the root's, the expected number of
+    // nodes a random ray or query visits
+    float GetCost() const;
+
+    // function(userData) for every leaf whose box overlaps bounds
+    template <typename Function>
+    void QueryAABB(const AABB& bounds, Function&& function) const {
+        Traverse([&bounds](const AABB& box) { return box.Overlaps(bounds); }, function);
+    }
+
+    // function(userData) for every leaf whose box is within radius of center
+    template <typename Function>
+    void QuerySphere(const glm::vec3& center, float radius, Function&& function) const {
+        float radiusSquared = radius * radius;
+        Traverse([&center, radiusSquared](const AABB& box) {
+            glm::vec3 closest = glm::clamp(center, box.min, box.max);
+            glm::vec3 offset = closest - center;
+            return glm::dot(offset, offset) <= radiusSquared;
+        }, function);
+    }
+
+    // function(userData, inside) for every leaf whose box touches the frustum, inside is true when
+    // the box is entirely in it. Subtrees fully inside are reported without testing their boxes.
+    template <typename Function>
+    void QueryFrustum(const Frustum& frustum, Function&& function) const {
+        if (root == Null) return;
+
+        auto reportInside = [&function](uint32_t userData) { function(userData, true); };
+
+        std::vector<int>& stack = traversalStack;
+        stack.clear();
+        stack.push_back(root);
+
+        while (!stack.empty()) {
+            int index = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[index];
+
+            Frustum::Containment containment = frustum.ClassifyAABB(node.bounds.min, node.bounds.max);
+            if (containment == Frustum::Containment::Outside) continue;
+
+            if (node.IsLeaf()) {
+                function(node.userData, containment == Frustum::Containment::Inside);
+            }
+            else if (containment == Frustum::Containment::Inside) {
+                ForEachLeaf(index, reportInside);
+            }
+            else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+    // function(userData, entryDistance) for every leaf the ray enters within maxDistance, nearer
+    // children first. function returns the distance the search still has to cover, so returning
+    // a hit's distance prunes everything behind it. direction does not need to be normalized,
+    // distances are in multiples of it.
+    template <typename Function>
+    void QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Function&& function) const {
+        if (root == Null) return;
+
+        glm::vec3 inverse = 1.0f / direction;
+
+        std::vector<int>& stack = traversalStack;
+        stack.clear();
+        stack.push_back(root);
+
+        while (!stack.empty()) {
+            int index = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[index];
+
+            float entry;
+            if (!node.bounds.IntersectsRay(origin, inverse, maxDistance, entry)) continue;
+
+            if (node.IsLeaf()) {
+                maxDistance = std::min(maxDistance, function(node.userData, entry));
+                continue;
+            }
+
+            float entry1, entry2;
+            bool hit1 = nodes[node.child1].bounds.IntersectsRay(origin, inverse, maxDistance, entry1);
+            bool hit2 = nodes[node.child2].bounds.IntersectsRay(origin, inverse, maxDistance, entry2);
+
+            // The nearer child goes on top of the stack
+            if (hit1 && hit2 && entry1 < entry2) {
+                stack.push_back(node.child2);
+                stack.push_back(node.child1);
+            }
+            else {
+                if (hit1) stack.push_back(node.child1);
+                if (hit2) stack.push_back(node.child2);
+            }
+        }
+    }
+
+    static constexpr float RebuildFactor = 1.5f;
+
+private:
+    struct Node {
+        AABB bounds;
+        // Next free node while the node is on the free list
+        int parent = Null;
+        int child1 = Null;
+        int child2 = Null;
+        // 0 for leaves, -1 for free nodes
+        int height = -1;
+        uint32_t userData = 0;
+
+        bool IsLeaf() const { return child1 == Null; }
+    };
+
+    std::vector<Node> nodes;
+    int root = Null;
+    int freeList = Null;
+    size_t leafCount = 0;
+
+    // Summed surface area of the internal nodes, kept up to date on every change
+    double internalArea = 0.0;
+    double rebuiltAreaPerLeaf = 0.0;
+
+    mutable std::vector<int> traversalStack;
+    mutable std::vector<int> subtreeStack;
+    std::vector<int> buildLeaves;
+
+    int AllocateNode();
+    void FreeNode(int index);
+    void SetBounds(int index, const AABB& bounds);
+
+    void InsertLeaf(int leaf);
+    void RemoveLeaf(int leaf);
+    // Recomputes bounds and heights from index up to the root, rotating where unbalanced
+    void Refit(int index);
+    int Balance(int index);
+
+    int BuildRange(size_t begin, size_t end);
+
+    template <typename Test, typename Function>
+    void Traverse(Test&& test, Function& function) const {
+        if (root == Null) return;
+
+        std::vector<int>& stack = traversalStack;
+        stack.clear();
+        stack.push_back(root);
+
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if (!test(node.bounds)) continue;
+
+            if (node.IsLeaf()) {
+                function(node.userData);
+            }
+            else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+    // Reports every leaf below index. Uses its own stack since it runs inside other traversals.
+    template <typename Function>
+    void ForEachLeaf(int index, Function& function) const {
+        std::vector<int>& stack = subtreeStack;
+        stack.clear();
+        stack.push_back(index);
+
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+
+            if (node.IsLeaf()) {
+                function(node.userData);
+            }
+            else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+};
\ No newline at end of file
@@ -0,0 +1,526 @@
+#include "AssetLoader.hpp"
+#include "ResourceManager.hpp"
+#include "MeshUtils.hpp"
+#include "MeshCache.hpp"
+#include "MappedFile.hpp"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <tiny_gltf.h>
+#include <json.hpp>
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+AssetLoader::AssetLoader(unsigned int threadCount) {
+    if (threadCount == 0) {
+        // Leave a core for the main thread
+        unsigned int cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 1;
+    }
+
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&AssetLoader::WorkerLoop, this);
+    }
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<ModelJob> AssetLoader::Request(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = jobs.find(path);
+    if (it != jobs.end()) {
+        if (auto job = it->second.lock()) {
+            return job;
+        }
+    }
+
+    // Forget jobs nobody holds any more so the map does not grow with every load
+    for (auto entry = jobs.begin(); entry != jobs.end();) {
+        entry = entry->second.expired() ? jobs.erase(entry) : std::next(entry);
+    }
+
+    auto job = std::make_shared<ModelJob>();
+    job->path = path;
+    jobs[path] = job;
+    queue.push_back(job);
+    wake.notify_one();
+    return job;
+}
+
+void AssetLoader::WorkerLoop() {
+    while (true) {
+        std::shared_ptr<ModelJob> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) return;
+
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        job->success = BuildModel(job->path, job->model);
+        job->done.store(true, std::memory_order_release);
+    }
+}
+
+bool AssetLoader::GetCachedModel(const std::string& path, PrefabHandle& prefab) {
+    // A path that was never interned was never loaded either
+    StringId source = StringTable::Find(path);
+    PrefabHandle cached = source ? ResourceManager::FindPrefab(source) : PrefabHandle();
+    if (!cached.IsValid()) {
+        return false;
+    }
+
+    const Prefab* cachedPrefab = ResourceManager::GetPrefab(cached);
+    std::error_code error;
+    auto writeTime = GetWriteTime(path, cachedPrefab->dependencies, error);
+    if (error || writeTime != cachedPrefab->writeTime) {
+        return false;
+    }
+
+    prefab = cached;
+    return true;
+}
+
+std::vector<std::string> AssetLoader::FindDependencies(const std::string& path, const uint8_t* data, size_t size) {
+    // A .glb keeps its JSON in the first chunk, after the 12 byte header and the chunk's length and type
+    const uint8_t* json = data;
+    size_t jsonSize = size;
+    if (path.ends_with(".glb")) {
+        if (size < 20) return {};
+        uint32_t chunkLength = 0;
+        std::memcpy(&chunkLength, data + 12, sizeof(chunkLength));
+        json = data + 20;
+        jsonSize = std::min<size_t>(chunkLength, size - 20);
+    }
+
+    auto document = nlohmann::json::parse(json, json + jsonSize, nullptr, false);
+    if (document.is_discarded() || !document.is_object()) return {};
+
+    std::vector<std::string> dependencies;
+    std::filesystem::path baseDir = std::filesystem::path(path).parent_path();
+    for (const char* key : { "buffers", "images" }) {
+        auto entries = document.find(key);
+        if (entries == document.end() || !entries->is_array()) continue;
+
+        for (const auto& entry : *entries) {
+            if (!entry.is_object()) continue;
+            auto uri = entry.find("uri");
+            if (uri == entry.end() || !uri->is_string()) continue;
+
+            std::string text = uri->get<std::string>();
+            if (tinygltf::IsDataURI(text)) continue;
+
+            std::string decoded;
+            if (!tinygltf::URIDecode(text, &decoded, nullptr)) decoded = text;
+            dependencies.push_back((baseDir / std::filesystem::u8path(decoded)).string());
+        }
+    }
+    return dependencies;
+}
+
+std::filesystem::file_time_type AssetLoader::GetWriteTime(const std::string& path,
+    const std::vector<std::string>& dependencies, std::error_code& error) {
+    auto writeTime = std::filesystem::last_write_time(path, error);
+    for (const std::string& dependency : dependencies) {
+        // A missing buffer or image fails the check just like a missing model
+        if (error) break;
+        writeTime = std::max(writeTime, std::filesystem::last_write_time(dependency, error));
+    }
+    return writeTime;
+}
+
+bool AssetLoader::BuildModel(const std::string& path, CpuModel& result) {
+    // Taken before reading so an edit made during the load still shows up as a change next time
+    std::error_code error;
+    auto sourceTime = std::filesystem::last_write_time(path, error);
+
+    MappedFile source;
+    if (!source.Open(path)) {
+        std::cerr << "Failed to open model: " << path << std::endl;
+        return false;
+    }
+
+    // External buffers and images are read by the importer, not hashed with the source. Their
+    // size and write time go into the hash instead so editing one of them rebuilds the cache.
+    result.dependencies = FindDependencies(path, source.GetData(), source.GetSize());
+    result.writeTime = sourceTime;
+
+    uint64_t sourceHash = MeshCache::HashContents(source.GetData(), source.GetSize());
+    for (const std::string& dependency : result.dependencies) {
+        uint64_t stamp[2] = { static_cast<uint64_t>(-1), 0 };
+        std::error_code dependencyError;
+        auto dependencySize = std::filesystem::file_size(dependency, dependencyError);
+        if (!dependencyError) stamp[0] = dependencySize;
+        auto dependencyTime = std::filesystem::last_write_time(dependency, dependencyError);
+        if (!dependencyError) {
+            stamp[1] = static_cast<uint64_t>(dependencyTime.time_since_epoch().count());
+            result.writeTime = std::max(result.writeTime, dependencyTime);
+        }
+
+        sourceHash = MeshCache::HashContents(reinterpret_cast<const uint8_t*>(dependency.data()), dependency.size(), sourceHash);
+        sourceHash = MeshCache::HashContents(reinterpret_cast<const uint8_t*>(stamp), sizeof(stamp), sourceHash);
+    }
+
+    if (MeshCache::Load(path, sourceHash, result)) {
+        return true;
+    }
+
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    std::string err, warn;
+    std::string baseDir = std::filesystem::path(path).parent_path().string();
+
+    bool success = path.ends_with(".glb")
+        ? loader.LoadBinaryFromMemory(&model, &err, &warn, source.GetData(),
+            static_cast<unsigned int>(source.GetSize()), baseDir)
+        : loader.LoadASCIIFromString(&model, &err, &warn, reinterpret_cast<const char*>(source.GetData()),
+            static_cast<unsigned int>(source.GetSize()), baseDir);
+    source.Close();
+
+    if (!success) {
+        if (!err.empty()) {
+            std::cerr << "GLTF Error: " << err << std::endl;
+        }
+        return false;
+    }
+
+    result.path = path;
+
+    // Primitives are built once per glTF mesh even when several nodes instance it
+    std::unordered_map<uint64_t, int> builtPrimitives;
+    std::unordered_map<int, int> builtTextures;
+
+    // Roots of the default scene, or every node nobody lists as a child in files without scenes
+    std::vector<int> roots;
+    if (!model.scenes.empty()) {
+        int sceneIndex = (model.defaultScene >= 0 && model.defaultScene < static_cast<int>(model.scenes.size())) ? model.defaultScene : 0;
+        roots = model.scenes[sceneIndex].nodes;
+    }
+    else {
+        std::vector<bool> isChild(model.nodes.size(), false);
+        for (const auto& node : model.nodes) {
+            for (int child : node.children) {
+                if (child >= 0 && child < static_cast<int>(model.nodes.size())) isChild[child] = true;
+            }
+        }
+        for (int i = 0; i < static_cast<int>(model.nodes.size()); ++i) {
+            if (!isChild[i]) roots.push_back(i);
+        }
+    }
+
+    // Depth-first walk so every node's transform is composed with its ancestors'. Broken files
+    // may list a node twice or loop, each node is only taken once.
+    std::vector<bool> visited(model.nodes.size(), false);
+    std::vector<std::pair<int, glm::mat4>> stack;
+    for (auto root = roots.rbegin(); root != roots.rend(); ++root) {
+        stack.emplace_back(*root, glm::mat4(1.0f));
+    }
+
+    while (!stack.empty()) {
+        auto [nodeIndex, parentTransform] = stack.back();
+        stack.pop_back();
+        if (nodeIndex < 0 || nodeIndex >= static_cast<int>(model.nodes.size()) || visited[nodeIndex]) continue;
+        visited[nodeIndex] = true;
+
+        const auto& node = model.nodes[nodeIndex];
+        glm::mat4 transform = parentTransform * GetNodeTransform(node);
+
+        // Pushed in reverse so children come out in file order
+        for (auto child = node.children.rbegin(); child != node.children.rend(); ++child) {
+            stack.emplace_back(*child, transform);
+        }
+
+        if (node.mesh < 0) continue;
+        const auto& mesh = model.meshes[node.mesh];
+
+        for (size_t primIndex = 0; primIndex < mesh.primitives.size(); ++primIndex) {
+            const auto& prim = mesh.primitives[primIndex];
+            uint64_t primitiveId = (static_cast<uint64_t>(node.mesh) << 32) | primIndex;
+
+            auto built = builtPrimitives.find(primitiveId);
+            if (built == builtPrimitives.end()) {
+                CpuPrimitive primitive;
+                primitive.meshIndex = node.mesh;
+                primitive.primitiveIndex = static_cast<int>(primIndex);
+
+                if (!BuildPrimitive(model, prim, primitive)) {
+                    builtPrimitives[primitiveId] = -1;
+                    continue;
+                }
+
+                if (prim.material >= 0) {
+                    const tinygltf::Material& material = model.materials[prim.material];
+                    int textureIndex = material.pbrMetallicRoughness.baseColorTexture.index;
+
+                    if (textureIndex >= 0) {
+                        auto texture = builtTextures.find(textureIndex);
+                        if (texture == builtTextures.end()) {
+                            tinygltf::Image& image = model.images[model.textures[textureIndex].source];
+
+                            CpuTexture cpuTexture;
+                            cpuTexture.source = textureIndex;
+                            cpuTexture.width = image.width;
+                            cpuTexture.height = image.height;
+                            cpuTexture.components = image.component;
+                            cpuTexture.pixels = std::move(image.image);
+
+                            texture = builtTextures.emplace(textureIndex, static_cast<int>(result.textures.size())).first;
+                            result.textures.push_back(std::move(cpuTexture));
+                        }
+                        primitive.texture = texture->second;
+                    }
+                }
+
+                built = builtPrimitives.emplace(primitiveId, static_cast<int>(result.primitives.size())).first;
+                result.primitives.push_back(std::move(primitive));
+            }
+
+            if (built->second < 0) continue;
+
+            CpuModelInstance instance;
+            instance.primitive = static_cast<uint32_t>(built->second);
+            instance.transform = transform;
+            result.instances.push_back(instance);
+        }
+    }
+
+    if (!MeshCache::Save(path, sourceHash, result)) {
+        std::cerr << "Failed to write mesh cache for: " << path << std::endl;
+    }
+    return true;
+}
+
+glm::mat4 AssetLoader::GetNodeTransform(const tinygltf::Node& node) {
+    if (!node.matrix.empty()) {
+        return glm::mat4(glm::make_mat4x4(node.matrix.data()));
+    }
+
+    glm::vec3 translation = node.translation.size() == 3 ?
+        glm::vec3(static_cast<float>(node.translation[0]),
+            static_cast<float>(node.translation[1]),
+            static_cast<float>(node.translation[2])) : glm::vec3(0.0f);
+    glm::vec3 scale = node.scale.size() == 3 ?
+        glm::vec3(static_cast<float>(node.scale[0]),
+            static_cast<float>(node.scale[1]),
+            static_cast<float>(node.scale[2])) : glm::vec3(1.0f);
+    glm::quat rotation = node.rotation.size() == 4 ?
+        glm::quat(static_cast<float>(node.rotation[3]),
+            static_cast<float>(node.rotation[0]),
+            static_cast<float>(node.rotation[1]),
+            static_cast<float>(node.rotation[2])) : glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+
+    return glm::translate(glm::mat4(1.0f), translation) *
+        glm::toMat4(rotation) *
+        glm::scale(glm::mat4(1.0f), scale);
+}
+
+AttributeStream AssetLoader::GetAttributeStream(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+    const char* name, size_t& count) {
+    AttributeStream stream;
+    count = 0;
+
+    auto it = primitive.attributes.find(name);
+    if (it == primitive.attributes.end()) {
+        return stream;
+    }
+
+    const tinygltf::Accessor& accessor = model.accessors[it->second];
+    if (accessor.bufferView < 0) {
+        return stream;
+    }
+
+    const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+    const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+    int byteStride = accessor.ByteStride(bufferView);
+    if (byteStride <= 0) {
+        return stream;
+    }
+
+    stream.data = &buffer.data[bufferView.byteOffset + accessor.byteOffset];
+    stream.byteStride = static_cast<size_t>(byteStride);
+    stream.componentType = static_cast<GLenum>(accessor.componentType);
+    stream.components = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+    stream.normalized = accessor.normalized;
+    count = accessor.count;
+    return stream;
+}
+
+bool AssetLoader::BuildPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive, CpuPrimitive& result) {
+    size_t vertexCount = 0;
+    AttributeStream position = GetAttributeStream(model, primitive, "POSITION", vertexCount);
+    if (!position.data) {
+        return false;
+    }
+
+    // Streams shorter than POSITION would be read past their end, those fall back to defaults
+    size_t normalCount = 0;
+    size_t texcoordCount = 0;
+    AttributeStream normal = GetAttributeStream(model, primitive, "NORMAL", normalCount);
+    AttributeStream texcoord = GetAttributeStream(model, primitive, "TEXCOORD_0", texcoordCount);
+    if (normalCount < vertexCount) normal = AttributeStream();
+    if (texcoordCount < vertexCount) texcoord = AttributeStream();
+
+    const tinygltf::Accessor& posAccessor = model.accessors[primitive.attributes.at("POSITION")];
+    result.mesh.bounds = MeshUtils::ComputeBounds(posAccessor, position.data, position.byteStride);
+
+    std::vector<unsigned int> indices;
+    if (primitive.indices >= 0) {
+        const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
+        const tinygltf::BufferView& indexBufferView = model.bufferViews[indexAccessor.bufferView];
+        const tinygltf::Buffer& indexBuffer = model.buffers[indexBufferView.buffer];
+
+        indices.resize(indexAccessor.count);
+        MeshUtils::WidenIndices(&indexBuffer.data[indexBufferView.byteOffset + indexAccessor.byteOffset],
+            static_cast<GLenum>(indexAccessor.componentType), indexAccessor.count, indices.data());
+    }
+
+    std::vector<float> vertices(vertexCount * MeshUtils::FloatsPerVertex);
+    MeshUtils::InterleaveAttributes(position, normal, texcoord, vertexCount, vertices.data());
+
+    if (indices.empty()) {
+        indices.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; ++i) {
+            indices[i] = static_cast<unsigned int>(i);
+        }
+    }
+
+    // An index past the vertices would draw from another mesh's part of the arena
+    for (unsigned int index : indices) {
+        if (index >= vertexCount) {
+            std::cerr << "Primitive index out of range: " << index << " of " << vertexCount << " vertices" << std::endl;
+            return false;
+        }
+    }
+
+    // LODs and the cache order are built from triangle lists only, line and point data stays as it is
+    bool triangleList = primitive.mode == TINYGLTF_MODE_TRIANGLES && indices.size() % 3 == 0;
+    if (triangleList) {
+        MeshUtils::GenerateLods(vertices, MeshUtils::FloatsPerVertex, indices, result.mesh);
+        MeshUtils::OptimizeMesh(vertices, MeshUtils::FloatsPerVertex, indices, result.mesh);
+    }
+    else {
+        result.mesh.lods[0] = { 0, static_cast<uint32_t>(indices.size()), 0.0f };
+        result.mesh.lodCount = 1;
+    }
+
+    result.vertexCount = static_cast<uint32_t>(vertices.size() / MeshUtils::FloatsPerVertex);
+    result.indexCount = static_cast<uint32_t>(indices.size());
+    MeshUtils::PackVertices(vertices, MeshUtils::FloatsPerVertex, result.vertices, result.mesh);
+    MeshUtils::PackIndices(indices, result.vertexCount, result.indices, result.mesh);
+    return true;
+}
+
+bool AssetLoader::UploadModel(CpuModel& model, PrefabHandle& prefab) {
+    StringId source = StringTable::Intern(model.path);
+
+    // Another load of the same file version got here first
+    PrefabHandle cached = ResourceManager::FindPrefab(source);
+    if (cached.IsValid() && ResourceManager::GetPrefab(cached)->writeTime == model.writeTime) {
+        prefab = cached;
+        return true;
+    }
+
+    std::vector<TextureHandle> textures(model.textures.size());
+    for (size_t i = 0; i < model.textures.size(); ++i) {
+        const CpuTexture& texture = model.textures[i];
+        ResourceKey key{ source, static_cast<uint32_t>(texture.source) };
+
+        // Textures of this version may have outlived a prefab that lost a mesh to eviction
+        textures[i] = ResourceManager::FindTexture(key);
+        if (textures[i].IsValid() && ResourceManager::GetWriteTime(textures[i]) == model.writeTime) continue;
+
+        GLuint textureId = 0;
+        glGenTextures(1, &textureId);
+        glBindTexture(GL_TEXTURE_2D, textureId);
+
+        GLenum format = GL_RGB;
+        if (texture.components == 4) {
+            format = GL_RGBA;
+        }
+        else if (texture.components == 1) {
+            format = GL_RED;
+        }
+
+        glTexImage2D(GL_TEXTURE_2D, 0, format, texture.width, texture.height, 0,
+            format, GL_UNSIGNED_BYTE, texture.GetPixels());
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        // The mip chain adds a third on top of the base level
+        size_t bytes = static_cast<size_t>(texture.width) * texture.height * texture.components * 4 / 3;
+        if (textures[i].IsValid()) {
+            ResourceManager::ReplaceTexture(textures[i], textureId, bytes);
+        }
+        else {
+            textures[i] = ResourceManager::GetOrCreateTexture(key, textureId, bytes);
+        }
+        ResourceManager::SetWriteTime(textures[i], model.writeTime);
+    }
+
+    std::vector<MeshHandle> meshes(model.primitives.size());
+    for (size_t i = 0; i < model.primitives.size(); ++i) {
+        const CpuPrimitive& primitive = model.primitives[i];
+        ResourceKey key{ source, static_cast<uint32_t>(primitive.meshIndex), static_cast<uint32_t>(primitive.primitiveIndex) };
+        MeshHandle handle = ResourceManager::GetOrCreateMesh(key);
+        MeshPrimitive* cachedMesh = ResourceManager::GetMesh(handle);
+        if (!cachedMesh) continue;
+
+        // Objects already using the old version pick up the new geometry through the same handle
+        if (ResourceManager::GetWriteTime(handle) != model.writeTime) {
+            ResourceManager::ReleaseGeometry(*cachedMesh);
+        }
+
+        if (cachedMesh->indexCount == 0) {
+            *cachedMesh = primitive.mesh;
+            if (!ResourceManager::UploadGeometry(primitive.GetVertices(), primitive.vertexCount,
+                primitive.GetIndices(), primitive.indexCount, *cachedMesh)) {
+                continue;
+            }
+            ResourceManager::SetMeshTexture(handle, primitive.texture >= 0 ? textures[primitive.texture] : TextureHandle());
+            ResourceManager::SetWriteTime(handle, model.writeTime);
+        }
+
+        meshes[i] = handle;
+    }
+
+    Prefab result;
+    result.source = source;
+    result.writeTime = model.writeTime;
+    result.dependencies = model.dependencies;
+    for (const CpuModelInstance& cpuInstance : model.instances) {
+        if (!meshes[cpuInstance.primitive].IsValid()) continue;
+
+        ModelInstance instance;
+        instance.mesh = meshes[cpuInstance.primitive];
+        instance.transform = cpuInstance.transform;
+        result.instances.push_back(instance);
+    }
+
+    prefab = ResourceManager::StorePrefab(std::move(result));
+    return prefab.IsValid();
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "ModelInstance.hpp"
+#include "MeshUtils.hpp"
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace tinygltf {
+    class Model;
+    class Node;
+    struct Primitive;
+}
+
+class MappedFile;
+
+// source is the glTF texture index, which with the model path names the texture in ResourceManager
+struct CpuTexture {
+    int source = -1;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    std::vector<unsigned char> pixels;
+    const unsigned char* mappedPixels = nullptr;
+
+    const unsigned char* GetPixels() const { return mappedPixels ? mappedPixels : pixels.data(); }
+};
+
+// A primitive packed for ResourceManager::UploadGeometry. Bounds, LODs, cache stats, index type
+// and quantisation of mesh are filled in, its GL fields are not. The data either lives in the
+// vectors or, for a model read from a baked cache, in the model's file mapping.
+struct CpuPrimitive {
+    int meshIndex = 0;
+    int primitiveIndex = 0;
+    MeshPrimitive mesh;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    std::vector<uint8_t> vertices;
+    std::vector<uint8_t> indices;
+    const uint8_t* mappedVertices = nullptr;
+    const uint8_t* mappedIndices = nullptr;
+    int texture = -1;
+
+    const uint8_t* GetVertices() const { return mappedVertices ? mappedVertices : vertices.data(); }
+    const uint8_t* GetIndices() const { return mappedIndices ? mappedIndices : indices.data(); }
+};
+
+struct CpuModelInstance {
+    uint32_t primitive = 0;
+    glm::mat4 transform = glm::mat4(1.0f);
+};
+
+// Everything the GL thread needs to create a model, built without touching GL
+struct CpuModel {
+    std::string path;
+    // Newest of the file's and its external buffers' and images' write times
+    std::filesystem::file_time_type writeTime;
+    std::vector<std::string> dependencies;
+    std::vector<CpuPrimitive> primitives;
+    std::vector<CpuTexture> textures;
+    std::vector<CpuModelInstance> instances;
+    std::shared_ptr<MappedFile> mapping;
+};
+
+struct ModelJob {
+    std::string path;
+    std::atomic<bool> done = false;
+    bool success = false;
+    CpuModel model;
+
+    // Filled by the first upload so other objects using the same model can share it. The job
+    // holds a reference to the prefab until the last object waiting on it has taken its own.
+    bool uploaded = false;
+    PrefabHandle prefab;
+    uint32_t pendingObjects = 0;
+};
+
+// Progress of a batch of model loads started by Scene::LoadFromFile. Copies share the same state.
+class LoadHandle {
+public:
+    bool IsValid() const { return state != nullptr; }
+    bool IsDone() const { return !state || state->finished.load() == state->total.load(); }
+    uint32_t GetTotal() const { return state ? state->total.load() : 0; }
+    uint32_t GetFinished() const { return state ? state->finished.load() : 0; }
+    uint32_t GetFailed() const { return state ? state->failed.load() : 0; }
+
+    explicit operator bool() const { return IsValid(); }
+
+private:
+    friend class Scene;
+
+    struct State {
+        std::atomic<uint32_t> total = 0;
+        std::atomic<uint32_t> finished = 0;
+        std::atomic<uint32_t> failed = 0;
+    };
+    std::shared_ptr<State> state;
+};
+
+// Parses glTF files, decodes their images and builds vertex data on a pool of worker
+// threads. Results are picked up and uploaded on the GL thread with UploadModel.
+class AssetLoader {
+public:
+    explicit AssetLoader(unsigned int threadCount = 0);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Requests for a path that is still queued or loading share one job
+    std::shared_ptr<ModelJob> Request(const std::string& path);
+
+    // Finds the prefab of a model that is already loaded and unchanged on disk. GL thread only.
+    static bool GetCachedModel(const std::string& path, PrefabHandle& prefab);
+
+    // CPU only, safe to call from any thread. Reads the model's baked .isomesh cache when it
+    // matches the source file and writes a new one after importing otherwise.
+    static bool BuildModel(const std::string& path, CpuModel& model);
+
+    // Must run on the GL thread. Meshes and textures already in ResourceManager are reused unless
+    // the file changed since they were loaded, in which case they are replaced in place.
+    static bool UploadModel(CpuModel& model, PrefabHandle& prefab);
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::shared_ptr<ModelJob>> queue;
+    std::unordered_map<std::string, std::weak_ptr<ModelJob>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void WorkerLoop();
+
+    // External buffer and image files a .gltf or .glb refers to, data URIs are left out
+    static std::vector<std::string> FindDependencies(const std::string& path, const uint8_t* data, size_t size);
+    static std::filesystem::file_time_type GetWriteTime(const std::string& path,
+        const std::vector<std::string>& dependencies, std::error_code& error);
+
+    // Local transform of a node, from its matrix or its translation / rotation / scale
+    static glm::mat4 GetNodeTransform(const tinygltf::Node& node);
+    static AttributeStream GetAttributeStream(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+        const char* name, size_t& count);
+    static bool BuildPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive, CpuPrimitive& result);
+};
\ No newline at end of file
@@ -15,6 +15,8 @@
 
 #include "Window.hpp"
 #include "Scene.hpp"
+#include "SceneStreamer.hpp"
+#include "ResourceManager.hpp"
 #include "Camera.hpp"
 #include "Utils.hpp"
 #include "Renderer.hpp"
@@ -103,15 +105,16 @@ int editor() {
         if (keystate[SDL_SCANCODE_D]) camera.MoveRight(dtime, 5.0f);
         if (keystate[SDL_SCANCODE_A]) camera.MoveRight(dtime, -5.0f);
         if (keystate[SDL_SCANCODE_P]) {
-            for (const auto& [id, obj] : scene.GetObjects()) {
-                if (obj.physics.hasCollision) {
+            auto bodies = scene.GetRegistry().view<const TransformComponent, const PhysicsProperties>();
+            for (auto [entity, transform, physics] : bodies.each()) {
+                if (physics.hasCollision) {
                     physicsSystem.CreateRigidBody(
-                        id,
-                        obj.position,
-                        obj.rotation,
-                        obj.physics.collisionShapeSize,
-                        obj.physics.mass,
-                        obj.physics.isStatic
+                        entity,
+                        transform.position,
+                        transform.rotation,
+                        physics.collisionShapeSize,
+                        physics.mass,
+                        physics.isStatic
                     );
                 }
             }
@@ -136,52 +139,75 @@ int editor() {
                 move_toggle = false;
             else if (event.type == SDL_EVENT_MOUSE_MOTION && move_toggle)
                 camera.Rotate(-event.motion.yrel * 0.1f, event.motion.xrel * 0.1f);
+            else if (event.type == SDL_EVENT_KEY_DOWN && (event.key.mod & SDL_KMOD_CTRL) && !ImGui::GetIO().WantTextInput) {
+                if (event.key.key == SDLK_Z)
+                    scene.Undo();
+                else if (event.key.key == SDLK_Y)
+                    scene.Redo();
+            }
         }
 
         gui.Add_GUI_Frame([&]() {
             ImGui::Begin("Scene Objects");
-            for (const auto& [id, obj] : scene.GetObjects()) {
+            auto objects = scene.GetRegistry().view<const NameComponent, const TransformComponent,
+                const RenderableComponent, const PhysicsProperties>();
+
+            // A drag is one undo step: grabbing a slider opens it, changes while the slider stays
+            // active merge into it and letting go ends it
+            static bool dragStepOpen = false;
+            auto sliderEdited = [&scene](bool changed) {
+                if (ImGui::IsItemActivated()) dragStepOpen = false;
+                if (changed) {
+                    if (dragStepOpen && ImGui::IsItemActive()) scene.ContinueUndoStep();
+                    dragStepOpen = ImGui::IsItemActive();
+                }
+                if (ImGui::IsItemDeactivatedAfterEdit()) dragStepOpen = false;
+                return changed;
+            };
+
+            for (auto [entity, name, transform, renderable, physics] : objects.each()) {
+                const std::string& id = name.id;
                 if (ImGui::TreeNode(id.c_str())) {
-                    ImGui::Text("Model: %s", obj.modelPath.c_str());
+                    ImGui::Text("Model: %s", StringTable::GetString(renderable.modelPath).c_str());
 
-                    glm::vec3 pos = obj.position;
-                    if (ImGui::SliderFloat3("Position", glm::value_ptr(pos), -10.0f, 10.0f)) {
+                    glm::vec3 pos = transform.position;
+                    if (sliderEdited(ImGui::SliderFloat3("Position", glm::value_ptr(pos), -10.0f, 10.0f))) {
                         scene.SetObjectPosition(id, pos);
                     }
 
-                    glm::vec3 rot = obj.rotation;
-                    if (ImGui::SliderFloat3("Rotation", glm::value_ptr(rot), -3.14159f, 3.14159f)) {
+                    glm::vec3 rot = transform.rotation;
+                    if (sliderEdited(ImGui::SliderFloat3("Rotation", glm::value_ptr(rot), -3.14159f, 3.14159f))) {
                         scene.SetObjectRotation(id, rot);
                     }
 
-                    glm::vec3 scale = obj.scale;
-                    if (ImGui::SliderFloat3("Scale", glm::value_ptr(scale), 0.01f, 10.0f)) {
+                    glm::vec3 scale = transform.scale;
+                    if (sliderEdited(ImGui::SliderFloat3("Scale", glm::value_ptr(scale), 0.01f, 10.0f))) {
                         scene.SetObjectScale(id, scale);
                     }
 
                     if (ImGui::TreeNode("Physics")) {
-                        bool hasCollision = obj.physics.hasCollision;
+                        bool hasCollision = physics.hasCollision;
                         if (ImGui::Checkbox("Has Collision", &hasCollision)) {
                             scene.SetObjectCollisionEnabled(id, hasCollision);
                         }
 
-                        bool isAffectedByPhysics = obj.physics.isAffectedByPhysics;
+                        bool isAffectedByPhysics = physics.isAffectedByPhysics;
                         if (ImGui::Checkbox("Affected by Physics", &isAffectedByPhysics)) {
                             scene.SetObjectPhysicsEnabled(id, isAffectedByPhysics);
                         }
 
-                        bool isStatic = obj.physics.isStatic;
+                        bool isStatic = physics.isStatic;
                         if (ImGui::Checkbox("Static", &isStatic)) {
                             scene.SetObjectStatic(id, isStatic);
                         }
 
-                        float mass = obj.physics.mass;
-                        if (ImGui::SliderFloat("Mass", &mass, 0.1f, 10.0f)) {
+                        float mass = physics.mass;
+                        if (sliderEdited(ImGui::SliderFloat("Mass", &mass, 0.1f, 10.0f))) {
                             scene.SetObjectMass(id, mass);
                         }
 
-                        glm::vec3 shapeSize = obj.physics.collisionShapeSize;
-                        if (ImGui::SliderFloat3("Collision Shape", glm::value_ptr(shapeSize), 0.1f, 10.0f)) {
+                        glm::vec3 shapeSize = physics.collisionShapeSize;
+                        if (sliderEdited(ImGui::SliderFloat3("Collision Shape", glm::value_ptr(shapeSize), 0.1f, 10.0f))) {
                             scene.SetObjectCollisionShape(id, shapeSize);
                         }
 
@@ -199,6 +225,64 @@ int editor() {
             ImGui::ColorEdit3("Color", glm::value_ptr(lightColor));
             ImGui::End();
 
+            ImGui::Begin("Stats");
+            const RenderStats& renderStats = renderer.GetStats();
+            ImGui::Text("Draw calls: %u (indirect commands %u)", renderStats.drawCalls, renderStats.indirectCommands);
+            ImGui::Text("Instances: %u (uniform scale %u)", renderStats.instances, renderStats.uniformScaleInstances);
+            ImGui::Text("Binds: shader %u, texture %u, VAO %u", renderStats.shaderBinds, renderStats.textureBinds, renderStats.vaoBinds);
+            ImGui::Text("Triangles: %u (full detail %u)", renderStats.triangles, renderStats.fullDetailTriangles);
+            ImGui::Text("GPU time: %.3f ms", renderStats.gpuTimeMs);
+            bool lodEnabled = renderer.IsLodEnabled();
+            if (ImGui::Checkbox("LOD", &lodEnabled)) {
+                renderer.SetLodEnabled(lodEnabled);
+            }
+            float lodBias = renderer.GetLodBias();
+            if (ImGui::SliderFloat("LOD bias", &lodBias, 0.25f, 8.0f)) {
+                renderer.SetLodBias(lodBias);
+            }
+            float lodHysteresis = renderer.GetLodHysteresis();
+            if (ImGui::SliderFloat("LOD hysteresis", &lodHysteresis, 0.0f, 0.5f)) {
+                renderer.SetLodHysteresis(lodHysteresis);
+            }
+            if (renderer.IsIndirectSupported()) {
+                bool indirect = renderer.IsIndirectEnabled();
+                if (ImGui::Checkbox("Multi-draw indirect", &indirect)) {
+                    renderer.SetIndirectEnabled(indirect);
+                }
+            }
+            const CullStats& cullStats = scene.GetCullStats();
+            ImGui::Text("Visible: %u / %u (culled %u)", cullStats.visible, cullStats.tested, cullStats.culled);
+            const TransformStats& transformStats = scene.GetTransformStats();
+            ImGui::Text("Transforms updated: %u + %u children / %u", transformStats.dirty, transformStats.propagated, transformStats.total);
+            const AABBTree& spatialIndex = scene.GetSpatialIndex();
+            ImGui::Text("BVH: %zu objects, height %d, cost %.1f", spatialIndex.GetProxyCount(), spatialIndex.GetHeight(), spatialIndex.GetCost());
+            if (scene.IsStreaming()) {
+                StreamingStats streaming = scene.GetStreamingStats();
+                ImGui::Text("Cells: %u / %u resident, %u loading, %u unloading, %u edited", streaming.residentCells, streaming.cells,
+                    streaming.loadingCells, streaming.unloadingCells, streaming.editedCells);
+            }
+            const LoadHandle& sceneLoad = scene.GetActiveLoad();
+            if (!sceneLoad.IsDone()) {
+                ImGui::Text("Loading: %u / %u objects", sceneLoad.GetFinished(), sceneLoad.GetTotal());
+            }
+            else if (sceneLoad.GetFailed() > 0) {
+                ImGui::Text("Failed to load: %u objects", sceneLoad.GetFailed());
+            }
+            const SaveHandle& sceneSave = scene.GetActiveSave();
+            if (sceneSave && !sceneSave.IsDone()) {
+                SaveHandle::Stage stage = sceneSave.GetStage();
+                ImGui::Text("Saving: %u objects, %s", sceneSave.GetObjectCount(), stage == SaveHandle::Stage::Queued ? "queued" :
+                    stage == SaveHandle::Stage::Partitioning ? "partitioning" : "writing");
+            }
+            ResourceStats resources = ResourceManager::GetStats();
+            ImGui::Text("GPU memory: %.1f / %.1f MB (unused %.1f MB)",
+                (resources.meshBytes + resources.textureBytes) / (1024.0 * 1024.0),
+                ResourceManager::GetMemoryBudget() / (1024.0 * 1024.0),
+                (resources.unreferencedMeshBytes + resources.unreferencedTextureBytes) / (1024.0 * 1024.0));
+            ImGui::Text("Meshes %u, textures %u, prefabs %u, evicted %u / %u", resources.meshes, resources.textures,
+                resources.prefabs, resources.evictedMeshes, resources.evictedTextures);
+            ImGui::End();
+
             ImGui::SetNextWindowPos(ImVec2(0, 1080 - 250), ImGuiCond_Always);
             ImGui::SetNextWindowSizeConstraints(ImVec2(1920, 100), ImVec2(1920, 600));
             ImGui::SetNextWindowSize(ImVec2(1920, 200), ImGuiCond_Always);
@@ -249,8 +333,12 @@ int editor() {
 
                 if (ImGui::BeginMenu("Edit"))
                 {
-                    if (ImGui::MenuItem("Undo", "Ctrl+Z")) {}
-                    if (ImGui::MenuItem("Redo", "Ctrl+Y")) {}
+                    if (ImGui::MenuItem("Undo", "Ctrl+Z", false, scene.CanUndo())) {
+                        scene.Undo();
+                    }
+                    if (ImGui::MenuItem("Redo", "Ctrl+Y", false, scene.CanRedo())) {
+                        scene.Redo();
+                    }
                     ImGui::Separator();
                     if (ImGui::MenuItem("Cut", "Ctrl+X")) {}
                     if (ImGui::MenuItem("Copy", "Ctrl+C")) {}
@@ -274,6 +362,18 @@ int editor() {
         glBindFramebuffer(GL_FRAMEBUFFER, fbo);
         glViewport(0, 0, 1405, 775);
 
+        // Nothing from the last frame points at a mesh any more, so unused ones can go now
+        ResourceManager::CollectGarbage();
+
+        // Cells around the camera come and go within their own share of the frame
+        scene.UpdateStreaming(camera.GetPosition(), 2.0);
+
+        // Bound the time spent uploading streamed-in models so loading does not stall the frame
+        scene.ProcessLoads(4.0);
+        scene.ProcessSaves();
+
+        scene.UpdateTransforms();
+
         renderer.SetLightProperties(lightPos, lightColor);
         scene.RenderScene(renderer, camera);
 
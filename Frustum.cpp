@@ -0,0 +1,155 @@
+#include "Frustum.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+void SphereBatch::Clear() {
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radius.clear();
+    count = 0;
+}
+
+void SphereBatch::Add(const glm::vec3& center, float r) {
+    if (count % 4 == 0) {
+        centerX.resize(count + 4, 0.0f);
+        centerY.resize(count + 4, 0.0f);
+        centerZ.resize(count + 4, 0.0f);
+        radius.resize(count + 4, 0.0f);
+    }
+
+    centerX[count] = center.x;
+    centerY[count] = center.y;
+    centerZ[count] = center.z;
+    radius[count] = r;
+    count++;
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4& viewProjection) {
+    Frustum frustum;
+
+    glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+
+    for (auto& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+
+    return frustum;
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3& center, float radius) const {
+    for (const auto& plane : planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::IntersectsAABB(const glm::vec3& min, const glm::vec3& max) const {
+    for (const auto& plane : planes) {
+        // Test the corner furthest along the plane normal
+        glm::vec3 positive(
+            plane.x >= 0.0f ? max.x : min.x,
+            plane.y >= 0.0f ? max.y : min.y,
+            plane.z >= 0.0f ? max.z : min.z);
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Frustum::Containment Frustum::ClassifyAABB(const glm::vec3& min, const glm::vec3& max) const {
+    Containment result = Containment::Inside;
+    for (const auto& plane : planes) {
+        glm::vec3 normal(plane);
+        glm::vec3 positive(
+            plane.x >= 0.0f ? max.x : min.x,
+            plane.y >= 0.0f ? max.y : min.y,
+            plane.z >= 0.0f ? max.z : min.z);
+
+        if (glm::dot(normal, positive) + plane.w < 0.0f) {
+            return Containment::Outside;
+        }
+
+        // The corner furthest against the normal is behind the plane, so the box straddles it
+        glm::vec3 negative(
+            plane.x >= 0.0f ? min.x : max.x,
+            plane.y >= 0.0f ? min.y : max.y,
+            plane.z >= 0.0f ? min.z : max.z);
+
+        if (glm::dot(normal, negative) + plane.w < 0.0f) {
+            result = Containment::Intersects;
+        }
+    }
+    return result;
+}
+
+size_t Frustum::CullSpheres(const SphereBatch& spheres, std::vector<uint8_t>& visible) const {
+    const size_t count = spheres.Size();
+    visible.resize(count);
+
+    size_t visibleCount = 0;
+
+#ifdef FRUSTUM_USE_SSE
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; ++p) {
+        planeX[p] = _mm_set1_ps(planes[p].x);
+        planeY[p] = _mm_set1_ps(planes[p].y);
+        planeZ[p] = _mm_set1_ps(planes[p].z);
+        planeW[p] = _mm_set1_ps(planes[p].w);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 x = _mm_loadu_ps(&spheres.centerX[i]);
+        __m128 y = _mm_loadu_ps(&spheres.centerY[i]);
+        __m128 z = _mm_loadu_ps(&spheres.centerZ[i]);
+        __m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(&spheres.radius[i]));
+
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (int p = 0; p < 6; ++p) {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+                _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        size_t lanes = (count - i) < 4 ? (count - i) : 4;
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            uint8_t isVisible = static_cast<uint8_t>((mask >> lane) & 1);
+            visible[i + lane] = isVisible;
+            visibleCount += isVisible;
+        }
+    }
+#else
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec3 center(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]);
+        uint8_t isVisible = IntersectsSphere(center, spheres.radius[i]) ? 1 : 0;
+        visible[i] = isVisible;
+        visibleCount += isVisible;
+    }
+#endif
+
+    return visibleCount;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Packed structure-of-arrays of world space bounding spheres, padded so the
+// culling kernel can always consume four lanes at a time.
+struct SphereBatch {
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+
+    void Clear();
+    void Add(const glm::vec3& center, float r);
+    size_t Size() const { return count; }
+
+private:
+    size_t count = 0;
+};
+
+class Frustum {
+public:
+    enum class Containment {
+        Outside,
+        Intersects,
+        Inside
+    };
+
+    // Extracts the six planes (left, right, bottom, top, near, far) from a projection * view matrix
+    static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+    bool IntersectsSphere(const glm::vec3& center, float radius) const;
+    bool IntersectsAABB(const glm::vec3& min, const glm::vec3& max) const;
+    // Like IntersectsAABB but also tells boxes fully inside all six planes apart, so hierarchical
+    // culling can accept whole subtrees
+    Containment ClassifyAABB(const glm::vec3& min, const glm::vec3& max) const;
+
+    // Writes 1 for every sphere that touches the frustum, 0 otherwise. Returns the visible count.
+    size_t CullSpheres(const SphereBatch& spheres, std::vector<uint8_t>& visible) const;
+
+private:
+    glm::vec4 planes[6];
+};
\ No newline at end of file
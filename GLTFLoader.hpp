@@ -2,17 +2,23 @@
 
 #include <string>
 #include <vector>
-#include <tiny_gltf.h>
 #include <glm/glm.hpp>
 
 #include "ModelInstance.hpp"
 
+// Holds a reference to the prefabs it loaded for as long as it lives
 class GLTFLoader {
 public:
+    GLTFLoader() = default;
+    ~GLTFLoader();
+
+    GLTFLoader(const GLTFLoader&) = delete;
+    GLTFLoader& operator=(const GLTFLoader&) = delete;
+
     bool LoadModel(const std::string& path);
     const std::vector<ModelInstance>& GetInstances() const;
 
 private:
-    bool LoadPrimitive(const std::string path, const tinygltf::Model& model, const tinygltf::Primitive& primitive, MeshPrimitive& meshPrim);
+    std::vector<PrefabHandle> prefabs;
     std::vector<ModelInstance> instances;
 };
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "GeometryArena.hpp"
+
+#include <algorithm>
+
+GeometryArena::GeometryArena(const VertexLayout& layout)
+    : layout(layout)
+{
+}
+
+GeometryArena::~GeometryArena() {
+    Destroy();
+}
+
+bool GeometryArena::Allocate(const void* vertices, uint32_t vertexCount,
+    const void* indices, uint32_t indexBytes,
+    GeometryRange& vertexRange, GeometryRange& indexRange) {
+    if (vertexCount == 0 || indexBytes == 0) {
+        return false;
+    }
+
+    // Rounding every index range up to 4 bytes keeps each offset a multiple of either index size
+    uint32_t indexSpace = (indexBytes + 3) & ~3u;
+
+    if (vao == 0) {
+        CreateVAO();
+    }
+
+    uint32_t vertexOffset = 0;
+    if (!TakeRange(freeVertices, vertexCount, vertexOffset)) {
+        GrowVertices(vertexCount);
+        TakeRange(freeVertices, vertexCount, vertexOffset);
+    }
+
+    uint32_t indexOffset = 0;
+    if (!TakeRange(freeIndices, indexSpace, indexOffset)) {
+        GrowIndices(indexSpace);
+        TakeRange(freeIndices, indexSpace, indexOffset);
+    }
+
+    // Upload through the copy targets so the VAO's element buffer binding is left alone
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+        static_cast<GLintptr>(vertexOffset) * layout.stride,
+        static_cast<GLsizeiptr>(vertexCount) * layout.stride, vertices);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(indexOffset), static_cast<GLsizeiptr>(indexBytes), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    vertexRange = { vertexOffset, vertexCount };
+    indexRange = { indexOffset, indexSpace };
+    return true;
+}
+
+void GeometryArena::Free(const GeometryRange& vertexRange, const GeometryRange& indexRange) {
+    if (vertexRange.count > 0) {
+        ReleaseRange(freeVertices, vertexRange);
+    }
+    if (indexRange.count > 0) {
+        ReleaseRange(freeIndices, indexRange);
+    }
+}
+
+void GeometryArena::Destroy() {
+    if (vao != 0) {
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+        glDeleteBuffers(1, &ebo);
+    }
+
+    vao = vbo = ebo = 0;
+    vertexCapacity = indexCapacity = 0;
+    freeVertices.clear();
+    freeIndices.clear();
+}
+
+void GeometryArena::CreateVAO() {
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    layout.Apply();
+
+    glBindVertexArray(0);
+}
+
+void GeometryArena::GrowVertices(uint32_t required) {
+    uint32_t newCapacity = vertexCapacity + std::max(required, VertexChunk);
+
+    vbo = GrowBuffer(vbo,
+        static_cast<size_t>(vertexCapacity) * layout.stride,
+        static_cast<size_t>(newCapacity) * layout.stride);
+
+    // The attribute pointers captured the old buffer name, point them at the new one
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    layout.Apply();
+    glBindVertexArray(0);
+
+    ReleaseRange(freeVertices, { vertexCapacity, newCapacity - vertexCapacity });
+    vertexCapacity = newCapacity;
+}
+
+void GeometryArena::GrowIndices(uint32_t required) {
+    uint32_t newCapacity = indexCapacity + std::max(required, IndexChunk);
+
+    ebo = GrowBuffer(ebo, indexCapacity, newCapacity);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBindVertexArray(0);
+
+    ReleaseRange(freeIndices, { indexCapacity, newCapacity - indexCapacity });
+    indexCapacity = newCapacity;
+}
+
+bool GeometryArena::TakeRange(std::vector<GeometryRange>& freeList, uint32_t count, uint32_t& offset) {
+    for (auto it = freeList.begin(); it != freeList.end(); ++it) {
+        if (it->count < count) continue;
+
+        offset = it->offset;
+        it->offset += count;
+        it->count -= count;
+        if (it->count == 0) {
+            freeList.erase(it);
+        }
+        return true;
+    }
+    return false;
+}
+
+void GeometryArena::ReleaseRange(std::vector<GeometryRange>& freeList, const GeometryRange& range) {
+    // Keep the list sorted by offset and merge with neighbours so fragmentation stays bounded
+    auto it = std::lower_bound(freeList.begin(), freeList.end(), range,
+        [](const GeometryRange& a, const GeometryRange& b) { return a.offset < b.offset; });
+    it = freeList.insert(it, range);
+
+    auto next = it + 1;
+    if (next != freeList.end() && it->offset + it->count == next->offset) {
+        it->count += next->count;
+        freeList.erase(next);
+    }
+
+    if (it != freeList.begin()) {
+        auto prev = it - 1;
+        if (prev->offset + prev->count == it->offset) {
+            prev->count += it->count;
+            freeList.erase(it);
+        }
+    }
+}
+
+GLuint GeometryArena::GrowBuffer(GLuint buffer, size_t oldSize, size_t newSize) {
+    GLuint grown = 0;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(newSize), nullptr, GL_STATIC_DRAW);
+
+    if (oldSize > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(oldSize));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+    return grown;
+}
\ No newline at end of file
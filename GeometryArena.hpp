@@ -0,0 +1,58 @@
+#pragma once
+
+#include "VertexLayout.hpp"
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct GeometryRange {
+    uint32_t offset = 0;
+    uint32_t count = 0;
+};
+
+// One vertex buffer and one index buffer shared by every mesh with the same
+// vertex layout. Meshes own sub-ranges handed out by a first-fit allocator and
+// are drawn from a single VAO with a base vertex. Vertex ranges count vertices,
+// index ranges count bytes so 16 and 32-bit index lists can share the buffer.
+class GeometryArena {
+public:
+    static constexpr uint32_t VertexChunk = 256 * 1024;
+    static constexpr uint32_t IndexChunk = 4 * 1024 * 1024;
+
+    explicit GeometryArena(const VertexLayout& layout);
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    bool Allocate(const void* vertices, uint32_t vertexCount,
+        const void* indices, uint32_t indexBytes,
+        GeometryRange& vertexRange, GeometryRange& indexRange);
+    void Free(const GeometryRange& vertexRange, const GeometryRange& indexRange);
+
+    void Destroy();
+
+    const VertexLayout& GetLayout() const { return layout; }
+    GLuint GetVAO() const { return vao; }
+    uint32_t GetVertexCapacity() const { return vertexCapacity; }
+    uint32_t GetIndexCapacity() const { return indexCapacity; }
+
+private:
+    const VertexLayout& layout;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    uint32_t vertexCapacity = 0;
+    uint32_t indexCapacity = 0;
+    std::vector<GeometryRange> freeVertices;
+    std::vector<GeometryRange> freeIndices;
+
+    void CreateVAO();
+    void GrowVertices(uint32_t required);
+    void GrowIndices(uint32_t required);
+
+    static bool TakeRange(std::vector<GeometryRange>& freeList, uint32_t count, uint32_t& offset);
+    static void ReleaseRange(std::vector<GeometryRange>& freeList, const GeometryRange& range);
+    static GLuint GrowBuffer(GLuint buffer, size_t oldSize, size_t newSize);
+};
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "MeshCache.hpp"
+#include "MappedFile.hpp"
+#include "VertexLayout.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+struct MeshCache::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexStride;
+    uint64_t sourceHash;
+    uint32_t primitiveCount;
+    uint32_t textureCount;
+    uint32_t instanceCount;
+    uint32_t reserved;
+};
+
+struct MeshCache::PrimitiveEntry {
+    int32_t meshIndex;
+    int32_t primitiveIndex;
+    int32_t texture;
+    uint32_t indexType;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    glm::vec3 quantizationOffset;
+    glm::vec3 quantizationScale;
+    MeshBounds bounds;
+    MeshLod lods[MeshPrimitive::MaxLods];
+    uint32_t lodCount;
+    MeshCacheStats cacheStats;
+};
+
+struct MeshCache::TextureEntry {
+    int32_t source;
+    int32_t width;
+    int32_t height;
+    int32_t components;
+    uint64_t pixelOffset;
+    uint64_t pixelSize;
+};
+
+struct MeshCache::InstanceEntry {
+    uint32_t primitive;
+    uint32_t reserved[3];
+    glm::mat4 transform;
+};
+
+static_assert(std::is_trivially_copyable_v<MeshBounds> && std::is_trivially_copyable_v<MeshLod> &&
+    std::is_trivially_copyable_v<MeshCacheStats>, "mesh cache entries are written as raw bytes");
+
+static const char CacheMagic[8] = { 'I', 'S', 'O', 'M', 'E', 'S', 'H', '\0' };
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath) {
+    return sourcePath + ".isomesh";
+}
+
+uint64_t MeshCache::HashContents(const uint8_t* data, size_t size, uint64_t hash) {
+    // FNV-1a
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool MeshCache::Load(const std::string& sourcePath, uint64_t sourceHash, CpuModel& model) {
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->Open(GetCachePath(sourcePath))) {
+        return false;
+    }
+
+    const uint8_t* data = mapping->GetData();
+    uint64_t size = mapping->GetSize();
+    if (size < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 || header.version != FormatVersion ||
+        header.vertexStride != VertexLayout::Compact().stride || header.sourceHash != sourceHash) {
+        return false;
+    }
+
+    uint64_t primitiveTable = sizeof(Header);
+    uint64_t textureTable = primitiveTable + uint64_t(header.primitiveCount) * sizeof(PrimitiveEntry);
+    uint64_t instanceTable = textureTable + uint64_t(header.textureCount) * sizeof(TextureEntry);
+    if (instanceTable + uint64_t(header.instanceCount) * sizeof(InstanceEntry) > size) {
+        return false;
+    }
+
+    auto inFile = [size](uint64_t offset, uint64_t length) {
+        return offset % BlobAlignment == 0 && offset <= size && length <= size - offset;
+    };
+
+    CpuModel result;
+    result.path = sourcePath;
+    result.writeTime = model.writeTime;
+    result.dependencies = model.dependencies;
+
+    result.textures.resize(header.textureCount);
+    for (uint32_t i = 0; i < header.textureCount; ++i) {
+        TextureEntry entry;
+        std::memcpy(&entry, data + textureTable + i * sizeof(TextureEntry), sizeof(entry));
+        if (entry.pixelSize < uint64_t(entry.width) * entry.height * entry.components ||
+            !inFile(entry.pixelOffset, entry.pixelSize)) {
+            return false;
+        }
+
+        CpuTexture& texture = result.textures[i];
+        texture.source = entry.source;
+        texture.width = entry.width;
+        texture.height = entry.height;
+        texture.components = entry.components;
+        texture.mappedPixels = data + entry.pixelOffset;
+    }
+
+    result.primitives.resize(header.primitiveCount);
+    for (uint32_t i = 0; i < header.primitiveCount; ++i) {
+        PrimitiveEntry entry;
+        std::memcpy(&entry, data + primitiveTable + i * sizeof(PrimitiveEntry), sizeof(entry));
+
+        if (entry.indexType != GL_UNSIGNED_SHORT && entry.indexType != GL_UNSIGNED_INT) {
+            return false;
+        }
+        uint64_t indexSize = entry.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        if (!inFile(entry.vertexOffset, uint64_t(entry.vertexCount) * header.vertexStride) ||
+            !inFile(entry.indexOffset, uint64_t(entry.indexCount) * indexSize) ||
+            entry.lodCount < 1 || entry.lodCount > MeshPrimitive::MaxLods ||
+            entry.texture < -1 || entry.texture >= int32_t(header.textureCount)) {
+            return false;
+        }
+        // The draws index into this primitive's part of the arena, a LOD reaching past it is damage
+        for (uint32_t lod = 0; lod < entry.lodCount; ++lod) {
+            if (uint64_t(entry.lods[lod].firstIndex) + entry.lods[lod].indexCount > entry.indexCount) {
+                return false;
+            }
+        }
+
+        CpuPrimitive& primitive = result.primitives[i];
+        primitive.meshIndex = entry.meshIndex;
+        primitive.primitiveIndex = entry.primitiveIndex;
+        primitive.texture = entry.texture;
+        primitive.vertexCount = entry.vertexCount;
+        primitive.indexCount = entry.indexCount;
+        primitive.mappedVertices = data + entry.vertexOffset;
+        primitive.mappedIndices = data + entry.indexOffset;
+
+        MeshPrimitive& mesh = primitive.mesh;
+        mesh.indexType = entry.indexType;
+        mesh.quantizationOffset = entry.quantizationOffset;
+        mesh.quantizationScale = entry.quantizationScale;
+        mesh.bounds = entry.bounds;
+        std::memcpy(mesh.lods, entry.lods, sizeof(mesh.lods));
+        mesh.lodCount = entry.lodCount;
+        mesh.cacheStats = entry.cacheStats;
+    }
+
+    result.instances.resize(header.instanceCount);
+    for (uint32_t i = 0; i < header.instanceCount; ++i) {
+        InstanceEntry entry;
+        std::memcpy(&entry, data + instanceTable + i * sizeof(InstanceEntry), sizeof(entry));
+        if (entry.primitive >= header.primitiveCount) {
+            return false;
+        }
+
+        result.instances[i].primitive = entry.primitive;
+        result.instances[i].transform = entry.transform;
+    }
+
+    result.mapping = std::move(mapping);
+    model = std::move(result);
+    return true;
+}
+
+bool MeshCache::Save(const std::string& sourcePath, uint64_t sourceHash, const CpuModel& model) {
+    Header header = {};
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version = FormatVersion;
+    header.vertexStride = VertexLayout::Compact().stride;
+    header.sourceHash = sourceHash;
+    header.primitiveCount = static_cast<uint32_t>(model.primitives.size());
+    header.textureCount = static_cast<uint32_t>(model.textures.size());
+    header.instanceCount = static_cast<uint32_t>(model.instances.size());
+
+    // Lay the blobs out after the tables, each on its own aligned offset
+    uint64_t offset = sizeof(Header) + model.primitives.size() * sizeof(PrimitiveEntry) +
+        model.textures.size() * sizeof(TextureEntry) + model.instances.size() * sizeof(InstanceEntry);
+
+    std::vector<PrimitiveEntry> primitives(model.primitives.size());
+    for (size_t i = 0; i < model.primitives.size(); ++i) {
+        const CpuPrimitive& primitive = model.primitives[i];
+        const MeshPrimitive& mesh = primitive.mesh;
+        uint64_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        PrimitiveEntry& entry = primitives[i];
+        std::memset(static_cast<void*>(&entry), 0, sizeof(entry));
+        entry.meshIndex = primitive.meshIndex;
+        entry.primitiveIndex = primitive.primitiveIndex;
+        entry.texture = primitive.texture;
+        entry.indexType = mesh.indexType;
+        entry.vertexCount = primitive.vertexCount;
+        entry.indexCount = primitive.indexCount;
+        entry.quantizationOffset = mesh.quantizationOffset;
+        entry.quantizationScale = mesh.quantizationScale;
+        entry.bounds = mesh.bounds;
+        std::memcpy(entry.lods, mesh.lods, sizeof(entry.lods));
+        entry.lodCount = mesh.lodCount;
+        entry.cacheStats = mesh.cacheStats;
+
+        entry.vertexOffset = Align(offset);
+        offset = entry.vertexOffset + uint64_t(primitive.vertexCount) * header.vertexStride;
+        entry.indexOffset = Align(offset);
+        offset = entry.indexOffset + primitive.indexCount * indexSize;
+    }
+
+    std::vector<TextureEntry> textures(model.textures.size());
+    for (size_t i = 0; i < model.textures.size(); ++i) {
+        const CpuTexture& texture = model.textures[i];
+
+        TextureEntry& entry = textures[i];
+        entry.source = texture.source;
+        entry.width = texture.width;
+        entry.height = texture.height;
+        entry.components = texture.components;
+        entry.pixelSize = texture.pixels.size();
+        entry.pixelOffset = Align(offset);
+        offset = entry.pixelOffset + entry.pixelSize;
+    }
+
+    std::vector<InstanceEntry> instances(model.instances.size());
+    for (size_t i = 0; i < model.instances.size(); ++i) {
+        instances[i] = {};
+        instances[i].primitive = model.instances[i].primitive;
+        instances[i].transform = model.instances[i].transform;
+    }
+
+    // Written under a temporary name so a reader never maps a half-written cache
+    std::string cachePath = GetCachePath(sourcePath);
+    std::string tempPath = cachePath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        auto writeAt = [&file](uint64_t position, const void* bytes, uint64_t length) {
+            static const char zeros[BlobAlignment] = {};
+            uint64_t current = static_cast<uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(position - current));
+            file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(length));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(primitives.data()), primitives.size() * sizeof(PrimitiveEntry));
+        file.write(reinterpret_cast<const char*>(textures.data()), textures.size() * sizeof(TextureEntry));
+        file.write(reinterpret_cast<const char*>(instances.data()), instances.size() * sizeof(InstanceEntry));
+
+        for (size_t i = 0; i < model.primitives.size(); ++i) {
+            const CpuPrimitive& primitive = model.primitives[i];
+            uint64_t indexSize = primitive.mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+            writeAt(primitives[i].vertexOffset, primitive.GetVertices(), uint64_t(primitive.vertexCount) * header.vertexStride);
+            writeAt(primitives[i].indexOffset, primitive.GetIndices(), primitive.indexCount * indexSize);
+        }
+
+        for (size_t i = 0; i < model.textures.size(); ++i) {
+            writeAt(textures[i].pixelOffset, model.textures[i].GetPixels(), textures[i].pixelSize);
+        }
+
+        if (!file) {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
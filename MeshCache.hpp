@@ -0,0 +1,33 @@
+#pragma once
+
+#include "AssetLoader.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// GPU-ready copy of an imported model, written next to the source as <source>.isomesh.
+// It holds the packed vertex and index blobs, bounds, LODs, decoded texture pixels and the
+// node instances. Every blob starts on a BlobAlignment boundary so the file can be mapped
+// and its pointers handed to GL as they are. A cache built from different source bytes,
+// another FormatVersion or another vertex layout is ignored and rebuilt by the importer.
+class MeshCache {
+public:
+    static constexpr uint32_t FormatVersion = 3;
+    static constexpr uint64_t BlobAlignment = 16;
+
+    static std::string GetCachePath(const std::string& sourcePath);
+    // Pass a previous result as hash to continue it over more bytes
+    static uint64_t HashContents(const uint8_t* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+    // On success the model's data points into model.mapping
+    static bool Load(const std::string& sourcePath, uint64_t sourceHash, CpuModel& model);
+    static bool Save(const std::string& sourcePath, uint64_t sourceHash, const CpuModel& model);
+
+private:
+    struct Header;
+    struct PrimitiveEntry;
+    struct TextureEntry;
+    struct InstanceEntry;
+
+    static uint64_t Align(uint64_t offset) { return (offset + BlobAlignment - 1) & ~(BlobAlignment - 1); }
+};
\ No newline at end of file
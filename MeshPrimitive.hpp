@@ -2,13 +2,53 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
-#include <string>
+#include <cstdint>
 
+struct MeshBounds {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// An index range drawn against the primitive's vertices. error is the
+// simplification error relative to bounds.radius, 0 for the full mesh.
+struct MeshLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;
+};
+
+// Post-transform vertex cache efficiency of LOD 0 as authored and after the import optimisation.
+// ACMR is cache misses per triangle, ATVR is cache misses per vertex (1.0 is ideal).
+struct MeshCacheStats {
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+    float atvrBefore = 0.0f;
+    float atvrAfter = 0.0f;
+};
+
+// A sub-range of ResourceManager's shared geometry arena. Index offsets count
+// indices of indexType, indexByteOffset/indexByteSize cover every LOD and are
+// what gets freed. Positions are stored quantised to the bounds, a stored
+// position q maps back to quantizationOffset + q * quantizationScale.
 struct MeshPrimitive {
-    unsigned int vao = 0;
-    unsigned int vbo = 0;
-    unsigned int ebo = 0;
+    static constexpr uint32_t MaxLods = 4;
+
+    uint32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
     size_t indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    uint32_t indexByteOffset = 0;
+    uint32_t indexByteSize = 0;
+    glm::vec3 quantizationOffset = glm::vec3(0.0f);
+    glm::vec3 quantizationScale = glm::vec3(1.0f);
+    MeshLod lods[MaxLods];
+    uint32_t lodCount = 0;
     GLuint texture = 0;
-    std::string name;
+    // Index of the texture's handle, what draws are sorted by instead of the unbounded GL name
+    uint32_t textureSlot = 0;
+    MeshBounds bounds;
+    MeshCacheStats cacheStats;
 };
\ No newline at end of file
@@ -0,0 +1,906 @@
+#include "MeshUtils.hpp"
+#include "VertexLayout.hpp"
+
+#include <tiny_gltf.h>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_set>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ISO_MESHUTILS_SSE2
+#include <emmintrin.h>
+#endif
+
+MeshBounds MeshUtils::ComputeBounds(const tinygltf::Accessor& posAccessor, const unsigned char* posData, size_t byteStride) {
+    MeshBounds bounds;
+
+    if (byteStride == 0) {
+        byteStride = 3 * sizeof(float);
+    }
+
+    if (posAccessor.minValues.size() == 3 && posAccessor.maxValues.size() == 3) {
+        bounds.min = glm::vec3(
+            static_cast<float>(posAccessor.minValues[0]),
+            static_cast<float>(posAccessor.minValues[1]),
+            static_cast<float>(posAccessor.minValues[2]));
+        bounds.max = glm::vec3(
+            static_cast<float>(posAccessor.maxValues[0]),
+            static_cast<float>(posAccessor.maxValues[1]),
+            static_cast<float>(posAccessor.maxValues[2]));
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+        bounds.radius = glm::length(bounds.max - bounds.center);
+        return bounds;
+    }
+
+    if (posAccessor.count == 0) {
+        return bounds;
+    }
+
+    bounds.min = glm::vec3(std::numeric_limits<float>::max());
+    bounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (size_t i = 0; i < posAccessor.count; ++i) {
+        glm::vec3 position;
+        std::memcpy(&position, posData + i * byteStride, sizeof(position));
+        bounds.min = glm::min(bounds.min, position);
+        bounds.max = glm::max(bounds.max, position);
+    }
+
+    bounds.center = (bounds.min + bounds.max) * 0.5f;
+
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < posAccessor.count; ++i) {
+        glm::vec3 position;
+        std::memcpy(&position, posData + i * byteStride, sizeof(position));
+        glm::vec3 offset = position - bounds.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+
+    return bounds;
+}
+
+// Sum of squared distances to a set of area weighted planes (Garland & Heckbert).
+// Error() divides by the total weight so the result is a mean squared distance.
+struct MeshUtils::Quadric {
+    double a2 = 0.0, b2 = 0.0, c2 = 0.0, d2 = 0.0;
+    double ab = 0.0, ac = 0.0, ad = 0.0;
+    double bc = 0.0, bd = 0.0, cd = 0.0;
+    double weight = 0.0;
+
+    void AddPlane(const glm::dvec3& normal, double distance, double w) {
+        a2 += w * normal.x * normal.x;
+        b2 += w * normal.y * normal.y;
+        c2 += w * normal.z * normal.z;
+        d2 += w * distance * distance;
+        ab += w * normal.x * normal.y;
+        ac += w * normal.x * normal.z;
+        ad += w * normal.x * distance;
+        bc += w * normal.y * normal.z;
+        bd += w * normal.y * distance;
+        cd += w * normal.z * distance;
+        weight += w;
+    }
+
+    void Add(const Quadric& other) {
+        a2 += other.a2; b2 += other.b2; c2 += other.c2; d2 += other.d2;
+        ab += other.ab; ac += other.ac; ad += other.ad;
+        bc += other.bc; bd += other.bd; cd += other.cd;
+        weight += other.weight;
+    }
+
+    double Error(const glm::vec3& position) const {
+        double x = position.x, y = position.y, z = position.z;
+        double error = a2 * x * x + b2 * y * y + c2 * z * z + d2
+            + 2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+        return weight > 0.0 ? std::abs(error) / weight : 0.0;
+    }
+};
+
+void MeshUtils::InterleaveAttributes(const AttributeStream& position, const AttributeStream& normal,
+    const AttributeStream& texcoord, size_t vertexCount, float* destination) {
+    size_t vertex = 0;
+
+#ifdef ISO_MESHUTILS_SSE2
+    bool floatStreams = position.data && normal.data && texcoord.data &&
+        position.componentType == GL_FLOAT && position.components >= 3 &&
+        normal.componentType == GL_FLOAT && normal.components >= 3 &&
+        texcoord.componentType == GL_FLOAT && texcoord.components >= 2;
+
+    if (floatStreams && vertexCount > 0) {
+        // The 4-wide loads read one float past each position and normal, so the last vertex is
+        // left to the scalar loop to stay inside the buffers
+        for (; vertex + 1 < vertexCount; ++vertex) {
+            __m128 p = _mm_loadu_ps(reinterpret_cast<const float*>(position.data + vertex * position.byteStride));
+            __m128 n = _mm_loadu_ps(reinterpret_cast<const float*>(normal.data + vertex * normal.byteStride));
+            __m128 uv = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(texcoord.data + vertex * texcoord.byteStride)));
+
+            // (px, py, pz, nx) and (ny, nz, u, v)
+            __m128 zx = _mm_shuffle_ps(p, n, _MM_SHUFFLE(0, 0, 2, 2));
+            _mm_storeu_ps(destination + vertex * FloatsPerVertex, _mm_shuffle_ps(p, zx, _MM_SHUFFLE(2, 0, 1, 0)));
+            _mm_storeu_ps(destination + vertex * FloatsPerVertex + 4, _mm_shuffle_ps(n, uv, _MM_SHUFFLE(1, 0, 2, 1)));
+        }
+    }
+#endif
+
+    for (; vertex < vertexCount; ++vertex) {
+        float* target = destination + vertex * FloatsPerVertex;
+        ReadAttribute(position, vertex, 3, target);
+
+        if (normal.data) {
+            ReadAttribute(normal, vertex, 3, target + 3);
+        }
+        else {
+            target[3] = 0.0f;
+            target[4] = 1.0f;
+            target[5] = 0.0f;
+        }
+
+        if (texcoord.data) {
+            ReadAttribute(texcoord, vertex, 2, target + 6);
+        }
+        else {
+            target[6] = 0.0f;
+            target[7] = 0.0f;
+        }
+    }
+}
+
+void MeshUtils::ReadAttribute(const AttributeStream& stream, size_t vertex, int components, float* destination) {
+    const unsigned char* element = stream.data + vertex * stream.byteStride;
+
+    if (stream.componentType == GL_FLOAT && stream.components >= components) {
+        std::memcpy(destination, element, components * sizeof(float));
+        return;
+    }
+
+    for (int c = 0; c < components; ++c) {
+        if (c >= stream.components) {
+            destination[c] = 0.0f;
+            continue;
+        }
+
+        switch (stream.componentType) {
+        case GL_FLOAT: {
+            std::memcpy(&destination[c], element + c * sizeof(float), sizeof(float));
+            break;
+        }
+        case GL_UNSIGNED_BYTE: {
+            float value = element[c];
+            destination[c] = stream.normalized ? value / 255.0f : value;
+            break;
+        }
+        case GL_BYTE: {
+            float value = static_cast<int8_t>(element[c]);
+            destination[c] = stream.normalized ? std::max(value / 127.0f, -1.0f) : value;
+            break;
+        }
+        case GL_UNSIGNED_SHORT: {
+            uint16_t value;
+            std::memcpy(&value, element + c * sizeof(value), sizeof(value));
+            destination[c] = stream.normalized ? value / 65535.0f : static_cast<float>(value);
+            break;
+        }
+        case GL_SHORT: {
+            int16_t value;
+            std::memcpy(&value, element + c * sizeof(value), sizeof(value));
+            destination[c] = stream.normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+            break;
+        }
+        default:
+            destination[c] = 0.0f;
+            break;
+        }
+    }
+}
+
+void MeshUtils::WidenIndices(const unsigned char* source, GLenum componentType, size_t count, unsigned int* destination) {
+    size_t i = 0;
+
+    if (componentType == GL_UNSIGNED_INT) {
+        std::memcpy(destination, source, count * sizeof(unsigned int));
+        return;
+    }
+
+    if (componentType == GL_UNSIGNED_BYTE) {
+        for (; i < count; ++i) {
+            destination[i] = source[i];
+        }
+        return;
+    }
+
+    if (componentType != GL_UNSIGNED_SHORT) {
+        std::fill(destination, destination + count, 0u);
+        return;
+    }
+
+#ifdef ISO_MESHUTILS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i shorts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * sizeof(uint16_t)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_unpacklo_epi16(shorts, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 4), _mm_unpackhi_epi16(shorts, zero));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        uint16_t value;
+        std::memcpy(&value, source + i * sizeof(value), sizeof(value));
+        destination[i] = value;
+    }
+}
+
+void MeshUtils::GenerateLods(const std::vector<float>& vertices, size_t floatsPerVertex,
+    std::vector<unsigned int>& indices, MeshPrimitive& mesh) {
+    // Every level targets half the triangles of the previous one and gives up once
+    // a collapse would move the surface further than this fraction of the bounding radius
+    const size_t minIndexCount = 3 * 64;
+    const double maxRelativeError = 0.1;
+
+    const size_t fullCount = indices.size();
+    mesh.lods[0] = { 0, static_cast<uint32_t>(fullCount), 0.0f };
+    mesh.lodCount = 1;
+
+    const size_t vertexCount = vertices.size() / floatsPerVertex;
+    if (fullCount < minIndexCount || vertexCount == 0 || mesh.bounds.radius <= 0.0f) {
+        return;
+    }
+
+    std::vector<glm::vec3> positions(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        std::memcpy(&positions[i], &vertices[i * floatsPerVertex], sizeof(glm::vec3));
+    }
+
+    std::vector<uint32_t> welded;
+    WeldPositions(positions, welded);
+
+    std::vector<uint8_t> locked;
+    LockBorders(welded, indices, locked);
+
+    // Quadrics live on the welded vertex so both sides of a seam see the same surface
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < fullCount; i += 3) {
+        glm::dvec3 p0(positions[indices[i + 0]]);
+        glm::dvec3 p1(positions[indices[i + 1]]);
+        glm::dvec3 p2(positions[indices[i + 2]]);
+
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+        if (length <= 0.0) continue;
+
+        normal /= length;
+        double distance = -glm::dot(normal, p0);
+        for (int corner = 0; corner < 3; ++corner) {
+            quadrics[welded[indices[i + corner]]].AddPlane(normal, distance, length * 0.5);
+        }
+    }
+
+    const double radius = mesh.bounds.radius;
+    const double maxError = (maxRelativeError * radius) * (maxRelativeError * radius);
+
+    std::vector<unsigned int> current(indices.begin(), indices.end());
+    double error = 0.0;
+
+    for (uint32_t level = 1; level < MeshPrimitive::MaxLods; ++level) {
+        size_t previousCount = current.size();
+        size_t target = (previousCount / 2) / 3 * 3;
+        if (target < minIndexCount / 2) break;
+
+        error = std::max(error, CollapseEdges(positions, welded, locked, quadrics, current, target, maxError));
+
+        // Locked borders or the error limit stopped the collapse early, a near copy is not worth the memory
+        if (current.size() > previousCount * 3 / 4) break;
+
+        MeshLod& lod = mesh.lods[level];
+        lod.firstIndex = static_cast<uint32_t>(indices.size());
+        lod.indexCount = static_cast<uint32_t>(current.size());
+        lod.error = static_cast<float>(std::sqrt(error) / radius);
+        indices.insert(indices.end(), current.begin(), current.end());
+        mesh.lodCount++;
+    }
+}
+
+void MeshUtils::WeldPositions(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& welded) {
+    // Vertices split at uv or normal seams share a position, map each one to the first copy
+    const size_t vertexCount = positions.size();
+
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&positions](uint32_t a, uint32_t b) {
+        const glm::vec3& pa = positions[a];
+        const glm::vec3& pb = positions[b];
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        return pa.z < pb.z;
+    });
+
+    welded.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        uint32_t vertex = order[i];
+        bool duplicate = i > 0 && positions[order[i - 1]] == positions[vertex];
+        welded[vertex] = duplicate ? welded[order[i - 1]] : vertex;
+    }
+}
+
+void MeshUtils::LockBorders(const std::vector<uint32_t>& welded, const std::vector<unsigned int>& indices,
+    std::vector<uint8_t>& locked) {
+    locked.assign(welded.size(), 0);
+
+    std::unordered_set<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        for (int corner = 0; corner < 3; ++corner) {
+            uint64_t a = welded[indices[i + corner]];
+            uint64_t b = welded[indices[i + (corner + 1) % 3]];
+            edges.insert((a << 32) | b);
+        }
+    }
+
+    // An edge without its reverse belongs to a single triangle, moving it would change the silhouette
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        for (int corner = 0; corner < 3; ++corner) {
+            uint64_t a = welded[indices[i + corner]];
+            uint64_t b = welded[indices[i + (corner + 1) % 3]];
+            if (edges.find((b << 32) | a) == edges.end()) {
+                locked[a] = 1;
+                locked[b] = 1;
+            }
+        }
+    }
+}
+
+double MeshUtils::CollapseEdges(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& welded,
+    const std::vector<uint8_t>& locked, std::vector<Quadric>& quadrics, std::vector<unsigned int>& indices,
+    size_t targetIndexCount, double maxError) {
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    const size_t vertexCount = positions.size();
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> offsets(vertexCount + 1);
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> fill;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<std::pair<uint32_t, uint32_t>> wedges;
+    double resultError = 0.0;
+
+    while (indices.size() > targetIndexCount) {
+        // Collapses run between welded vertices and always land on an existing endpoint,
+        // which keeps the vertex buffer shared by every level
+        collapses.clear();
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            for (int corner = 0; corner < 3; ++corner) {
+                uint32_t a = welded[indices[i + corner]];
+                uint32_t b = welded[indices[i + (corner + 1) % 3]];
+
+                // Interior edges show up once in each winding, only look at one of them
+                if (a >= b || (locked[a] && locked[b])) continue;
+
+                Quadric merged = quadrics[a];
+                merged.Add(quadrics[b]);
+
+                if (!locked[a]) collapses.push_back({ a, b, merged.Error(positions[b]) });
+                if (!locked[b]) collapses.push_back({ b, a, merged.Error(positions[a]) });
+            }
+        }
+
+        if (collapses.empty()) break;
+
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        // Triangles around each welded vertex. Indices past the last whole triangle are left out,
+        // the next pass drops them.
+        const size_t cornerCount = indices.size() / 3 * 3;
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (size_t i = 0; i < cornerCount; ++i) {
+            offsets[welded[indices[i]] + 1]++;
+        }
+        for (size_t i = 0; i < vertexCount; ++i) {
+            offsets[i + 1] += offsets[i];
+        }
+
+        triangles.resize(cornerCount);
+        fill.assign(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < cornerCount; ++i) {
+            triangles[fill[welded[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), 0);
+
+        // Each collapse removes about two triangles
+        size_t collapseLimit = (indices.size() - targetIndexCount) / 6 + 1;
+        size_t performed = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (collapse.cost > maxError || performed >= collapseLimit) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+            if (!MatchWedges(welded, indices, offsets, triangles, collapse.from, collapse.to, wedges)) continue;
+            if (CollapseFlips(positions, indices, offsets, triangles, collapse.from, wedges)) continue;
+
+            // Lock the one-ring so later collapses this pass see up to date topology
+            for (uint32_t t = offsets[collapse.from]; t < offsets[collapse.from + 1]; ++t) {
+                size_t triangle = static_cast<size_t>(triangles[t]) * 3;
+                touched[welded[indices[triangle + 0]]] = 1;
+                touched[welded[indices[triangle + 1]]] = 1;
+                touched[welded[indices[triangle + 2]]] = 1;
+            }
+            touched[collapse.to] = 1;
+
+            for (const auto& [from, to] : wedges) {
+                remap[from] = to;
+            }
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            resultError = std::max(resultError, collapse.cost);
+            performed++;
+        }
+
+        if (performed == 0) break;
+
+        size_t write = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            uint32_t a = remap[indices[i + 0]];
+            uint32_t b = remap[indices[i + 1]];
+            uint32_t c = remap[indices[i + 2]];
+            if (welded[a] == welded[b] || welded[b] == welded[c] || welded[a] == welded[c]) continue;
+
+            indices[write++] = a;
+            indices[write++] = b;
+            indices[write++] = c;
+        }
+        indices.resize(write);
+    }
+
+    return resultError;
+}
+
+bool MeshUtils::MatchWedges(const std::vector<uint32_t>& welded, const std::vector<unsigned int>& indices,
+    const std::vector<uint32_t>& offsets, const std::vector<uint32_t>& triangles, uint32_t from, uint32_t to,
+    std::vector<std::pair<uint32_t, uint32_t>>& wedges) {
+    // Every copy of the collapsed vertex has to move onto the copy of the target it shares
+    // a triangle with. A copy that touches none, or two different ones, sits across a uv
+    // or normal seam from the edge and collapsing it would smear its attributes.
+    wedges.clear();
+
+    for (uint32_t t = offsets[from]; t < offsets[from + 1]; ++t) {
+        size_t triangle = static_cast<size_t>(triangles[t]) * 3;
+
+        uint32_t source = 0;
+        uint32_t target = 0;
+        bool hasTarget = false;
+        for (int corner = 0; corner < 3; ++corner) {
+            uint32_t vertex = indices[triangle + corner];
+            if (welded[vertex] == from) source = vertex;
+            if (welded[vertex] == to) {
+                target = vertex;
+                hasTarget = true;
+            }
+        }
+
+        auto it = std::find_if(wedges.begin(), wedges.end(),
+            [source](const std::pair<uint32_t, uint32_t>& wedge) { return wedge.first == source; });
+        if (it == wedges.end()) {
+            wedges.push_back({ source, hasTarget ? target : UINT32_MAX });
+        }
+        else if (hasTarget) {
+            if (it->second != UINT32_MAX && it->second != target) return false;
+            it->second = target;
+        }
+    }
+
+    for (size_t i = 0; i < wedges.size(); ++i) {
+        if (wedges[i].second == UINT32_MAX) return false;
+
+        for (size_t j = 0; j < i; ++j) {
+            if (wedges[j].second == wedges[i].second) return false;
+        }
+    }
+    return !wedges.empty();
+}
+
+bool MeshUtils::CollapseFlips(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+    const std::vector<uint32_t>& offsets, const std::vector<uint32_t>& triangles, uint32_t from,
+    const std::vector<std::pair<uint32_t, uint32_t>>& wedges) {
+    for (uint32_t t = offsets[from]; t < offsets[from + 1]; ++t) {
+        size_t triangle = static_cast<size_t>(triangles[t]) * 3;
+        uint32_t corners[3] = { indices[triangle + 0], indices[triangle + 1], indices[triangle + 2] };
+        glm::vec3 before = glm::cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+
+        bool collapsesAway = false;
+        for (uint32_t& corner : corners) {
+            for (const auto& [source, target] : wedges) {
+                if (corner == source) {
+                    corner = target;
+                    break;
+                }
+            }
+        }
+        for (int corner = 0; corner < 3; ++corner) {
+            collapsesAway |= positions[corners[corner]] == positions[corners[(corner + 1) % 3]];
+        }
+
+        // Triangles on the collapsed edge disappear
+        if (collapsesAway) continue;
+
+        glm::vec3 after = glm::cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+
+        // Reject flips and slivers that turn the face more than ~75 degrees
+        if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MeshUtils::OptimizeMesh(std::vector<float>& vertices, size_t floatsPerVertex,
+    std::vector<unsigned int>& indices, MeshPrimitive& mesh) {
+    const size_t vertexCount = vertices.size() / floatsPerVertex;
+    if (vertexCount == 0 || indices.empty()) return;
+
+    if (mesh.lodCount == 0) {
+        mesh.lods[0] = { 0, static_cast<uint32_t>(indices.size()), 0.0f };
+        mesh.lodCount = 1;
+    }
+
+    // Every pass indexes per-vertex arrays, an index past the vertices leaves the mesh as it is
+    if (std::any_of(indices.begin(), indices.end(), [vertexCount](unsigned int index) { return index >= vertexCount; })) {
+        return;
+    }
+
+    AnalyzeVertexCache(&indices[mesh.lods[0].firstIndex], mesh.lods[0].indexCount,
+        mesh.cacheStats.acmrBefore, mesh.cacheStats.atvrBefore);
+
+    std::vector<uint32_t> clusters;
+    for (uint32_t i = 0; i < mesh.lodCount; ++i) {
+        unsigned int* lodIndices = &indices[mesh.lods[i].firstIndex];
+        OptimizeVertexCache(lodIndices, mesh.lods[i].indexCount, vertexCount, clusters);
+        OptimizeOverdraw(vertices, floatsPerVertex, lodIndices, mesh.lods[i].indexCount, clusters);
+    }
+
+    // Runs last so vertices are numbered in the order LOD 0 first touches them
+    OptimizeVertexFetch(vertices, floatsPerVertex, indices);
+
+    AnalyzeVertexCache(&indices[mesh.lods[0].firstIndex], mesh.lods[0].indexCount,
+        mesh.cacheStats.acmrAfter, mesh.cacheStats.atvrAfter);
+}
+
+void MeshUtils::PackVertices(const std::vector<float>& vertices, size_t floatsPerVertex,
+    std::vector<uint8_t>& packed, MeshPrimitive& mesh) {
+    const size_t vertexCount = vertices.size() / floatsPerVertex;
+    const size_t stride = VertexLayout::Compact().stride;
+    packed.assign(vertexCount * stride, 0);
+    if (vertexCount == 0) return;
+
+    // The exact extent of the vertices, accessor min/max may be padded or missing
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < vertexCount; ++i) {
+        glm::vec3 position(vertices[i * floatsPerVertex + 0], vertices[i * floatsPerVertex + 1], vertices[i * floatsPerVertex + 2]);
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+
+    glm::vec3 extent = max - min;
+    glm::vec3 quantize(
+        extent.x > 0.0f ? 65535.0f / extent.x : 0.0f,
+        extent.y > 0.0f ? 65535.0f / extent.y : 0.0f,
+        extent.z > 0.0f ? 65535.0f / extent.z : 0.0f);
+
+    mesh.quantizationOffset = min;
+    mesh.quantizationScale = extent;
+
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* source = &vertices[i * floatsPerVertex];
+        uint8_t* target = &packed[i * stride];
+
+        uint16_t position[4] = { 0, 0, 0, 0 };
+        for (int axis = 0; axis < 3; ++axis) {
+            float q = (source[axis] - min[axis]) * quantize[axis] + 0.5f;
+            position[axis] = static_cast<uint16_t>(std::clamp(q, 0.0f, 65535.0f));
+        }
+        std::memcpy(target, position, sizeof(position));
+
+        // snorm 10:10:10:2 with x in the low bits, matching GL_INT_2_10_10_10_REV
+        glm::vec3 normal(source[3], source[4], source[5]);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            normal /= length;
+        }
+        uint32_t packedNormal = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            int32_t component = static_cast<int32_t>(std::round(std::clamp(normal[axis], -1.0f, 1.0f) * 511.0f));
+            packedNormal |= (static_cast<uint32_t>(component) & 0x3FFu) << (axis * 10);
+        }
+        std::memcpy(target + 8, &packedNormal, sizeof(packedNormal));
+
+        uint32_t uv = glm::packHalf2x16(glm::vec2(source[6], source[7]));
+        std::memcpy(target + 12, &uv, sizeof(uv));
+    }
+}
+
+void MeshUtils::PackIndices(const std::vector<unsigned int>& indices, size_t vertexCount,
+    std::vector<uint8_t>& packed, MeshPrimitive& mesh) {
+    if (vertexCount <= 65536) {
+        mesh.indexType = GL_UNSIGNED_SHORT;
+        packed.resize(indices.size() * sizeof(uint16_t));
+        uint16_t* target = reinterpret_cast<uint16_t*>(packed.data());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            target[i] = static_cast<uint16_t>(indices[i]);
+        }
+    }
+    else {
+        mesh.indexType = GL_UNSIGNED_INT;
+        packed.resize(indices.size() * sizeof(unsigned int));
+        std::memcpy(packed.data(), indices.data(), packed.size());
+    }
+}
+
+void MeshUtils::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, float& acmr, float& atvr) {
+    acmr = atvr = 0.0f;
+    if (indexCount < 3) return;
+
+    uint32_t cache[VertexCacheSize];
+    size_t cacheCount = 0;
+    size_t cacheHead = 0;
+    size_t misses = 0;
+    std::unordered_set<uint32_t> unique;
+
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t vertex = indices[i];
+        unique.insert(vertex);
+
+        if (std::find(cache, cache + cacheCount, vertex) != cache + cacheCount) continue;
+
+        misses++;
+        if (cacheCount < VertexCacheSize) {
+            cache[cacheCount++] = vertex;
+        }
+        else {
+            cache[cacheHead] = vertex;
+            cacheHead = (cacheHead + 1) % VertexCacheSize;
+        }
+    }
+
+    acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+    atvr = static_cast<float>(misses) / static_cast<float>(unique.size());
+}
+
+void MeshUtils::OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount,
+    std::vector<uint32_t>& clusters) {
+    // Forsyth's linear speed vertex cache optimisation: greedily emit the triangle whose vertices
+    // score best, favouring recently used vertices and vertices with few triangles left.
+    // Restarts after a dead end are recorded in clusters for the overdraw pass. Indices past the
+    // last whole triangle stay where they are.
+    const size_t triangleCount = indexCount / 3;
+    const size_t cornerCount = triangleCount * 3;
+    clusters.clear();
+    if (triangleCount == 0) return;
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < cornerCount; ++i) {
+        offsets[indices[i] + 1]++;
+    }
+    for (size_t i = 0; i < vertexCount; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    // Each vertex's slice lists its triangles not yet emitted first, live[v] of them
+    std::vector<uint32_t> live(vertexCount, 0);
+    std::vector<uint32_t> adjacency(cornerCount);
+    for (size_t i = 0; i < cornerCount; ++i) {
+        uint32_t vertex = indices[i];
+        adjacency[offsets[vertex] + live[vertex]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    // The last triangle's vertices share a flat score so its neighbours are not favoured over strips
+    float cacheScores[VertexCacheSize];
+    for (uint32_t i = 0; i < VertexCacheSize; ++i) {
+        cacheScores[i] = i < 3 ? 0.75f
+            : std::pow(1.0f - static_cast<float>(i - 3) / static_cast<float>(VertexCacheSize - 3), 1.5f);
+    }
+
+    float valenceScores[32];
+    for (uint32_t i = 1; i < 32; ++i) {
+        valenceScores[i] = 2.0f / std::sqrt(static_cast<float>(i));
+    }
+
+    auto vertexScore = [&](int cachePosition, uint32_t vertex) {
+        uint32_t remaining = live[vertex];
+        if (remaining == 0) return -1.0f;
+
+        float score = cachePosition >= 0 ? cacheScores[cachePosition] : 0.0f;
+        return score + (remaining < 32 ? valenceScores[remaining] : 2.0f / std::sqrt(static_cast<float>(remaining)));
+    };
+
+    std::vector<float> scores(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        scores[i] = vertexScore(-1, static_cast<uint32_t>(i));
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScores[t] = scores[indices[t * 3 + 0]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<unsigned int> output;
+    output.reserve(cornerCount);
+
+    uint32_t cache[VertexCacheSize + 3];
+    uint32_t nextCache[VertexCacheSize + 3];
+    size_t cacheCount = 0;
+    size_t restartCursor = 0;
+    size_t best = SIZE_MAX;
+
+    while (output.size() < cornerCount) {
+        if (best == SIZE_MAX) {
+            while (emitted[restartCursor]) {
+                restartCursor++;
+            }
+            best = restartCursor;
+            clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+        }
+
+        const uint32_t* triangle = &indices[best * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+        emitted[best] = 1;
+
+        for (int corner = 0; corner < 3; ++corner) {
+            uint32_t vertex = triangle[corner];
+            uint32_t* begin = &adjacency[offsets[vertex]];
+            uint32_t* end = begin + live[vertex];
+            uint32_t* it = std::find(begin, end, static_cast<uint32_t>(best));
+            if (it != end) {
+                std::swap(*it, *(end - 1));
+                live[vertex]--;
+            }
+        }
+
+        // Move the emitted vertices to the front, the cache keeps VertexCacheSize + 3 entries
+        // so vertices pushed out this step still get their scores updated
+        size_t nextCount = 0;
+        for (int corner = 0; corner < 3; ++corner) {
+            nextCache[nextCount++] = triangle[corner];
+        }
+        for (size_t i = 0; i < cacheCount; ++i) {
+            uint32_t vertex = cache[i];
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2] && nextCount < VertexCacheSize + 3) {
+                nextCache[nextCount++] = vertex;
+            }
+        }
+
+        std::copy(nextCache, nextCache + nextCount, cache);
+        cacheCount = std::min<size_t>(nextCount, VertexCacheSize);
+
+        for (size_t i = 0; i < nextCount; ++i) {
+            uint32_t vertex = cache[i];
+            int position = i < VertexCacheSize ? static_cast<int>(i) : -1;
+            float delta = vertexScore(position, vertex) - scores[vertex];
+            scores[vertex] += delta;
+
+            for (uint32_t a = 0; a < live[vertex]; ++a) {
+                triangleScores[adjacency[offsets[vertex] + a]] += delta;
+            }
+        }
+
+        best = SIZE_MAX;
+        float bestScore = 0.0f;
+        for (size_t i = 0; i < cacheCount; ++i) {
+            uint32_t vertex = cache[i];
+            for (uint32_t a = 0; a < live[vertex]; ++a) {
+                uint32_t t = adjacency[offsets[vertex] + a];
+                if (triangleScores[t] > bestScore || (triangleScores[t] == bestScore && t < best)) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshUtils::OptimizeOverdraw(const std::vector<float>& vertices, size_t floatsPerVertex,
+    unsigned int* indices, size_t indexCount, const std::vector<uint32_t>& clusters) {
+    // Clusters start where the cache optimiser hit a dead end, so drawing them in any order
+    // costs next to nothing in cache misses. Clusters on the outside of the mesh facing
+    // away from its centre are the likeliest occluders and go first (Sander et al., Tipsify).
+    const size_t triangleCount = indexCount / 3;
+    if (clusters.size() < 2) return;
+
+    auto position = [&vertices, floatsPerVertex](uint32_t vertex) {
+        const float* p = &vertices[static_cast<size_t>(vertex) * floatsPerVertex];
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    glm::dvec3 meshCenter(0.0);
+    double meshArea = 0.0;
+    std::vector<glm::dvec3> centers(clusters.size(), glm::dvec3(0.0));
+    std::vector<glm::dvec3> normals(clusters.size(), glm::dvec3(0.0));
+    std::vector<double> areas(clusters.size(), 0.0);
+
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        for (size_t t = clusters[c]; t < end; ++t) {
+            glm::dvec3 p0(position(indices[t * 3 + 0]));
+            glm::dvec3 p1(position(indices[t * 3 + 1]));
+            glm::dvec3 p2(position(indices[t * 3 + 2]));
+
+            glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+            double area = glm::length(normal);
+
+            centers[c] += (p0 + p1 + p2) * (area / 3.0);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+
+        meshCenter += centers[c];
+        meshArea += areas[c];
+    }
+
+    if (meshArea <= 0.0) return;
+    meshCenter /= meshArea;
+
+    std::vector<double> keys(clusters.size(), 0.0);
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        double normalLength = glm::length(normals[c]);
+        if (areas[c] <= 0.0 || normalLength <= 0.0) continue;
+
+        keys[c] = glm::dot(centers[c] / areas[c] - meshCenter, normals[c] / normalLength);
+    }
+
+    std::vector<uint32_t> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+    // Only whole triangles are reordered, indices past them stay where they are
+    std::vector<unsigned int> sorted;
+    sorted.reserve(triangleCount * 3);
+    for (uint32_t c : order) {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        sorted.insert(sorted.end(), indices + static_cast<size_t>(clusters[c]) * 3, indices + end * 3);
+    }
+
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+void MeshUtils::OptimizeVertexFetch(std::vector<float>& vertices, size_t floatsPerVertex,
+    std::vector<unsigned int>& indices) {
+    // Number vertices in the order the index buffer first touches them so fetches walk
+    // memory forwards; vertices no index refers to are dropped. Every index is renumbered, those
+    // past the last whole triangle included, or they would point at the old numbering.
+    const size_t vertexCount = vertices.size() / floatsPerVertex;
+    if (std::any_of(indices.begin(), indices.end(), [vertexCount](unsigned int index) { return index >= vertexCount; })) {
+        return;
+    }
+
+    std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    uint32_t next = 0;
+
+    for (unsigned int& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    std::vector<float> reordered(static_cast<size_t>(next) * floatsPerVertex);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        if (remap[i] == UINT32_MAX) continue;
+
+        std::memcpy(&reordered[static_cast<size_t>(remap[i]) * floatsPerVertex],
+            &vertices[i * floatsPerVertex], floatsPerVertex * sizeof(float));
+    }
+
+    vertices.swap(reordered);
+}
\ No newline at end of file
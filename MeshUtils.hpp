@@ -0,0 +1,88 @@
+#pragma once
+
+#include "MeshPrimitive.hpp"
+#include <utility>
+#include <vector>
+
+namespace tinygltf {
+    struct Accessor;
+}
+
+// A vertex attribute as laid out in its source buffer. componentType uses the GL enums, which
+// are also glTF's. A stream without data reads as the attribute's default value.
+struct AttributeStream {
+    const unsigned char* data = nullptr;
+    size_t byteStride = 0;
+    GLenum componentType = GL_FLOAT;
+    int components = 0;
+    bool normalized = false;
+};
+
+class MeshUtils {
+public:
+    // The glTF loaders build position/normal/uv as 8 interleaved floats before packing
+    static constexpr size_t FloatsPerVertex = 8;
+
+    // Uses the accessor's min/max when the exporter wrote them, scans the positions otherwise
+    static MeshBounds ComputeBounds(const tinygltf::Accessor& posAccessor, const unsigned char* posData, size_t byteStride);
+
+    // Writes position, normal and uv as FloatsPerVertex interleaved floats per vertex in a single
+    // pass. Float streams of any stride take an SSE path, other component types are converted
+    // per component. Missing normals default to +Y and missing uvs to zero.
+    static void InterleaveAttributes(const AttributeStream& position, const AttributeStream& normal,
+        const AttributeStream& texcoord, size_t vertexCount, float* destination);
+
+    // Widens 8, 16 or 32-bit indices to 32 bits
+    static void WidenIndices(const unsigned char* source, GLenum componentType, size_t count, unsigned int* destination);
+
+    // Appends up to MaxLods - 1 simplified index lists after the full one and records their
+    // ranges (relative to the start of indices) in mesh.lods. Every level reuses the same vertices.
+    static void GenerateLods(const std::vector<float>& vertices, size_t floatsPerVertex,
+        std::vector<unsigned int>& indices, MeshPrimitive& mesh);
+
+    // Reorders the triangles of every LOD for the post-transform cache, sorts the resulting
+    // clusters so outward facing ones draw first, then renumbers vertices in first use order.
+    // Fills mesh.cacheStats. The output only depends on the input, so repeated imports match.
+    static void OptimizeMesh(std::vector<float>& vertices, size_t floatsPerVertex,
+        std::vector<unsigned int>& indices, MeshPrimitive& mesh);
+
+    // Packs interleaved float vertices into VertexLayout::Compact(). Positions are quantised
+    // to the min/max of the vertices, which are written to mesh.quantizationOffset/Scale.
+    static void PackVertices(const std::vector<float>& vertices, size_t floatsPerVertex,
+        std::vector<uint8_t>& packed, MeshPrimitive& mesh);
+
+    // Stores the indices as 16-bit whenever vertexCount allows and sets mesh.indexType to match.
+    // Indices are relative to baseVertex, so any mesh under 64K vertices fits.
+    static void PackIndices(const std::vector<unsigned int>& indices, size_t vertexCount,
+        std::vector<uint8_t>& packed, MeshPrimitive& mesh);
+
+    // Simulates a FIFO cache of VertexCacheSize entries
+    static void AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, float& acmr, float& atvr);
+
+    static constexpr uint32_t VertexCacheSize = 16;
+
+private:
+    struct Quadric;
+
+    static void ReadAttribute(const AttributeStream& stream, size_t vertex, int components, float* destination);
+
+    static void WeldPositions(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& welded);
+    static void LockBorders(const std::vector<uint32_t>& welded, const std::vector<unsigned int>& indices,
+        std::vector<uint8_t>& locked);
+    static double CollapseEdges(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& welded,
+        const std::vector<uint8_t>& locked, std::vector<Quadric>& quadrics, std::vector<unsigned int>& indices,
+        size_t targetIndexCount, double maxError);
+    static bool MatchWedges(const std::vector<uint32_t>& welded, const std::vector<unsigned int>& indices,
+        const std::vector<uint32_t>& offsets, const std::vector<uint32_t>& triangles, uint32_t from, uint32_t to,
+        std::vector<std::pair<uint32_t, uint32_t>>& wedges);
+    static bool CollapseFlips(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+        const std::vector<uint32_t>& offsets, const std::vector<uint32_t>& triangles, uint32_t from,
+        const std::vector<std::pair<uint32_t, uint32_t>>& wedges);
+
+    static void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount,
+        std::vector<uint32_t>& clusters);
+    static void OptimizeOverdraw(const std::vector<float>& vertices, size_t floatsPerVertex,
+        unsigned int* indices, size_t indexCount, const std::vector<uint32_t>& clusters);
+    static void OptimizeVertexFetch(std::vector<float>& vertices, size_t floatsPerVertex,
+        std::vector<unsigned int>& indices);
+};
\ No newline at end of file
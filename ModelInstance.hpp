@@ -1,9 +1,9 @@
 #pragma once
 
-#include "MeshPrimitive.hpp"
+#include "ResourceHandle.hpp"
 #include <glm/glm.hpp>
 
 struct ModelInstance {
     glm::mat4 transform;
-    MeshPrimitive* mesh;
+    MeshHandle mesh;
 };
\ No newline at end of file
@@ -44,15 +44,15 @@ void PhysicsSystem::Shutdown() {
     isInitialized = false;
 }
 
-bool PhysicsSystem::CreateRigidBody(const std::string& objectId, const glm::vec3& position,
+bool PhysicsSystem::CreateRigidBody(entt::entity entity, const glm::vec3& position,
     const glm::vec3& rotation, const glm::vec3& shapeSize,
     float mass, bool isStatic) {
     if (!isInitialized || !physicsWorld) {
         return false;
     }
 
-    if (physicsBodies.find(objectId) != physicsBodies.end()) {
-        RemoveRigidBody(objectId);
+    if (physicsBodies.contains(entity)) {
+        RemoveRigidBody(entity);
     }
 
     glm::quat quat = glm::quat(rotation);
@@ -89,53 +89,66 @@ bool PhysicsSystem::CreateRigidBody(const std::string& objectId, const glm::vec3
     physicsBody.collider = collider;
     physicsBody.shapeSize = shapeSize;
 
-    physicsBodies[objectId] = physicsBody;
+    physicsBodies.emplace(entity, physicsBody);
     return true;
 }
 
-bool PhysicsSystem::RemoveRigidBody(const std::string& objectId) {
-    auto it = physicsBodies.find(objectId);
-    if (it == physicsBodies.end()) {
+bool PhysicsSystem::RemoveRigidBody(entt::entity entity) {
+    if (!physicsBodies.contains(entity)) {
         return false;
     }
 
-    if (it->second.body) {
-        physicsWorld->destroyRigidBody(it->second.body);
+    PhysicsBody& physicsBody = physicsBodies.get(entity);
+    if (physicsBody.body) {
+        physicsWorld->destroyRigidBody(physicsBody.body);
     }
 
-    physicsBodies.erase(it);
+    physicsBodies.erase(entity);
     return true;
 }
 
+// Bodies live in world space while a child's transform is relative to its parent, attached
+// objects just follow their parent
+static bool HasParent(const entt::registry& registry, entt::entity entity) {
+    const HierarchyComponent* hierarchy = registry.try_get<HierarchyComponent>(entity);
+    return hierarchy && hierarchy->parent != entt::null;
+}
+
 void PhysicsSystem::SyncPhysicsToScene(Scene& scene) {
-    for (const auto& [objectId, physicsBody] : physicsBodies) {
+    entt::registry& registry = scene.GetRegistry();
+
+    // Bodies are packed, transforms are looked up through the registry's sparse index
+    for (auto [entity, physicsBody] : physicsBodies.each()) {
         if (!physicsBody.body) continue;
 
-        SceneObject* sceneObject = scene.GetObject(objectId);
-        if (!sceneObject) continue;
+        TransformComponent* sceneTransform = registry.valid(entity) ? registry.try_get<TransformComponent>(entity) : nullptr;
+        if (!sceneTransform || HasParent(registry, entity)) continue;
 
         reactphysics3d::Transform transform = physicsBody.body->getTransform();
         reactphysics3d::Vector3 pos = transform.getPosition();
         reactphysics3d::Quaternion rot = transform.getOrientation();
 
-        sceneObject->position = glm::vec3(pos.x, pos.y, pos.z);
+        sceneTransform->position = glm::vec3(pos.x, pos.y, pos.z);
 
         glm::quat glmQuat(rot.w, rot.x, rot.y, rot.z);
-        sceneObject->rotation = glm::eulerAngles(glm::normalize(glmQuat));
+        sceneTransform->rotation = glm::eulerAngles(glm::normalize(glmQuat));
+        scene.MarkTransformDirty(entity);
     }
 }
 
 void PhysicsSystem::SyncSceneToPhysics(const Scene& scene) {
-    for (const auto& [objectId, physicsBody] : physicsBodies) {
+    const entt::registry& registry = scene.GetRegistry();
+
+    for (auto [entity, physicsBody] : physicsBodies.each()) {
         if (!physicsBody.body) continue;
 
-        const SceneObject* sceneObject = scene.GetObject(objectId);
-        if (!sceneObject) continue;
+        const TransformComponent* sceneTransform = registry.valid(entity) ? registry.try_get<TransformComponent>(entity) : nullptr;
+        if (!sceneTransform || HasParent(registry, entity)) continue;
 
         if (physicsBody.body->getType() == reactphysics3d::BodyType::STATIC) {
-            glm::quat quat = glm::quat(sceneObject->rotation);
+            glm::quat quat = glm::quat(sceneTransform->rotation);
             reactphysics3d::Transform transform(
-                reactphysics3d::Vector3(sceneObject->position.x, sceneObject->position.y, sceneObject->position.z),
+                reactphysics3d::Vector3(sceneTransform->position.x, sceneTransform->position.y, sceneTransform->position.z),
                 reactphysics3d::Quaternion(quat.x, quat.y, quat.z, quat.w)
             );
             physicsBody.body->setTransform(transform);
@@ -149,26 +162,25 @@ void PhysicsSystem::SetGravity(const glm::vec3& gravity) {
     }
 }
 
-void PhysicsSystem::SetObjectMass(const std::string& objectId, float mass) {
-    auto it = physicsBodies.find(objectId);
-    if (it != physicsBodies.end() && it->second.body) {
-        it->second.body->setMass(mass);
+void PhysicsSystem::SetObjectMass(entt::entity entity, float mass) {
+    PhysicsBody* physicsBody = GetPhysicsBody(entity);
+    if (physicsBody && physicsBody->body) {
+        physicsBody->body->setMass(mass);
     }
 }
 
-void PhysicsSystem::SetObjectStatic(const std::string& objectId, bool isStatic) {
-    auto it = physicsBodies.find(objectId);
-    if (it != physicsBodies.end() && it->second.body) {
+void PhysicsSystem::SetObjectStatic(entt::entity entity, bool isStatic) {
+    PhysicsBody* physicsBody = GetPhysicsBody(entity);
+    if (physicsBody && physicsBody->body) {
         if (isStatic) {
-            it->second.body->setType(reactphysics3d::BodyType::STATIC);
+            physicsBody->body->setType(reactphysics3d::BodyType::STATIC);
         }
         else {
-            it->second.body->setType(reactphysics3d::BodyType::DYNAMIC);
+            physicsBody->body->setType(reactphysics3d::BodyType::DYNAMIC);
         }
     }
 }
 
-PhysicsBody* PhysicsSystem::GetPhysicsBody(const std::string& objectId) {
-    auto it = physicsBodies.find(objectId);
-    return (it != physicsBodies.end()) ? &it->second : nullptr;
+PhysicsBody* PhysicsSystem::GetPhysicsBody(entt::entity entity) {
+    return physicsBodies.contains(entity) ? &physicsBodies.get(entity) : nullptr;
 }
\ No newline at end of file
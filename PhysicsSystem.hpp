@@ -2,11 +2,9 @@
 
 #include <reactphysics3d/reactphysics3d.h>
 #include <glm/glm.hpp>
-#include <unordered_map>
-#include <string>
+#include <entt/entity/storage.hpp>
 
 class Scene;
-struct SceneObject;
 
 struct PhysicsBody {
     reactphysics3d::RigidBody* body = nullptr;
@@ -23,25 +21,26 @@ public:
     void Update(float deltaTime);
     void Shutdown();
 
-    bool CreateRigidBody(const std::string& objectId, const glm::vec3& position,
+    // Bodies belong to scene entities. Sync skips bodies whose entity has been destroyed.
+    bool CreateRigidBody(entt::entity entity, const glm::vec3& position,
         const glm::vec3& rotation, const glm::vec3& shapeSize,
         float mass, bool isStatic = false);
 
-    bool RemoveRigidBody(const std::string& objectId);
+    bool RemoveRigidBody(entt::entity entity);
 
     void SyncPhysicsToScene(Scene& scene);
     void SyncSceneToPhysics(const Scene& scene);
 
     void SetGravity(const glm::vec3& gravity);
-    void SetObjectMass(const std::string& objectId, float mass);
-    void SetObjectStatic(const std::string& objectId, bool isStatic);
+    void SetObjectMass(entt::entity entity, float mass);
+    void SetObjectStatic(entt::entity entity, bool isStatic);
 
-    PhysicsBody* GetPhysicsBody(const std::string& objectId);
+    PhysicsBody* GetPhysicsBody(entt::entity entity);
 
 private:
     reactphysics3d::PhysicsCommon physicsCommon;
     reactphysics3d::PhysicsWorld* physicsWorld;
-    std::unordered_map<std::string, PhysicsBody> physicsBodies;
+    entt::storage<PhysicsBody> physicsBodies;
 
     bool isInitialized;
 };
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "RenderQueue.hpp"
+
+#include <cassert>
+#include <cstring>
+
+uint64_t RenderQueue::MakeKey(uint8_t pass, uint32_t shader, uint32_t texture, uint32_t vao, bool shortIndices, uint32_t mesh, float viewDepth) {
+    // Non-negative IEEE floats order the same as their bit patterns, so the exponent and the top
+    // two mantissa bits give a range-free depth that sorts front to back in quarter octaves
+    if (!(viewDepth > 0.0f)) viewDepth = 0.0f;
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+
+    // Wider values would spill into the fields above and break up instanced runs
+    assert(texture < (1u << TextureBits) && mesh < (1u << MeshBits));
+
+    return (static_cast<uint64_t>(pass & 0xF) << 60)
+        | (static_cast<uint64_t>(shader & 0xFF) << 52)
+        | (static_cast<uint64_t>(texture & 0xFFF) << 40)
+        | (static_cast<uint64_t>(vao & 0x7F) << 33)
+        | (static_cast<uint64_t>(shortIndices ? 1 : 0) << 32)
+        | (static_cast<uint64_t>(mesh & 0x3FFFFF) << 10)
+        | static_cast<uint64_t>((depthBits >> 21) & 0x3FF);
+}
+
+void RenderQueue::Clear() {
+    packets.clear();
+}
+
+uint32_t RenderQueue::Push(uint64_t key, MeshHandle mesh, uint32_t lod) {
+    DrawPacket packet;
+    packet.key = key;
+    packet.mesh = mesh;
+    packet.lod = lod;
+    packet.instance = static_cast<uint32_t>(packets.size());
+    packets.push_back(packet);
+    return packet.instance;
+}
+
+void RenderQueue::Sort() {
+    const size_t count = packets.size();
+    if (count < 2) return;
+
+    scratch.resize(count);
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (const auto& packet : packets) {
+            histogram[(packet.key >> shift) & 0xFF]++;
+        }
+
+        // All keys share this byte, the pass would not move anything
+        if (histogram[(packets[0].key >> shift) & 0xFF] == count) continue;
+
+        size_t offset = 0;
+        for (size_t& bucket : histogram) {
+            size_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+
+        for (const auto& packet : packets) {
+            scratch[histogram[(packet.key >> shift) & 0xFF]++] = packet;
+        }
+
+        packets.swap(scratch);
+    }
+}
\ No newline at end of file
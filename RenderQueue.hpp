@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ResourceHandle.hpp"
+#include <cstdint>
+#include <vector>
+
+// Sort key layout, most significant first:
+//   pass (4) | shader (8) | texture (12) | vao (7) | index type (1) | mesh and lod (22) | depth (10)
+// Packets that share everything above depth form one instanced draw.
+struct DrawPacket {
+    uint64_t key = 0;
+    MeshHandle mesh;
+    uint32_t instance = 0;
+    uint32_t lod = 0;
+};
+
+class RenderQueue {
+public:
+    enum Pass : uint8_t {
+        PassOpaque = 0,
+        PassTransparent = 1
+    };
+
+    static constexpr uint32_t TextureBits = 12;
+    static constexpr uint32_t MeshBits = 22;
+
+    static uint64_t MakeKey(uint8_t pass, uint32_t shader, uint32_t texture, uint32_t vao, bool shortIndices, uint32_t mesh, float viewDepth);
+
+    void Clear();
+    uint32_t Push(uint64_t key, MeshHandle mesh, uint32_t lod = 0);
+
+    // Stable LSD radix sort on the 64-bit keys, skipping byte passes where every key agrees
+    void Sort();
+
+    const std::vector<DrawPacket>& GetPackets() const { return packets; }
+    size_t Size() const { return packets.size(); }
+
+private:
+    std::vector<DrawPacket> packets;
+    std::vector<DrawPacket> scratch;
+};
\ No newline at end of file
@@ -1,7 +1,18 @@
 #include "Renderer.hpp"
+#include "ResourceManager.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Every mesh handle and LOD, and every texture slot, has to fit its field of the sort key
+static_assert(uint64_t(MeshHandle::IndexMask + 1) * MeshPrimitive::MaxLods <= (1ull << RenderQueue::MeshBits),
+    "mesh handles do not fit the render queue key");
+static_assert(ResourceManager::MaxTextures <= (1u << RenderQueue::TextureBits),
+    "texture slots do not fit the render queue key");
+
 Renderer::Renderer()
     : projectionMatrix(1.0f)
     , lightPos(0.0f, 2.0f, 2.0f)
@@ -10,11 +21,55 @@ Renderer::Renderer()
 }
 
 Renderer::~Renderer() {
+    if (instanceVBO != 0) {
+        glDeleteBuffers(1, &instanceVBO);
+    }
+    if (frameUBO != 0) {
+        glDeleteBuffers(1, &frameUBO);
+    }
+    if (indirectBuffer != 0) {
+        glDeleteBuffers(1, &indirectBuffer);
+    }
+    if (instanceIndexVBO != 0) {
+        glDeleteBuffers(1, &instanceIndexVBO);
+    }
+    if (timerQueries[0] != 0) {
+        glDeleteQueries(2, timerQueries);
+    }
+    indirectShader.Delete();
     shader.Delete();
 }
 
 bool Renderer::Initialize() {
-    return shader.CreateFromSource(GetVertexShaderSource(), GetFragmentShaderSource());
+    glGenBuffers(1, &instanceVBO);
+    glGenQueries(2, timerQueries);
+
+    glGenBuffers(1, &frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, Shader::FrameDataBinding, frameUBO);
+
+    if (!shader.CreateFromSource(GetVertexShaderSource(), GetFragmentShaderSource())) {
+        return false;
+    }
+
+    shader.Use();
+    shader.SetInt(Shader::HashName("baseColorTexture"), 0);
+
+    indirectSupported = GLAD_GL_VERSION_4_3
+        && indirectShader.CreateFromSource(GetIndirectVertexShaderSource(), GetFragmentShaderSource());
+
+    if (indirectSupported) {
+        glGenBuffers(1, &indirectBuffer);
+        glGenBuffers(1, &instanceIndexVBO);
+
+        indirectShader.Use();
+        indirectShader.SetInt(Shader::HashName("baseColorTexture"), 0);
+    }
+
+    glUseProgram(0);
+    return true;
 }
 
 void Renderer::SetProjectionMatrix(const glm::mat4& projection) {
@@ -26,41 +81,365 @@ void Renderer::SetLightProperties(const glm::vec3& position, const glm::vec3& co
     lightColor = color;
 }
 
+void Renderer::BeginFrame(const ICamera& camera) {
+    frameActive = true;
+    frameCameraPos = camera.GetPosition();
+    frameCameraDir = camera.GetDirection();
+    ReadGpuTimer();
+    stats = RenderStats{};
+    stats.gpuTimeMs = lastGpuTimeMs;
+
+    FrameUniforms frame;
+    frame.view = camera.GetViewMatrix();
+    frame.projection = projectionMatrix;
+    frame.cameraPosition = glm::vec4(camera.GetPosition(), 1.0f);
+    frame.lightPosition = glm::vec4(lightPos, 1.0f);
+    frame.lightColor = glm::vec4(lightColor, 1.0f);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, Shader::FrameDataBinding, frameUBO);
+
+    queue.Clear();
+    submittedInstances.clear();
+}
+
+void Renderer::Submit(const std::vector<ModelInstance>& instances, const glm::mat4& modelTransform) {
+    for (const auto& instance : instances) {
+        Submit(instance.mesh, modelTransform * instance.transform);
+    }
+}
+
+void Renderer::Submit(MeshHandle handle, const glm::mat4& transform, uint8_t* lodState) {
+    const MeshPrimitive* mesh = ResourceManager::GetMesh(handle);
+    if (!mesh || mesh->indexCount == 0) return;
+
+    const Shader& activeShader = IsIndirectEnabled() ? indirectShader : shader;
+    uint32_t lod = SelectLod(*mesh, transform, lodState);
+
+    // Each level is its own index range, so it gets its own slot in the mesh part of the key.
+    // Handle indices are dense, so they serve as the mesh id directly.
+    float viewDepth = glm::dot(glm::vec3(transform[3]) - frameCameraPos, frameCameraDir);
+    queue.Push(RenderQueue::MakeKey(RenderQueue::PassOpaque, activeShader.GetID(), mesh->textureSlot,
+        ResourceManager::GetGeometryVAO(), mesh->indexType == GL_UNSIGNED_SHORT,
+        handle.GetIndex() * MeshPrimitive::MaxLods + lod, viewDepth), handle, lod);
+
+    stats.triangles += mesh->lods[lod].indexCount / 3;
+    stats.fullDetailTriangles += static_cast<unsigned int>(mesh->indexCount / 3);
+
+    // Fold the position dequantisation into the model matrix, normals are not quantised to the bounds
+    InstanceData instance;
+    instance.model[0] = transform[0] * mesh->quantizationScale.x;
+    instance.model[1] = transform[1] * mesh->quantizationScale.y;
+    instance.model[2] = transform[2] * mesh->quantizationScale.z;
+    instance.model[3] = transform * glm::vec4(mesh->quantizationOffset, 1.0f);
+    if (ComputeNormalMatrix(transform, instance.normalMatrix)) {
+        stats.uniformScaleInstances++;
+    }
+
+    submittedInstances.push_back(instance);
+}
+
+void Renderer::Flush() {
+    if (!frameActive) return;
+
+    if (queue.Size() == 0) {
+        frameActive = false;
+        return;
+    }
+
+    queue.Sort();
+    const std::vector<DrawPacket>& packets = queue.GetPackets();
+
+    instanceData.resize(packets.size());
+    for (size_t i = 0; i < packets.size(); ++i) {
+        instanceData[i] = submittedInstances[packets[i].instance];
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (instanceData.size() > instanceCapacity) {
+        instanceCapacity = instanceData.size() * 2;
+    }
+    // Re-specifying the storage orphans last frame's data so the upload does not stall on in-flight draws
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instanceData.size() * sizeof(InstanceData), instanceData.data());
+
+    glBeginQuery(GL_TIME_ELAPSED, timerQueries[timerIndex]);
+
+    if (IsIndirectEnabled()) {
+        SubmitIndirect(packets);
+    }
+    else {
+        SubmitDirect(packets);
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    timerPending[timerIndex] = true;
+    timerIndex = 1 - timerIndex;
+
+    frameActive = false;
+}
+
+void Renderer::SubmitDirect(const std::vector<DrawPacket>& packets) {
+    shader.Use();
+    stats.shaderBinds++;
+
+    glActiveTexture(GL_TEXTURE0);
+    GLuint boundTexture = 0;
+    GLuint boundVAO = 0;
+    bool textureBound = false;
+
+    size_t runStart = 0;
+    while (runStart < packets.size()) {
+        MeshHandle handle = packets[runStart].mesh;
+        const MeshPrimitive* mesh = ResourceManager::GetMesh(handle);
+        const MeshLod& lod = mesh->lods[packets[runStart].lod];
+
+        size_t runEnd = runStart + 1;
+        while (runEnd < packets.size() && packets[runEnd].mesh == handle && packets[runEnd].lod == packets[runStart].lod) {
+            runEnd++;
+        }
+
+        if (!textureBound || mesh->texture != boundTexture) {
+            glBindTexture(GL_TEXTURE_2D, mesh->texture);
+            boundTexture = mesh->texture;
+            textureBound = true;
+            stats.textureBinds++;
+        }
+
+        GLuint vao = ResourceManager::GetGeometryVAO();
+        if (vao != boundVAO) {
+            glBindVertexArray(vao);
+            boundVAO = vao;
+            stats.vaoBinds++;
+        }
+
+        BindInstanceAttributes(runStart);
+        size_t indexSize = mesh->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(lod.indexCount), mesh->indexType,
+            (void*)(static_cast<size_t>(lod.firstIndex) * indexSize),
+            static_cast<GLsizei>(runEnd - runStart), static_cast<GLint>(mesh->baseVertex));
+
+        stats.drawCalls++;
+        stats.instances += static_cast<unsigned int>(runEnd - runStart);
+        runStart = runEnd;
+    }
+    glBindVertexArray(0);
+}
+
+void Renderer::SubmitIndirect(const std::vector<DrawPacket>& packets) {
+    // One command per mesh and LOD run; baseInstance points the run at its slice of the instance SSBO
+    indirectCommands.clear();
+
+    size_t runStart = 0;
+    while (runStart < packets.size()) {
+        MeshHandle handle = packets[runStart].mesh;
+        const MeshPrimitive* mesh = ResourceManager::GetMesh(handle);
+        const MeshLod& lod = mesh->lods[packets[runStart].lod];
+
+        size_t runEnd = runStart + 1;
+        while (runEnd < packets.size() && packets[runEnd].mesh == handle && packets[runEnd].lod == packets[runStart].lod) {
+            runEnd++;
+        }
+
+        DrawElementsIndirectCommand command;
+        command.count = lod.indexCount;
+        command.instanceCount = static_cast<GLuint>(runEnd - runStart);
+        command.firstIndex = lod.firstIndex;
+        command.baseVertex = static_cast<GLint>(mesh->baseVertex);
+        command.baseInstance = static_cast<GLuint>(runStart);
+        indirectCommands.push_back(command);
+
+        runStart = runEnd;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    if (indirectCommands.size() > indirectCapacity) {
+        indirectCapacity = indirectCommands.size() * 2;
+    }
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, indirectCommands.size() * sizeof(DrawElementsIndirectCommand), indirectCommands.data());
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceVBO);
+
+    indirectShader.Use();
+    stats.shaderBinds++;
+
+    glBindVertexArray(ResourceManager::GetGeometryVAO());
+    stats.vaoBinds++;
+    BindInstanceIndexAttribute(packets.size());
+
+    glActiveTexture(GL_TEXTURE0);
+
+    // Without bindless textures each texture needs its own call, and one call has a single
+    // index type. The queue sorts by both, so that is one multi-draw per texture and index type.
+    size_t commandIndex = 0;
+    size_t packetIndex = 0;
+    GLuint boundTexture = 0;
+    bool textureBound = false;
+    while (commandIndex < indirectCommands.size()) {
+        const MeshPrimitive* first = ResourceManager::GetMesh(packets[packetIndex].mesh);
+        GLuint texture = first->texture;
+        GLenum indexType = first->indexType;
+
+        size_t firstCommand = commandIndex;
+        while (commandIndex < indirectCommands.size()) {
+            const MeshPrimitive* mesh = ResourceManager::GetMesh(packets[packetIndex].mesh);
+            if (mesh->texture != texture || mesh->indexType != indexType) break;
+
+            packetIndex += indirectCommands[commandIndex].instanceCount;
+            commandIndex++;
+        }
+
+        if (!textureBound || texture != boundTexture) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            boundTexture = texture;
+            textureBound = true;
+            stats.textureBinds++;
+        }
+
+        glMultiDrawElementsIndirect(GL_TRIANGLES, indexType,
+            (void*)(firstCommand * sizeof(DrawElementsIndirectCommand)),
+            static_cast<GLsizei>(commandIndex - firstCommand), 0);
+        stats.drawCalls++;
+    }
+
+    stats.indirectCommands = static_cast<unsigned int>(indirectCommands.size());
+    stats.instances = static_cast<unsigned int>(packets.size());
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
 void Renderer::RenderInstances(const std::vector<ModelInstance>& instances,
     const ICamera& camera,
     const glm::mat4& modelTransform) {
-    shader.Use();
+    BeginFrame(camera);
+    Submit(instances, modelTransform);
+    Flush();
+}
 
-    shader.SetMat4("view", camera.GetViewMatrix());
-    shader.SetMat4("projection", projectionMatrix);
-    shader.SetVec3("lightPos", lightPos);
-    shader.SetVec3("lightColor", lightColor);
-    shader.SetInt("baseColorTexture", 0);
+void Renderer::BindInstanceAttributes(size_t firstInstance) {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
 
-    for (const auto& instance : instances) {
-        if (!instance.mesh || instance.mesh->vao == 0) continue;
+    size_t base = firstInstance * sizeof(InstanceData);
+    for (GLuint column = 0; column < 4; ++column) {
+        GLuint location = 3 + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void*)(base + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
 
-        glm::mat4 finalModel = modelTransform * instance.transform;
-        shader.SetMat4("model", finalModel);
+    for (GLuint column = 0; column < 3; ++column) {
+        GLuint location = 7 + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void*)(base + offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+}
 
-        BindTexture(instance.mesh->texture);
+void Renderer::BindInstanceIndexAttribute(size_t instanceCount) {
+    // Location 3 holds 0..N-1 with divisor 1. Instanced attributes honour baseInstance,
+    // so the shader receives baseInstance + gl_InstanceID without needing draw parameters
+    glBindBuffer(GL_ARRAY_BUFFER, instanceIndexVBO);
+    if (instanceCount > instanceIndexCapacity) {
+        instanceIndexCapacity = instanceCount * 2;
 
-        glBindVertexArray(instance.mesh->vao);
-        if (instance.mesh->indexCount > 0) {
-            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(instance.mesh->indexCount), GL_UNSIGNED_INT, 0);
+        std::vector<GLuint> indices(instanceIndexCapacity);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            indices[i] = static_cast<GLuint>(i);
         }
-        glBindVertexArray(0);
+        glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    }
+
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glVertexAttribDivisor(3, 1);
+
+    // Left over from the per-draw path if it ran on this VAO before
+    for (GLuint location = 4; location < 10; ++location) {
+        glDisableVertexAttribArray(location);
     }
 }
 
-void Renderer::BindTexture(GLuint textureID) {
-    glActiveTexture(GL_TEXTURE0);
-    if (textureID != 0) {
-        glBindTexture(GL_TEXTURE_2D, textureID);
+void Renderer::ReadGpuTimer() {
+    // Read the query issued two frames ago so the result is ready without stalling the pipeline
+    if (!timerPending[timerIndex]) return;
+
+    GLint available = 0;
+    glGetQueryObjectiv(timerQueries[timerIndex], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(timerQueries[timerIndex], GL_QUERY_RESULT, &elapsed);
+    lastGpuTimeMs = static_cast<float>(elapsed / 1.0e6);
+    timerPending[timerIndex] = false;
+}
+
+bool Renderer::ComputeNormalMatrix(const glm::mat4& model, glm::vec4 (&normalMatrix)[3]) {
+    glm::vec3 x(model[0]);
+    glm::vec3 y(model[1]);
+    glm::vec3 z(model[2]);
+
+    float lengthX = glm::dot(x, x);
+    float lengthY = glm::dot(y, y);
+    float lengthZ = glm::dot(z, z);
+    float tolerance = 1e-4f * lengthX;
+
+    // Rotation plus uniform scale: the inverse-transpose only differs from the upper 3x3
+    // by a constant factor, which the fragment shader's normalize() removes anyway
+    bool uniformScale = std::abs(lengthX - lengthY) <= tolerance
+        && std::abs(lengthX - lengthZ) <= tolerance
+        && std::abs(glm::dot(x, y)) <= tolerance
+        && std::abs(glm::dot(x, z)) <= tolerance
+        && std::abs(glm::dot(y, z)) <= tolerance;
+
+    if (uniformScale) {
+        normalMatrix[0] = glm::vec4(x, 0.0f);
+        normalMatrix[1] = glm::vec4(y, 0.0f);
+        normalMatrix[2] = glm::vec4(z, 0.0f);
+        return true;
     }
-    else {
-        glBindTexture(GL_TEXTURE_2D, 0);
+
+    glm::mat3 inverseTranspose = glm::transpose(glm::inverse(glm::mat3(model)));
+    normalMatrix[0] = glm::vec4(inverseTranspose[0], 0.0f);
+    normalMatrix[1] = glm::vec4(inverseTranspose[1], 0.0f);
+    normalMatrix[2] = glm::vec4(inverseTranspose[2], 0.0f);
+    return false;
+}
+
+uint32_t Renderer::SelectLod(const MeshPrimitive& mesh, const glm::mat4& transform, uint8_t* lodState) const {
+    if (!lodEnabled || mesh.lodCount <= 1) return 0;
+
+    float maxScale = std::max(glm::length(glm::vec3(transform[0])),
+        std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    float radius = mesh.bounds.radius * maxScale;
+    float distance = glm::length(glm::vec3(transform * glm::vec4(mesh.bounds.center, 1.0f)) - frameCameraPos);
+
+    uint32_t previous = lodState ? std::min<uint32_t>(*lodState, mesh.lodCount - 1) : 0;
+    uint32_t level = 0;
+
+    if (distance > radius) {
+        // Projected radius as a fraction of half the screen height, errors are relative to the radius
+        float coverage = radius * projectionMatrix[1][1] / distance;
+        float allowed = 2.0f * LodScreenError * lodBias / coverage;
+
+        for (uint32_t i = mesh.lodCount - 1; i > 0; --i) {
+            float limit = allowed * (i > previous ? 1.0f - lodHysteresis : 1.0f + lodHysteresis);
+            if (mesh.lods[i].error <= limit) {
+                level = i;
+                break;
+            }
+        }
+    }
+
+    if (lodState) {
+        *lodState = static_cast<uint8_t>(level);
     }
+    return level;
 }
 
 const char* Renderer::GetVertexShaderSource() {
@@ -69,18 +448,65 @@ const char* Renderer::GetVertexShaderSource() {
         layout (location = 0) in vec3 aPos;
         layout (location = 1) in vec3 aNormal;
         layout (location = 2) in vec2 aUV;
+        layout (location = 3) in mat4 aModel;
+        layout (location = 7) in mat3 aNormalMatrix;
+
+        out vec3 FragPos;
+        out vec3 Normal;
+        out vec2 TexCoord;
+
+        layout (std140) uniform FrameData {
+            mat4 view;
+            mat4 projection;
+            vec4 viewPos;
+            vec4 lightPos;
+            vec4 lightColor;
+        };
+
+        void main() {
+            FragPos = vec3(aModel * vec4(aPos, 1.0));
+            Normal = aNormalMatrix * aNormal;
+            TexCoord = aUV;
+            gl_Position = projection * view * vec4(FragPos, 1.0);
+        }
+    )";
+}
+
+const char* Renderer::GetIndirectVertexShaderSource() {
+    return R"(
+        #version 430 core
+        layout (location = 0) in vec3 aPos;
+        layout (location = 1) in vec3 aNormal;
+        layout (location = 2) in vec2 aUV;
+        layout (location = 3) in uint aInstanceIndex;
 
         out vec3 FragPos;
         out vec3 Normal;
         out vec2 TexCoord;
 
-        uniform mat4 model;
-        uniform mat4 view;
-        uniform mat4 projection;
+        layout (std140) uniform FrameData {
+            mat4 view;
+            mat4 projection;
+            vec4 viewPos;
+            vec4 lightPos;
+            vec4 lightColor;
+        };
+
+        struct InstanceData {
+            mat4 model;
+            vec4 normalMatrix[3];
+        };
+
+        layout (std430, binding = 0) readonly buffer InstanceBuffer {
+            InstanceData instances[];
+        };
 
         void main() {
-            FragPos = vec3(model * vec4(aPos, 1.0));
-            Normal = mat3(transpose(inverse(model))) * aNormal;
+            InstanceData instance = instances[aInstanceIndex];
+            mat3 normalMatrix = mat3(instance.normalMatrix[0].xyz, instance.normalMatrix[1].xyz, instance.normalMatrix[2].xyz);
+
+            FragPos = vec3(instance.model * vec4(aPos, 1.0));
+            Normal = normalMatrix * aNormal;
             TexCoord = aUV;
             gl_Position = projection * view * vec4(FragPos, 1.0);
         }
@@ -96,26 +522,31 @@ const char* Renderer::GetFragmentShaderSource() {
 
         out vec4 FragColor;
 
+        layout (std140) uniform FrameData {
+            mat4 view;
+            mat4 projection;
+            vec4 viewPos;
+            vec4 lightPos;
+            vec4 lightColor;
+        };
+
         uniform sampler2D baseColorTexture;
-        uniform vec3 lightPos;
-        uniform vec3 viewPos;
-        uniform vec3 lightColor;
 
         void main() {
             vec3 norm = normalize(Normal);
-            vec3 lightDir = normalize(lightPos - FragPos);
-            vec3 viewDir = normalize(viewPos - FragPos);
+            vec3 lightDir = normalize(lightPos.xyz - FragPos);
+            vec3 viewDir = normalize(viewPos.xyz - FragPos);
             vec3 reflectDir = reflect(-lightDir, norm);
 
             float ambientStrength = 0.1;
-            vec3 ambient = ambientStrength * lightColor;
+            vec3 ambient = ambientStrength * lightColor.rgb;
 
             float diff = max(dot(norm, lightDir), 0.0);
-            vec3 diffuse = diff * lightColor;
+            vec3 diffuse = diff * lightColor.rgb;
 
             float specularStrength = 0.5;
             float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-            vec3 specular = specularStrength * spec * lightColor;
+            vec3 specular = specularStrength * spec * lightColor.rgb;
 
             vec3 lighting = ambient + diffuse + specular;
             vec4 texColor = texture(baseColorTexture, TexCoord);
@@ -1,11 +1,51 @@
 #pragma once
 
 #include "Shader.hpp"
+#include "MeshPrimitive.hpp"
 #include "ModelInstance.hpp"
 #include "ICamera.hpp"
+#include "RenderQueue.hpp"
 #include <glm/glm.hpp>
 #include <vector>
 
+// Mirrors the std140 "FrameData" uniform block shared by every program
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 cameraPosition;
+    glm::vec4 lightPosition;
+    glm::vec4 lightColor;
+};
+
+// Per-instance vertex data: model matrix at locations 3..6 and the normal
+// matrix at 7..9, whose columns are padded to vec4 to keep the stride aligned
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec4 normalMatrix[3];
+};
+
+// Layout mandated by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+struct RenderStats {
+    unsigned int drawCalls = 0;
+    unsigned int indirectCommands = 0;
+    unsigned int instances = 0;
+    unsigned int shaderBinds = 0;
+    unsigned int textureBinds = 0;
+    unsigned int vaoBinds = 0;
+    unsigned int uniformScaleInstances = 0;
+    unsigned int triangles = 0;
+    unsigned int fullDetailTriangles = 0;
+    float gpuTimeMs = 0.0f;
+};
+
 class Renderer {
 public:
     Renderer();
@@ -14,19 +54,80 @@ public:
     bool Initialize();
     void SetProjectionMatrix(const glm::mat4& projection);
     void SetLightProperties(const glm::vec3& position, const glm::vec3& color);
+    const glm::mat4& GetProjectionMatrix() const { return projectionMatrix; }
+
+    // Instances submitted between BeginFrame and Flush go into a render queue that is
+    // sorted by state key at Flush and drawn with one instanced call per MeshPrimitive.
+    void BeginFrame(const ICamera& camera);
+    void Submit(const std::vector<ModelInstance>& instances,
+        const glm::mat4& modelTransform = glm::mat4(1.0f));
+    void Submit(MeshHandle mesh, const glm::mat4& transform, uint8_t* lodState = nullptr);
+    void Flush();
 
     void RenderInstances(const std::vector<ModelInstance>& instances,
         const ICamera& camera,
         const glm::mat4& modelTransform = glm::mat4(1.0f));
 
+    const RenderStats& GetStats() const { return stats; }
+
+    // Multi-draw indirect needs a GL 4.3 context, otherwise the per-draw loop is used
+    bool IsIndirectSupported() const { return indirectSupported; }
+    bool IsIndirectEnabled() const { return indirectSupported && indirectEnabled; }
+    void SetIndirectEnabled(bool enabled) { indirectEnabled = enabled; }
+
+    // A level is used once its simplification error covers less than LodScreenError of the
+    // screen height. Bias scales that allowance (above 1 switches sooner), hysteresis is the
+    // fractional margin a level has to clear before the choice changes again.
+    static constexpr float LodScreenError = 1.0f / 1000.0f;
+    bool IsLodEnabled() const { return lodEnabled; }
+    void SetLodEnabled(bool enabled) { lodEnabled = enabled; }
+    float GetLodBias() const { return lodBias; }
+    void SetLodBias(float bias) { lodBias = bias; }
+    float GetLodHysteresis() const { return lodHysteresis; }
+    void SetLodHysteresis(float hysteresis) { lodHysteresis = hysteresis; }
+
 private:
     Shader shader;
+    Shader indirectShader;
+    bool indirectSupported = false;
+    bool indirectEnabled = true;
+    bool lodEnabled = true;
+    float lodBias = 1.0f;
+    float lodHysteresis = 0.15f;
     glm::mat4 projectionMatrix;
     glm::vec3 lightPos;
     glm::vec3 lightColor;
 
-    void BindTexture(GLuint textureID);
+    bool frameActive = false;
+    glm::vec3 frameCameraPos = glm::vec3(0.0f);
+    glm::vec3 frameCameraDir = glm::vec3(0.0f, 0.0f, -1.0f);
+    RenderQueue queue;
+    std::vector<InstanceData> submittedInstances;
+    std::vector<InstanceData> instanceData;
+    GLuint instanceVBO = 0;
+    size_t instanceCapacity = 0;
+    GLuint frameUBO = 0;
+    GLuint indirectBuffer = 0;
+    size_t indirectCapacity = 0;
+    GLuint instanceIndexVBO = 0;
+    size_t instanceIndexCapacity = 0;
+    std::vector<DrawElementsIndirectCommand> indirectCommands;
+    GLuint timerQueries[2] = { 0, 0 };
+    bool timerPending[2] = { false, false };
+    int timerIndex = 0;
+    float lastGpuTimeMs = 0.0f;
+    RenderStats stats;
+
+    uint32_t SelectLod(const MeshPrimitive& mesh, const glm::mat4& transform, uint8_t* lodState) const;
+    void BindInstanceAttributes(size_t firstInstance);
+    void BindInstanceIndexAttribute(size_t instanceCount);
+    void SubmitDirect(const std::vector<DrawPacket>& packets);
+    void SubmitIndirect(const std::vector<DrawPacket>& packets);
+    void ReadGpuTimer();
+
+    static bool ComputeNormalMatrix(const glm::mat4& model, glm::vec4 (&normalMatrix)[3]);
 
     static const char* GetVertexShaderSource();
+    static const char* GetIndirectVertexShaderSource();
     static const char* GetFragmentShaderSource();
 };
\ No newline at end of file
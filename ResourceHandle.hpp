@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// 32-bit reference into a SlotPool: the low IndexBits pick the slot, the rest hold the slot's
+// generation when the handle was made. Freeing a slot bumps its generation, so handles to the old
+// occupant stop resolving instead of pointing at whatever moves in. Zero is never a live handle.
+template <typename Tag>
+struct Handle {
+    static constexpr uint32_t IndexBits = 20;
+    static constexpr uint32_t IndexMask = (1u << IndexBits) - 1;
+
+    uint32_t value = 0;
+
+    static Handle Make(uint32_t index, uint32_t generation) {
+        return Handle{ (generation << IndexBits) | index };
+    }
+
+    uint32_t GetIndex() const { return value & IndexMask; }
+    uint32_t GetGeneration() const { return value >> IndexBits; }
+    bool IsValid() const { return value != 0; }
+
+    bool operator==(const Handle& other) const { return value == other.value; }
+    bool operator!=(const Handle& other) const { return value != other.value; }
+    bool operator<(const Handle& other) const { return value < other.value; }
+};
+
+using MeshHandle = Handle<struct MeshTag>;
+using TextureHandle = Handle<struct TextureTag>;
+using PrefabHandle = Handle<struct PrefabTag>;
+
+// Dense array of T addressed by generational handles. Freed slots are reused, so indices stay
+// dense enough to index per-mesh tables directly. SlotLimit caps the pool below what the handle
+// can address for indices that have to fit a narrower field, like the render queue's sort key.
+// Pointers from Get are only valid until the next Allocate.
+template <typename T, typename HandleType, uint32_t SlotLimit = HandleType::IndexMask + 1>
+class SlotPool {
+public:
+    static_assert(SlotLimit <= HandleType::IndexMask + 1, "slot limit beyond what the handle can address");
+    static constexpr uint32_t MaxSlots = SlotLimit;
+    static constexpr uint32_t MaxGeneration = (1u << (32 - HandleType::IndexBits)) - 1;
+
+    HandleType Allocate(T value) {
+        uint32_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            if (slots.size() >= MaxSlots) return HandleType();
+            index = static_cast<uint32_t>(slots.size());
+            slots.emplace_back();
+        }
+
+        Slot& slot = slots[index];
+        slot.value = std::move(value);
+        slot.alive = true;
+        liveCount++;
+        return HandleType::Make(index, slot.generation);
+    }
+
+    void Free(HandleType handle) {
+        if (!Get(handle)) return;
+
+        Slot& slot = slots[handle.GetIndex()];
+        slot.value = T();
+        slot.alive = false;
+        // Generation 0 is skipped so slot 0 never hands out the invalid handle
+        slot.generation = slot.generation == MaxGeneration ? 1 : slot.generation + 1;
+        freeSlots.push_back(handle.GetIndex());
+        liveCount--;
+    }
+
+    T* Get(HandleType handle) {
+        uint32_t index = handle.GetIndex();
+        if (index >= slots.size()) return nullptr;
+
+        Slot& slot = slots[index];
+        return (slot.alive && slot.generation == handle.GetGeneration()) ? &slot.value : nullptr;
+    }
+
+    const T* Get(HandleType handle) const {
+        return const_cast<SlotPool*>(this)->Get(handle);
+    }
+
+    template <typename Function>
+    void ForEach(Function&& function) {
+        for (uint32_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].alive) {
+                function(HandleType::Make(i, slots[i].generation), slots[i].value);
+            }
+        }
+    }
+
+    template <typename Function>
+    void ForEach(Function&& function) const {
+        for (uint32_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].alive) {
+                function(HandleType::Make(i, slots[i].generation), slots[i].value);
+            }
+        }
+    }
+
+    size_t Size() const { return liveCount; }
+    size_t Capacity() const { return slots.size(); }
+
+    // Frees every slot but keeps the generations, so handles from before the clear stay stale
+    void Clear() {
+        for (uint32_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].alive) {
+                Free(HandleType::Make(i, slots[i].generation));
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        T value{};
+        uint32_t generation = 1;
+        bool alive = false;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    size_t liveCount = 0;
+};
\ No newline at end of file
@@ -1,41 +1,433 @@
 #include "ResourceManager.hpp"
+#include "MeshUtils.hpp"
 #include <glad/glad.h>
 
-std::unordered_map<std::string, MeshPrimitive> ResourceManager::meshCache;
-std::unordered_map<std::string, GLuint> ResourceManager::textureCache;
+#include <algorithm>
 
-MeshPrimitive* ResourceManager::GetOrCreateMesh(const std::string& key, const MeshPrimitive& mesh) {
-    auto it = meshCache.find(key);
-    if (it != meshCache.end()) {
-        return &it->second;
+SlotPool<ResourceManager::MeshEntry, MeshHandle> ResourceManager::meshes;
+SlotPool<ResourceManager::TextureEntry, TextureHandle, ResourceManager::MaxTextures> ResourceManager::textures;
+std::unordered_map<ResourceKey, MeshHandle, ResourceKeyHash> ResourceManager::meshLookup;
+std::unordered_map<ResourceKey, TextureHandle, ResourceKeyHash> ResourceManager::textureLookup;
+SlotPool<ResourceManager::PrefabEntry, PrefabHandle> ResourceManager::prefabs;
+std::unordered_map<StringId, PrefabHandle> ResourceManager::prefabLookup;
+GeometryArena ResourceManager::geometry(VertexLayout::Compact());
+size_t ResourceManager::memoryBudget = ResourceManager::DefaultMemoryBudget;
+uint64_t ResourceManager::releaseCounter = 0;
+uint32_t ResourceManager::evictedMeshes = 0;
+uint32_t ResourceManager::evictedTextures = 0;
+
+MeshHandle ResourceManager::FindMesh(const ResourceKey& key) {
+    auto it = meshLookup.find(key);
+    return (it != meshLookup.end()) ? it->second : MeshHandle();
+}
+
+MeshHandle ResourceManager::GetOrCreateMesh(const ResourceKey& key) {
+    auto it = meshLookup.find(key);
+    if (it != meshLookup.end()) {
+        return it->second;
     }
 
-    auto result = meshCache.emplace(key, mesh);
-    return &result.first->second;
+    MeshEntry entry;
+    entry.key = key;
+    MeshHandle handle = meshes.Allocate(std::move(entry));
+    if (handle.IsValid()) {
+        meshLookup.emplace(key, handle);
+    }
+    return handle;
+}
+
+TextureHandle ResourceManager::FindTexture(const ResourceKey& key) {
+    auto it = textureLookup.find(key);
+    return (it != textureLookup.end()) ? it->second : TextureHandle();
 }
 
-GLuint ResourceManager::GetOrCreateTexture(const std::string& key, GLuint texture) {
-    auto it = textureCache.find(key);
-    if (it != textureCache.end()) {
+TextureHandle ResourceManager::GetOrCreateTexture(const ResourceKey& key, GLuint texture, size_t bytes) {
+    auto it = textureLookup.find(key);
+    if (it != textureLookup.end()) {
         glDeleteTextures(1, &texture);
         return it->second;
     }
 
-    textureCache[key] = texture;
-    return texture;
+    TextureEntry entry;
+    entry.id = texture;
+    entry.bytes = bytes;
+    entry.key = key;
+    TextureHandle handle = textures.Allocate(std::move(entry));
+    if (!handle.IsValid()) {
+        glDeleteTextures(1, &texture);
+        return handle;
+    }
+
+    textureLookup.emplace(key, handle);
+    return handle;
 }
 
-void ResourceManager::Clear() {
-    for (auto& pair : meshCache) {
-        const MeshPrimitive& mesh = pair.second;
-        glDeleteVertexArrays(1, &mesh.vao);
-        glDeleteBuffers(1, &mesh.vbo);
-        glDeleteBuffers(1, &mesh.ebo);
+GLuint ResourceManager::GetTextureId(TextureHandle handle) {
+    const TextureEntry* entry = textures.Get(handle);
+    return entry ? entry->id : 0;
+}
+
+void ResourceManager::ReplaceTexture(TextureHandle handle, GLuint texture, size_t bytes) {
+    TextureEntry* entry = textures.Get(handle);
+    if (!entry) {
+        glDeleteTextures(1, &texture);
+        return;
+    }
+
+    if (entry->id != 0 && entry->id != texture) {
+        glDeleteTextures(1, &entry->id);
+    }
+    entry->id = texture;
+    entry->bytes = bytes;
+
+    // Meshes copy the GL name for the renderer
+    meshes.ForEach([handle, texture](MeshHandle, MeshEntry& mesh) {
+        if (mesh.texture == handle) {
+            mesh.mesh.texture = texture;
+        }
+    });
+}
+
+std::filesystem::file_time_type ResourceManager::GetWriteTime(MeshHandle handle) {
+    const MeshEntry* entry = meshes.Get(handle);
+    return entry ? entry->writeTime : std::filesystem::file_time_type();
+}
+
+std::filesystem::file_time_type ResourceManager::GetWriteTime(TextureHandle handle) {
+    const TextureEntry* entry = textures.Get(handle);
+    return entry ? entry->writeTime : std::filesystem::file_time_type();
+}
+
+void ResourceManager::SetWriteTime(MeshHandle handle, std::filesystem::file_time_type writeTime) {
+    if (MeshEntry* entry = meshes.Get(handle)) {
+        entry->writeTime = writeTime;
+    }
+}
+
+void ResourceManager::SetWriteTime(TextureHandle handle, std::filesystem::file_time_type writeTime) {
+    if (TextureEntry* entry = textures.Get(handle)) {
+        entry->writeTime = writeTime;
+    }
+}
+
+void ResourceManager::SetMeshTexture(MeshHandle mesh, TextureHandle texture) {
+    MeshEntry* entry = meshes.Get(mesh);
+    if (!entry) return;
+
+    // Take the new reference first so re-pointing a mesh at the same texture never drops it to zero
+    TextureEntry* textureEntry = textures.Get(texture);
+    if (textureEntry) {
+        textureEntry->refCount++;
+    }
+    ReleaseTexture(entry->texture);
+
+    entry->texture = textureEntry ? texture : TextureHandle();
+    entry->mesh.texture = textureEntry ? textureEntry->id : 0;
+    entry->mesh.textureSlot = textureEntry ? texture.GetIndex() : 0;
+}
+
+void ResourceManager::ReleaseTexture(TextureHandle handle) {
+    TextureEntry* entry = textures.Get(handle);
+    if (entry && entry->refCount > 0 && --entry->refCount == 0) {
+        entry->lastRelease = ++releaseCounter;
     }
-    meshCache.clear();
+}
 
-    for (auto& pair : textureCache) {
-        glDeleteTextures(1, &pair.second);
+void ResourceManager::AcquireMeshes(const std::vector<ModelInstance>& instances) {
+    for (const ModelInstance& instance : instances) {
+        MeshEntry* entry = meshes.Get(instance.mesh);
+        if (entry) {
+            entry->refCount++;
+        }
     }
-    textureCache.clear();
+}
+
+void ResourceManager::ReleaseMeshes(const std::vector<ModelInstance>& instances) {
+    for (const ModelInstance& instance : instances) {
+        MeshEntry* entry = meshes.Get(instance.mesh);
+        if (entry && entry->refCount > 0 && --entry->refCount == 0) {
+            entry->lastRelease = ++releaseCounter;
+        }
+    }
+}
+
+void ResourceManager::AcquirePrefab(PrefabHandle handle) {
+    PrefabEntry* entry = prefabs.Get(handle);
+    if (entry && entry->refCount++ == 0) {
+        AcquireMeshes(entry->prefab.instances);
+    }
+}
+
+void ResourceManager::ReleasePrefab(PrefabHandle handle) {
+    PrefabEntry* entry = prefabs.Get(handle);
+    if (entry && entry->refCount > 0 && --entry->refCount == 0) {
+        ReleaseMeshes(entry->prefab.instances);
+    }
+}
+
+size_t ResourceManager::GetMeshBytes(const MeshPrimitive& mesh) {
+    return static_cast<size_t>(mesh.vertexCount) * geometry.GetLayout().stride + mesh.indexByteSize;
+}
+
+ResourceStats ResourceManager::GetStats() {
+    ResourceStats stats;
+    meshes.ForEach([&stats](MeshHandle, const MeshEntry& entry) {
+        size_t bytes = GetMeshBytes(entry.mesh);
+        stats.meshes++;
+        stats.meshBytes += bytes;
+        if (entry.refCount == 0) {
+            stats.unreferencedMeshBytes += bytes;
+        }
+    });
+
+    textures.ForEach([&stats](TextureHandle, const TextureEntry& entry) {
+        stats.textures++;
+        stats.textureBytes += entry.bytes;
+        if (entry.refCount == 0) {
+            stats.unreferencedTextureBytes += entry.bytes;
+        }
+    });
+    stats.prefabs = static_cast<uint32_t>(prefabs.Size());
+
+    stats.geometryCapacityBytes = static_cast<size_t>(geometry.GetVertexCapacity()) * geometry.GetLayout().stride +
+        geometry.GetIndexCapacity();
+    stats.evictedMeshes = evictedMeshes;
+    stats.evictedTextures = evictedTextures;
+    return stats;
+}
+
+void ResourceManager::CollectGarbage() {
+    ResourceStats stats = GetStats();
+    size_t resident = stats.meshBytes + stats.textureBytes;
+    if (resident <= memoryBudget) {
+        return;
+    }
+
+    std::vector<std::pair<uint64_t, MeshHandle>> unusedMeshes;
+    meshes.ForEach([&unusedMeshes](MeshHandle handle, const MeshEntry& entry) {
+        if (entry.refCount == 0) {
+            unusedMeshes.emplace_back(entry.lastRelease, handle);
+        }
+    });
+    std::sort(unusedMeshes.begin(), unusedMeshes.end());
+
+    for (const auto& [lastRelease, handle] : unusedMeshes) {
+        if (resident <= memoryBudget) break;
+        resident -= GetMeshBytes(*GetMesh(handle));
+        EvictMesh(handle);
+    }
+
+    // Evicted meshes may have left their textures unreferenced
+    std::vector<std::pair<uint64_t, TextureHandle>> unusedTextures;
+    textures.ForEach([&unusedTextures](TextureHandle handle, const TextureEntry& entry) {
+        if (entry.refCount == 0) {
+            unusedTextures.emplace_back(entry.lastRelease, handle);
+        }
+    });
+    std::sort(unusedTextures.begin(), unusedTextures.end());
+
+    for (const auto& [lastRelease, handle] : unusedTextures) {
+        if (resident <= memoryBudget) break;
+        resident -= textures.Get(handle)->bytes;
+        EvictTexture(handle);
+    }
+}
+
+void ResourceManager::EvictMesh(MeshHandle handle) {
+    MeshEntry* entry = meshes.Get(handle);
+    if (!entry) return;
+
+    // Unused prefabs still listing the handle are dropped by FindPrefab, so their model is rebuilt on its next load
+    ReleaseTexture(entry->texture);
+    ReleaseGeometry(entry->mesh);
+    meshLookup.erase(entry->key);
+    meshes.Free(handle);
+    evictedMeshes++;
+}
+
+void ResourceManager::EvictTexture(TextureHandle handle) {
+    TextureEntry* entry = textures.Get(handle);
+    if (!entry) return;
+
+    glDeleteTextures(1, &entry->id);
+    textureLookup.erase(entry->key);
+    textures.Free(handle);
+    evictedTextures++;
+}
+
+PrefabHandle ResourceManager::FindPrefab(StringId path) {
+    auto it = prefabLookup.find(path);
+    if (it == prefabLookup.end()) {
+        return PrefabHandle();
+    }
+
+    // Meshes of a prefab in use are referenced, so only an unused one can have lost any
+    PrefabHandle handle = it->second;
+    for (const ModelInstance& instance : prefabs.Get(handle)->prefab.instances) {
+        if (!meshes.Get(instance.mesh)) {
+            prefabs.Free(handle);
+            prefabLookup.erase(it);
+            return PrefabHandle();
+        }
+    }
+    return handle;
+}
+
+PrefabHandle ResourceManager::StorePrefab(Prefab prefab) {
+    auto [it, added] = prefabLookup.try_emplace(prefab.source);
+    PrefabEntry* entry = added ? nullptr : prefabs.Get(it->second);
+    if (!entry) {
+        PrefabEntry created;
+        created.prefab = std::move(prefab);
+        PrefabHandle handle = prefabs.Allocate(std::move(created));
+        if (handle.IsValid()) {
+            it->second = handle;
+        }
+        else {
+            prefabLookup.erase(it);
+        }
+        return handle;
+    }
+
+    // The new meshes are referenced before the old ones are let go, most of them are the same
+    if (entry->refCount > 0) {
+        AcquireMeshes(prefab.instances);
+        ReleaseMeshes(entry->prefab.instances);
+    }
+    entry->prefab = std::move(prefab);
+    return it->second;
+}
+
+std::string ResourceManager::GetMeshName(MeshHandle handle) {
+    const MeshEntry* entry = meshes.Get(handle);
+    if (!entry) {
+        return "<evicted>";
+    }
+
+    return StringTable::GetString(entry->key.source) + "_mesh_" + std::to_string(entry->key.index) +
+        "_" + std::to_string(entry->key.subIndex);
+}
+
+bool ResourceManager::UploadGeometry(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, MeshPrimitive& mesh) {
+    std::vector<uint8_t> packedVertices;
+    std::vector<uint8_t> packedIndices;
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size() / MeshUtils::FloatsPerVertex);
+    MeshUtils::PackVertices(vertices, MeshUtils::FloatsPerVertex, packedVertices, mesh);
+    MeshUtils::PackIndices(indices, vertexCount, packedIndices, mesh);
+
+    return UploadGeometry(packedVertices.data(), vertexCount, packedIndices.data(), static_cast<uint32_t>(indices.size()), mesh);
+}
+
+bool ResourceManager::UploadGeometry(const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, MeshPrimitive& mesh) {
+    uint32_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+
+    GeometryRange vertexRange;
+    GeometryRange indexRange;
+    if (!geometry.Allocate(vertices, vertexCount, indices, indexCount * indexSize, vertexRange, indexRange)) {
+        return false;
+    }
+
+    if (mesh.lodCount == 0) {
+        mesh.lods[0] = { 0, indexCount, 0.0f };
+        mesh.lodCount = 1;
+    }
+
+    // LOD ranges were recorded relative to the start of the index list
+    for (uint32_t i = 0; i < mesh.lodCount; ++i) {
+        mesh.lods[i].firstIndex += indexRange.offset / indexSize;
+    }
+
+    mesh.baseVertex = vertexRange.offset;
+    mesh.vertexCount = vertexRange.count;
+    mesh.indexByteOffset = indexRange.offset;
+    mesh.indexByteSize = indexRange.count;
+    mesh.firstIndex = mesh.lods[0].firstIndex;
+    mesh.indexCount = mesh.lods[0].indexCount;
+    return true;
+}
+
+void ResourceManager::ReleaseGeometry(MeshPrimitive& mesh) {
+    if (mesh.indexCount == 0) return;
+
+    geometry.Free({ mesh.baseVertex, mesh.vertexCount }, { mesh.indexByteOffset, mesh.indexByteSize });
+    mesh.vertexCount = 0;
+    mesh.indexCount = 0;
+    mesh.indexByteSize = 0;
+    mesh.lodCount = 0;
+}
+
+MeshHandle ResourceManager::GetPlaceholderMesh() {
+    static const ResourceKey placeholderKey{ StringTable::Intern("__placeholder") };
+
+    MeshHandle handle = GetOrCreateMesh(placeholderKey);
+    MeshPrimitive* mesh = GetMesh(handle);
+    if (!mesh || mesh->indexCount != 0) {
+        return handle;
+    }
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+
+    // One quad per face so every face gets its own normal
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int side = -1; side <= 1; side += 2) {
+            glm::vec3 normal(0.0f);
+            normal[axis] = static_cast<float>(side);
+            glm::vec3 u(0.0f);
+            u[(axis + 1) % 3] = 0.5f;
+            glm::vec3 v = glm::cross(normal, u);
+
+            unsigned int first = static_cast<unsigned int>(vertices.size() / MeshUtils::FloatsPerVertex);
+            for (int corner = 0; corner < 4; ++corner) {
+                float su = (corner == 1 || corner == 2) ? 1.0f : -1.0f;
+                float sv = (corner >= 2) ? 1.0f : -1.0f;
+                glm::vec3 position = normal * 0.5f + u * su + v * sv;
+
+                vertices.insert(vertices.end(), { position.x, position.y, position.z,
+                    normal.x, normal.y, normal.z, su * 0.5f + 0.5f, sv * 0.5f + 0.5f });
+            }
+
+            indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+        }
+    }
+
+    mesh->bounds.min = glm::vec3(-0.5f);
+    mesh->bounds.max = glm::vec3(0.5f);
+    mesh->bounds.center = glm::vec3(0.0f);
+    mesh->bounds.radius = glm::length(glm::vec3(0.5f));
+
+    if (!UploadGeometry(vertices, indices, *mesh)) {
+        return MeshHandle();
+    }
+
+    TextureHandle texture = FindTexture(placeholderKey);
+    if (!texture.IsValid()) {
+        const unsigned char grey[4] = { 128, 128, 128, 255 };
+        GLuint textureId = 0;
+        glGenTextures(1, &textureId);
+        glBindTexture(GL_TEXTURE_2D, textureId);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        texture = GetOrCreateTexture(placeholderKey, textureId, sizeof(grey));
+    }
+    SetMeshTexture(handle, texture);
+
+    // Never evicted
+    meshes.Get(handle)->refCount++;
+    return handle;
+}
+
+void ResourceManager::Clear() {
+    prefabLookup.clear();
+    prefabs.Clear();
+    meshLookup.clear();
+    meshes.Clear();
+    geometry.Destroy();
+
+    textures.ForEach([](TextureHandle, TextureEntry& entry) {
+        glDeleteTextures(1, &entry.id);
+    });
+    textureLookup.clear();
+    textures.Clear();
 }
\ No newline at end of file
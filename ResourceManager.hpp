@@ -1,17 +1,179 @@
 #pragma once
 
 #include "MeshPrimitive.hpp"
+#include "ModelInstance.hpp"
+#include "GeometryArena.hpp"
+#include "ResourceHandle.hpp"
+#include "StringTable.hpp"
+#include <filesystem>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
+// Every mesh node of a model file with its transform relative to the model. Objects using the
+// file all point at the one prefab instead of holding copies of its instances.
+struct Prefab {
+    StringId source = 0;
+    std::filesystem::file_time_type writeTime;
+    std::vector<std::string> dependencies;
+    std::vector<ModelInstance> instances;
+};
+
+// GPU memory held by ResourceManager. Bytes of meshes count their ranges in the geometry arena,
+// the arena's buffers themselves never shrink and are reported as geometryCapacityBytes.
+struct ResourceStats {
+    uint32_t meshes = 0;
+    uint32_t textures = 0;
+    uint32_t prefabs = 0;
+    size_t meshBytes = 0;
+    size_t textureBytes = 0;
+    size_t unreferencedMeshBytes = 0;
+    size_t unreferencedTextureBytes = 0;
+    size_t geometryCapacityBytes = 0;
+    uint32_t evictedMeshes = 0;
+    uint32_t evictedTextures = 0;
+};
+
+// Names a mesh primitive (index, subIndex = glTF mesh, primitive) or a texture (index) of a
+// source file without building a string for it
+struct ResourceKey {
+    StringId source = 0;
+    uint32_t index = 0;
+    uint32_t subIndex = 0;
+
+    bool operator==(const ResourceKey& other) const {
+        return source == other.source && index == other.index && subIndex == other.subIndex;
+    }
+};
+
+struct ResourceKeyHash {
+    size_t operator()(const ResourceKey& key) const {
+        uint64_t packed = (static_cast<uint64_t>(key.source) << 32) ^ (static_cast<uint64_t>(key.index) << 16) ^ key.subIndex;
+        return std::hash<uint64_t>()(packed);
+    }
+};
+
+// Meshes and textures live in slot pools and are handed out as generational handles. A handle
+// that outlived an eviction resolves to nullptr / 0 instead of someone else's resource.
 class ResourceManager {
 public:
-    static MeshPrimitive* GetOrCreateMesh(const std::string& key, const MeshPrimitive& mesh);
-    static GLuint GetOrCreateTexture(const std::string& key, GLuint texture);
+    static MeshHandle FindMesh(const ResourceKey& key);
+    // Creates an empty mesh the first time a key is seen
+    static MeshHandle GetOrCreateMesh(const ResourceKey& key);
+
+    // Valid until the next mesh is created, resolve handles again rather than keeping the pointer
+    static MeshPrimitive* GetMesh(MeshHandle handle) {
+        MeshEntry* entry = meshes.Get(handle);
+        return entry ? &entry->mesh : nullptr;
+    }
+
+    static TextureHandle FindTexture(const ResourceKey& key);
+    static TextureHandle GetOrCreateTexture(const ResourceKey& key, GLuint texture, size_t bytes);
+    static GLuint GetTextureId(TextureHandle handle);
+    static void ReplaceTexture(TextureHandle handle, GLuint texture, size_t bytes);
+
+    // Version of the source file a mesh or texture was uploaded from. They outlive the prefab when
+    // it loses a mesh to eviction, so the next load checks each of them again.
+    static std::filesystem::file_time_type GetWriteTime(MeshHandle handle);
+    static std::filesystem::file_time_type GetWriteTime(TextureHandle handle);
+    static void SetWriteTime(MeshHandle handle, std::filesystem::file_time_type writeTime);
+    static void SetWriteTime(TextureHandle handle, std::filesystem::file_time_type writeTime);
+
+    // Points the mesh at a texture. A resident mesh keeps its texture referenced.
+    static void SetMeshTexture(MeshHandle mesh, TextureHandle texture);
+
+    // A prefab holds one reference to each of its meshes while anything uses it, objects reference
+    // the prefab. Meshes nobody references stay resident so they can be reused, until
+    // CollectGarbage needs their memory.
+    static void AcquireMeshes(const std::vector<ModelInstance>& instances);
+    static void ReleaseMeshes(const std::vector<ModelInstance>& instances);
+    static void AcquirePrefab(PrefabHandle handle);
+    static void ReleasePrefab(PrefabHandle handle);
+
+    // Evicts unreferenced meshes, then unreferenced textures, least recently released first,
+    // until the resident bytes fit the budget. Must run between frames, while no draw packet or
+    // cull list still holds a mesh.
+    static void CollectGarbage();
+    static void SetMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+    static size_t GetMemoryBudget() { return memoryBudget; }
+    static ResourceStats GetStats();
+
+    // Returns an invalid handle when the model was never loaded or lost a mesh to eviction since
+    static PrefabHandle FindPrefab(StringId path);
+    static const Prefab* GetPrefab(PrefabHandle handle) {
+        PrefabEntry* entry = prefabs.Get(handle);
+        return entry ? &entry->prefab : nullptr;
+    }
+    // A model stored again replaces its prefab in place, so objects already using it pick up the
+    // new version through the same handle
+    static PrefabHandle StorePrefab(Prefab prefab);
+
+    // Packs interleaved position/normal/uv float vertices into the arena's compact layout and stores
+    // the indices as 16-bit whenever the vertex count allows. indices may hold every LOD of the
+    // mesh back to back as described by mesh.lods.
+    static bool UploadGeometry(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, MeshPrimitive& mesh);
+
+    // Uploads geometry already packed by MeshUtils::PackVertices/PackIndices, indices are of mesh.indexType
+    static bool UploadGeometry(const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, MeshPrimitive& mesh);
+    static void ReleaseGeometry(MeshPrimitive& mesh);
+    static GLuint GetGeometryVAO() { return geometry.GetVAO(); }
+
+    // Calls function(MeshHandle, const MeshPrimitive&) for every resident mesh
+    template <typename Function>
+    static void ForEachMesh(Function&& function) {
+        meshes.ForEach([&function](MeshHandle handle, const MeshEntry& entry) { function(handle, entry.mesh); });
+    }
+
+    // Builds a readable name such as "path_mesh_0_1", meant for logs and the terminal
+    static std::string GetMeshName(MeshHandle handle);
+
+    // Grey unit cube drawn in place of objects whose model is still loading, created on first use
+    static MeshHandle GetPlaceholderMesh();
 
     static void Clear();
 
+    static constexpr size_t DefaultMemoryBudget = 512ull * 1024 * 1024;
+    // Texture slots are sorted on in the render queue's 12-bit texture field
+    static constexpr uint32_t MaxTextures = 1u << 12;
+
 private:
-    static std::unordered_map<std::string, MeshPrimitive> meshCache;
-    static std::unordered_map<std::string, GLuint> textureCache;
+    struct MeshEntry {
+        MeshPrimitive mesh;
+        ResourceKey key;
+        TextureHandle texture;
+        std::filesystem::file_time_type writeTime;
+        uint32_t refCount = 0;
+        uint64_t lastRelease = 0;
+    };
+
+    struct TextureEntry {
+        GLuint id = 0;
+        size_t bytes = 0;
+        ResourceKey key;
+        std::filesystem::file_time_type writeTime;
+        uint32_t refCount = 0;
+        uint64_t lastRelease = 0;
+    };
+
+    struct PrefabEntry {
+        Prefab prefab;
+        uint32_t refCount = 0;
+    };
+
+    static SlotPool<MeshEntry, MeshHandle> meshes;
+    static SlotPool<TextureEntry, TextureHandle, MaxTextures> textures;
+    static SlotPool<PrefabEntry, PrefabHandle> prefabs;
+    static std::unordered_map<ResourceKey, MeshHandle, ResourceKeyHash> meshLookup;
+    static std::unordered_map<ResourceKey, TextureHandle, ResourceKeyHash> textureLookup;
+    static std::unordered_map<StringId, PrefabHandle> prefabLookup;
+    static GeometryArena geometry;
+    static size_t memoryBudget;
+    static uint64_t releaseCounter;
+    static uint32_t evictedMeshes;
+    static uint32_t evictedTextures;
+
+    static size_t GetMeshBytes(const MeshPrimitive& mesh);
+    static void ReleaseTexture(TextureHandle handle);
+    static void EvictMesh(MeshHandle handle);
+    static void EvictTexture(TextureHandle handle);
 };
\ No newline at end of file
@@ -1,51 +1,66 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <glm/glm.hpp>
+#include <entt/entity/registry.hpp>
 #include "ModelInstance.hpp"
+#include "Frustum.hpp"
+#include "AssetLoader.hpp"
+#include "SceneComponents.hpp"
+#include "SceneSaver.hpp"
+#include "TransformBatch.hpp"
 
 class ICamera;
 class Renderer;
+class SceneArchive;
+class SceneJournal;
+class SceneStreamer;
+struct SceneDescription;
+struct SceneEdit;
+struct StreamingStats;
 
-namespace tinygltf {
-    class Model;
-    struct Primitive;
-}
-
-struct PhysicsProperties {
-    bool hasCollision = false;
-    bool isAffectedByPhysics = false;
-    bool isStatic = false;
-    float mass = 1.0f;
-    glm::vec3 collisionShapeSize = glm::vec3(1.0f);
+struct CullStats {
+    unsigned int tested = 0;
+    unsigned int visible = 0;
+    unsigned int culled = 0;
 };
 
-struct SceneObject {
-    std::string id;
-    std::string modelPath;
-    glm::vec3 position = glm::vec3(0.0f);
-    glm::vec3 rotation = glm::vec3(0.0f);
-    glm::vec3 scale = glm::vec3(1.0f);
-    std::vector<ModelInstance> instances;
-    PhysicsProperties physics;
-
-    glm::mat4 GetTransform() const;
+struct RaycastHit {
+    entt::entity object = entt::null;
+    // Where the ray enters the object's bounding box, in multiples of the ray direction
+    float distance = 0.0f;
+};
 
-    void WriteToBinary(std::ofstream& file) const;
-    bool ReadFromBinary(std::ifstream& file);
+// World matrices the last UpdateTransforms rebuilt: dirty objects themselves and descendants that
+// only moved along with an ancestor, out of all objects
+struct TransformStats {
+    unsigned int dirty = 0;
+    unsigned int propagated = 0;
+    unsigned int total = 0;
 };
 
 class Scene {
 public:
     Scene();
+    ~Scene();
 
     bool AddObject(const std::string& id, const std::string& modelPath);
     bool RemoveObject(const std::string& id);
 
-    SceneObject* GetObject(const std::string& id);
-    const SceneObject* GetObject(const std::string& id) const;
+    // entt::null when no object has this id
+    entt::entity FindObject(const std::string& id) const;
+    bool HasObject(const std::string& id) const { return FindObject(id) != entt::null; }
+    size_t GetObjectCount() const { return names.size(); }
+
+    // Objects are entities with a NameComponent, TransformComponent, WorldMatrixComponent,
+    // HierarchyComponent, BoundsComponent, RenderableComponent and PhysicsProperties. Go through
+    // AddObject / RemoveObject to create or destroy them so the name index, hierarchy, spatial
+    // index and mesh references stay in sync.
+    entt::registry& GetRegistry() { return registry; }
+    const entt::registry& GetRegistry() const { return registry; }
 
     void SetObjectPosition(const std::string& id, const glm::vec3& position);
     void SetObjectRotation(const std::string& id, const glm::vec3& rotation);
@@ -70,18 +85,230 @@ public:
     void RotateObject(const std::string& id, const glm::vec3& rotation);
     void ScaleObject(const std::string& id, const glm::vec3& scale);
 
+    // Makes the object's transform relative to parentId, an empty parentId makes it a root again.
+    // The local transform is kept as it is. Fails for unknown ids and when the parent is the
+    // object itself or one of its descendants.
+    bool SetObjectParent(const std::string& id, const std::string& parentId);
+    // Empty for root objects
+    std::string GetObjectParent(const std::string& id) const;
+
+    // Call after writing an object's TransformComponent through the registry. The setters above
+    // already do this.
+    void MarkTransformDirty(entt::entity entity);
+
+    // Rebuilds the cached world matrix of every object marked dirty since the last call, in one
+    // batch, then of their descendants. Run it once per frame before RenderScene, which only reads
+    // the cached matrices.
+    void UpdateTransforms();
+    const TransformStats& GetTransformStats() const { return transformStats; }
+
+    // Spatial queries over the objects' world space bounding boxes as of the last
+    // UpdateTransforms. Matching objects are appended to objects.
+    void QueryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<entt::entity>& objects) const;
+    void QuerySphere(const glm::vec3& center, float radius, std::vector<entt::entity>& objects) const;
+    void QueryFrustum(const Frustum& frustum, std::vector<entt::entity>& objects) const;
+    // Finds the nearest object whose bounding box the ray enters within maxDistance
+    bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const;
+    const AABBTree& GetSpatialIndex() const { return spatialIndex; }
+
     void RenderScene(Renderer& renderer, const ICamera& camera) const;
+    const CullStats& GetCullStats() const { return cullStats; }
 
-    const std::unordered_map<std::string, SceneObject>& GetObjects() const { return objects; }
+    // Once a scene was saved or loaded, every edit through the setters above is also appended to a
+    // journal next to its file, which a background thread folds into the file now and then. Edits
+    // left in the journal by a crash are applied when the file is loaded again.
+    bool SaveToFile(const std::string& filePath);
 
-    bool SaveToFile(const std::string& filePath) const;
-    bool LoadFromFile(const std::string& filePath);
+    // Copies the scene on the calling thread and writes the copy on a background thread, replacing
+    // the file in one rename once it is complete. Editing goes on meanwhile, later edits are
+    // journaled for the new file. onComplete runs on the calling thread from ProcessSaves.
+    SaveHandle SaveToFileAsync(const std::string& filePath, std::function<void(const SaveHandle&)> onComplete = nullptr);
+    // Runs the onComplete callbacks of finished saves. Call it once per frame.
+    void ProcessSaves();
+    const SaveHandle& GetActiveSave() const { return activeSave; }
+
+    // Creates the scene's objects right away and loads their models in the background.
+    // Objects draw as placeholders until ProcessLoads has uploaded their model.
+    LoadHandle LoadFromFile(const std::string& filePath);
+    bool IsJournaling() const { return journal != nullptr; }
+
+    // Takes back or redoes one edit made through the setters above. Loading a file clears the
+    // history. Changes to the same field of an object merge into one step when ContinueUndoStep is
+    // called before each change after the first, as while a slider is being dragged.
+    bool Undo();
+    bool Redo();
+    bool CanUndo() const { return undoCursor > 0; }
+    bool CanRedo() const { return undoCursor < undoSteps.size(); }
+    void ContinueUndoStep() { mergeNextEdit = true; }
+
+    // Uploads finished model loads on the calling (GL) thread, stopping once budgetMs is spent
+    void ProcessLoads(double budgetMs);
+    void WaitForLoad(const LoadHandle& handle);
+    const LoadHandle& GetActiveLoad() const { return activeLoad; }
+
+    // Saving buckets the objects into square cells of this size on the XZ plane, 0 saves an
+    // unpartitioned file. Loading a partitioned file takes over its cell size.
+    void SetCellSize(float size) { cellSize = size; }
+    float GetCellSize() const { return cellSize; }
+
+    // A scene loaded from a partitioned file only keeps the cells near the position passed here.
+    // Cells are read on a background thread, nearest first, and their objects are created and
+    // removed within budgetMs per call. Call it once per frame before ProcessLoads. Objects of a
+    // streamed cell can only be parented to objects of the same cell, and changes to them are
+    // kept in memory while the cell is unloaded.
+    void UpdateStreaming(const glm::vec3& position, double budgetMs);
+    void SetStreamingRadius(float loadRadius, float unloadRadius);
+    bool IsStreaming() const { return streamer != nullptr; }
+    StreamingStats GetStreamingStats() const;
 
 private:
-    std::unordered_map<std::string, SceneObject> objects;
+    struct PendingLoad {
+        entt::entity entity;
+        std::shared_ptr<ModelJob> job;
+        LoadHandle handle;
+    };
+
+    // A model path of a description being instantiated, resolved and looked up in the model cache
+    // once for all objects that use it
+    struct ModelSource {
+        StringId modelPath = 0;
+        std::string localPath;
+        bool cached = false;
+        PrefabHandle prefab;
+        std::shared_ptr<ModelJob> job;
+    };
+
+    // String index of each model path in a description being built
+    using ModelStrings = std::unordered_map<StringId, uint32_t>;
+
+    entt::registry registry;
+    std::unordered_map<std::string, entt::entity> names;
     std::vector<std::pair<std::string, std::string>> path_aliases;
     glm::vec3 bg_color;
 
-    bool LoadModel(const std::string& path, std::vector<ModelInstance>& instances);
-    bool LoadPrimitive(const std::string path, const tinygltf::Model& model, const tinygltf::Primitive& primitive, MeshPrimitive& meshPrim);
+    std::unique_ptr<AssetLoader> assetLoader;
+    std::vector<PendingLoad> pendingLoads;
+    LoadHandle activeLoad;
+
+    TransformStats transformStats;
+    TransformBatch transformBatch;
+    std::vector<glm::mat4> transformMatrices;
+
+    // Every object in depth-first order, hierarchyEnd[i] is one past the last descendant of
+    // hierarchyOrder[i]. Rebuilt by UpdateTransforms after objects were added, removed or parented.
+    std::vector<entt::entity> hierarchyOrder;
+    std::vector<uint32_t> hierarchyEnd;
+    std::vector<uint32_t> dirtyOrder;
+    bool hierarchyChanged = false;
+    uint32_t childObjects = 0;
+
+    AABBTree spatialIndex;
+    std::vector<entt::entity> movedObjects;
+
+    std::unique_ptr<SceneStreamer> streamer;
+    float cellSize = 0.0f;
+
+    // Shared with saves in progress, which start it over once their file is written
+    std::shared_ptr<SceneJournal> journal;
+    std::unique_ptr<SceneSaver> saver;
+    SaveHandle activeSave;
+    std::vector<SaveHandle> pendingSaves;
+    std::vector<uint8_t> encodedEdit;
+    // Encoded edits, one per undo step, undoSteps[i] is where step i starts. Steps from undoCursor
+    // on were undone and can be redone.
+    std::vector<uint8_t> undoBuffer;
+    std::vector<size_t> undoSteps;
+    size_t undoCursor = 0;
+    bool mergeNextEdit = false;
+    // Set while Undo or Redo replays a step through the setters, which then only journal it
+    bool applyingHistory = false;
+
+    mutable CullStats cullStats;
+    mutable SphereBatch cullSpheres;
+    mutable std::vector<entt::entity> cullObjects;
+    mutable std::vector<ModelInstance> cullCandidates;
+    mutable std::vector<uint8_t*> cullLodStates;
+    mutable std::vector<uint8_t> cullVisibility;
+    mutable std::vector<ModelInstance> placeholderInstances;
+
+    entt::entity CreateObject(const std::string& id, StringId modelPath, const TransformComponent& transform, const PhysicsProperties& physics);
+    // Loads the model right away and creates the object, entt::null when the model fails to load
+    entt::entity SpawnObject(const std::string& id, const std::string& modelPath, const TransformComponent& transform, const PhysicsProperties& physics);
+    void DestroyObject(entt::entity entity);
+    void ClearObjects();
+    // Setters every edit goes through, each records what it changed
+    void SetTransformField(const std::string& id, uint8_t field, const glm::vec3& value);
+    void SetPhysics(const std::string& id, const PhysicsProperties& physics);
+    void SetBackground(const glm::vec3& color);
+    void RemovePathAlias(const std::string& key, const std::string& value);
+    // Brings back an object as a RemoveObject edit described it
+    void RestoreObject(const SceneEdit& edit);
+    // False when parenting would put the object below itself or across streamed cells
+    bool CanParent(entt::entity entity, entt::entity parent) const;
+    // Journals the edit and makes it an undo step
+    void RecordEdit(const SceneEdit& edit);
+    void ApplyEdit(const SceneEdit& edit);
+    void ApplyUndoStep(size_t step, bool inverse);
+    void ClearHistory();
+    // Marks the streamed cell the object came from as changed
+    void NoteEdit(entt::entity entity);
+    void AttachToParent(entt::entity entity, entt::entity parent);
+    void DetachFromParent(entt::entity entity);
+    void RebuildHierarchyOrder();
+    // Recomputes the object's box from its world matrix and meshes and moves it in the spatial index
+    void UpdateBounds(entt::entity entity);
+    // The object's prefab instances, or the placeholder cube while its model is loading
+    const std::vector<ModelInstance>& GetInstances(const RenderableComponent& renderable) const;
+    // Expands an @alias prefix and makes the path absolute. Returns false when the alias is
+    // unknown, localPath then holds the unexpanded path.
+    bool ResolveModelPath(const std::string& modelPath, std::string& localPath) const;
+    // Copies the scene's settings and objects, parents before children, into a file description.
+    // Streamed cells that are unloaded or unchanged come from memory or the file instead. The
+    // description is left unpartitioned for the saving thread.
+    void BuildDescription(SceneDescription& description) const;
+    // Appends root and its descendants, parents first, and records where each went when
+    // objectIndices is given
+    void DescribeSubtree(entt::entity root, SceneDescription& description, ModelStrings& modelStrings,
+        std::unordered_map<entt::entity, uint32_t>* objectIndices = nullptr) const;
+    // Appends the current objects of a streamed cell whose objects are in the registry, including
+    // those still waiting to be created
+    void DescribeCell(uint32_t cell, SceneDescription& description) const;
+    // True when the registry holds the only up to date copy of a streamed cell's objects
+    bool IsCellInRegistry(uint32_t cell) const;
+    // True when an object has the id, including objects of streamed cells that are not created
+    bool IsIdTaken(const std::string& id) const;
+    // Reads a scene file and opens its journal, with the edits only the journal has applied
+    bool ReadJournaledFile(const std::string& path, SceneDescription& description, std::shared_ptr<SceneArchive>& archive,
+        std::unique_ptr<SceneJournal>& loadedJournal);
+    // Creates the object at index in objects and starts or reuses the load of its model
+    entt::entity InstantiateObject(const SceneDescription& objects, size_t index, std::unordered_map<uint32_t, ModelSource>& models, const LoadHandle& handle);
+
+    template <typename Change>
+    void ChangePhysics(const std::string& id, Change change) {
+        const PhysicsProperties* physics = FindComponent<PhysicsProperties>(id);
+        if (!physics) {
+            mergeNextEdit = false;
+            return;
+        }
+
+        PhysicsProperties changed = *physics;
+        change(changed);
+        SetPhysics(id, changed);
+    }
+
+    template <typename Component>
+    Component* FindComponent(const std::string& id) {
+        entt::entity entity = FindObject(id);
+        return entity != entt::null ? &registry.get<Component>(entity) : nullptr;
+    }
+
+    template <typename Component>
+    const Component* FindComponent(const std::string& id) const {
+        entt::entity entity = FindObject(id);
+        return entity != entt::null ? &registry.get<Component>(entity) : nullptr;
+    }
+
+    bool LoadModel(const std::string& path, PrefabHandle& prefab);
+    void CancelPendingLoads();
+    void ReleasePendingJob(ModelJob& job);
 };
\ No newline at end of file
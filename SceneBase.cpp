@@ -1,4 +1,6 @@
 #include "Scene.hpp"
+#include "SceneJournal.hpp"
+#include "SceneStreamer.hpp"
 #include "ResourceManager.hpp"
 #include "Renderer.hpp"
 #include "ICamera.hpp"
@@ -7,371 +9,718 @@
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/quaternion.hpp>
-#include <glm/gtx/quaternion.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
-#include <tiny_gltf.h>
 #include <glad/glad.h>
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <cstring>
+#include <limits>
+#include <thread>
+#include <utility>
 
 
 Scene::Scene() :
     bg_color(30 / 255.0f, 30 / 255.0f, 30 / 255.0f)
 {
     path_aliases.emplace_back("assets", "../../assets");
+    placeholderInstances.push_back({ glm::mat4(1.0f), MeshHandle() });
 }
 
-glm::mat4 SceneObject::GetTransform() const {
-    glm::mat4 transform = glm::mat4(1.0f);
-    transform = glm::translate(transform, position);
-    transform = glm::rotate(transform, rotation.x, glm::vec3(1, 0, 0));
-    transform = glm::rotate(transform, rotation.y, glm::vec3(0, 1, 0));
-    transform = glm::rotate(transform, rotation.z, glm::vec3(0, 0, 1));
-    transform = glm::scale(transform, scale);
-    return transform;
+Scene::~Scene() {
+    CancelPendingLoads();
+    ClearObjects();
 }
 
 bool Scene::AddObject(const std::string& id, const std::string& modelPath) {
-    if (objects.find(id) != objects.end()) {
+    if (IsIdTaken(id)) {
         return false;
     }
 
-    SceneObject obj;
-    obj.id = id;
-    obj.modelPath = modelPath;
-    std::string local_path = modelPath;
-
-    if (modelPath[0] == '@') {
-        int s_pos = modelPath.find('/');
-        if (s_pos > modelPath.find('\\')) {
-            s_pos = modelPath.find('\\');
-        }
-
-        if (s_pos == std::string::npos) {
-            return false;
-        }
-
-        std::string target = std::move(modelPath.substr(1, s_pos - 1));
-
-        auto alias = std::find_if(path_aliases.begin(), path_aliases.end(),
-            [&target](const std::pair<std::string, std::string>& p) {
-                return p.first == target;
-            });
+    if (SpawnObject(id, modelPath, TransformComponent(), PhysicsProperties()) == entt::null) {
+        return false;
+    }
 
-        if (alias == path_aliases.end()) {
-            return false;
-        }
+    SceneEdit edit;
+    edit.type = SceneEdit::Type::AddObject;
+    edit.id = id;
+    edit.text = modelPath;
+    RecordEdit(edit);
+    return true;
+}
 
-        local_path = alias->second + modelPath.substr(s_pos);
+entt::entity Scene::SpawnObject(const std::string& id, const std::string& modelPath, const TransformComponent& transform, const PhysicsProperties& physics) {
+    std::string local_path;
+    if (!ResolveModelPath(modelPath, local_path)) {
+        return entt::null;
     }
 
-    local_path = Utils::GetFullPath(local_path.c_str());
-
-    if (!LoadModel(local_path, obj.instances)) {
-        return false;
+    PrefabHandle prefab;
+    if (!LoadModel(local_path, prefab)) {
+        return entt::null;
     }
 
-    objects[id] = std::move(obj);
-    return true;
+    entt::entity entity = CreateObject(id, StringTable::Intern(modelPath), transform, physics);
+
+    RenderableComponent& renderable = registry.get<RenderableComponent>(entity);
+    renderable.prefab = prefab;
+    ResourceManager::AcquirePrefab(prefab);
+    return entity;
 }
 
 bool Scene::RemoveObject(const std::string& id) {
-    auto it = objects.find(id);
-    if (it == objects.end()) {
+    entt::entity entity = FindObject(id);
+    if (entity == entt::null) {
         return false;
     }
 
-    objects.erase(it);
+    // Everything needed to bring the object back, including the children that move up
+    SceneEdit edit;
+    edit.type = SceneEdit::Type::RemoveObject;
+    edit.id = id;
+    edit.text = StringTable::GetString(registry.get<RenderableComponent>(entity).modelPath);
+    edit.transform = registry.get<TransformComponent>(entity);
+    edit.physics = registry.get<PhysicsProperties>(entity);
+    const HierarchyComponent& hierarchy = registry.get<HierarchyComponent>(entity);
+    if (hierarchy.parent != entt::null) {
+        edit.parent = registry.get<NameComponent>(hierarchy.parent).id;
+    }
+    for (entt::entity child = hierarchy.firstChild; child != entt::null; child = registry.get<HierarchyComponent>(child).nextSibling) {
+        edit.children.push_back(registry.get<NameComponent>(child).id);
+    }
+
+    NoteEdit(entity);
+    DestroyObject(entity);
+    RecordEdit(edit);
     return true;
 }
 
-SceneObject* Scene::GetObject(const std::string& id) {
-    auto it = objects.find(id);
-    return (it != objects.end()) ? &it->second : nullptr;
+entt::entity Scene::FindObject(const std::string& id) const {
+    auto it = names.find(id);
+    return (it != names.end()) ? it->second : entt::null;
 }
 
-const SceneObject* Scene::GetObject(const std::string& id) const {
-    auto it = objects.find(id);
-    return (it != objects.end()) ? &it->second : nullptr;
+entt::entity Scene::CreateObject(const std::string& id, StringId modelPath, const TransformComponent& transform, const PhysicsProperties& physics) {
+    // A scene file listing an id twice keeps the last object
+    auto [name, added] = names.try_emplace(id, entt::null);
+    if (!added) {
+        DestroyObject(name->second);
+        name = names.try_emplace(id, entt::null).first;
+    }
+
+    entt::entity entity = registry.create();
+    name->second = entity;
+    registry.emplace<NameComponent>(entity, id);
+    registry.emplace<TransformComponent>(entity, transform);
+    registry.emplace<WorldMatrixComponent>(entity);
+    registry.emplace<HierarchyComponent>(entity);
+    registry.emplace<BoundsComponent>(entity);
+    registry.emplace<TransformDirtyTag>(entity);
+    registry.emplace<RenderableComponent>(entity).modelPath = modelPath;
+    registry.emplace<PhysicsProperties>(entity, physics);
+    hierarchyChanged = true;
+    return entity;
 }
 
-void Scene::SetObjectPosition(const std::string& id, const glm::vec3& position) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->position = position;
+void Scene::DestroyObject(entt::entity entity) {
+    // Children move up to the removed object's parent and keep their local transform
+    HierarchyComponent& hierarchy = registry.get<HierarchyComponent>(entity);
+    while (hierarchy.firstChild != entt::null) {
+        entt::entity child = hierarchy.firstChild;
+        DetachFromParent(child);
+        AttachToParent(child, hierarchy.parent);
+        registry.emplace_or_replace<TransformDirtyTag>(child);
     }
+    DetachFromParent(entity);
+    hierarchyChanged = true;
+
+    int proxy = registry.get<BoundsComponent>(entity).proxy;
+    if (proxy != AABBTree::Null) {
+        spatialIndex.Remove(proxy);
+    }
+
+    ResourceManager::ReleasePrefab(registry.get<RenderableComponent>(entity).prefab);
+    names.erase(registry.get<NameComponent>(entity).id);
+    registry.destroy(entity);
 }
 
-void Scene::SetObjectRotation(const std::string& id, const glm::vec3& rotation) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->rotation = rotation;
+void Scene::ClearObjects() {
+    for (auto [entity, renderable] : registry.view<const RenderableComponent>().each()) {
+        ResourceManager::ReleasePrefab(renderable.prefab);
     }
+    registry.clear();
+    names.clear();
+    spatialIndex.Clear();
+    childObjects = 0;
+    hierarchyChanged = true;
 }
 
-void Scene::SetObjectScale(const std::string& id, const glm::vec3& scale) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->scale = scale;
+bool Scene::ResolveModelPath(const std::string& modelPath, std::string& localPath) const {
+    localPath = modelPath;
+    bool resolved = true;
+
+    if (!modelPath.empty() && modelPath[0] == '@') {
+        size_t s_pos = std::min(modelPath.find('/'), modelPath.find('\\'));
+        auto alias = path_aliases.end();
+
+        if (s_pos != std::string::npos) {
+            std::string target = modelPath.substr(1, s_pos - 1);
+            alias = std::find_if(path_aliases.begin(), path_aliases.end(),
+                [&target](const std::pair<std::string, std::string>& p) {
+                    return p.first == target;
+                });
+        }
+
+        if (alias != path_aliases.end()) {
+            localPath = alias->second + modelPath.substr(s_pos);
+        }
+        else {
+            resolved = false;
+        }
     }
+
+    localPath = Utils::GetFullPath(localPath.c_str());
+    return resolved;
 }
 
-void Scene::SetBGColor(float r, float g, float b) {
-    bg_color.r = r / 255.0f;
-    bg_color.g = g / 255.0f;
-    bg_color.b = b / 255.0f;
+void Scene::SetTransformField(const std::string& id, uint8_t field, const glm::vec3& value) {
+    // A continued step ends with a change that records nothing, the next one starts its own
+    bool merge = std::exchange(mergeNextEdit, false);
+    entt::entity entity = FindObject(id);
+    if (entity == entt::null) return;
+
+    TransformComponent& transform = registry.get<TransformComponent>(entity);
+    glm::vec3& target = field == SceneEdit::Position ? transform.position :
+        field == SceneEdit::Rotation ? transform.rotation : transform.scale;
+    if (target == value) return;
+
+    SceneEdit edit;
+    edit.type = SceneEdit::Type::Transform;
+    edit.id = id;
+    edit.field = field;
+    edit.previousValue = target;
+    edit.value = value;
+
+    target = value;
+    MarkTransformDirty(entity);
+    mergeNextEdit = merge;
+    RecordEdit(edit);
 }
 
-void Scene::AddPathAlias(std::string key, std::string value) {
-    path_aliases.emplace_back(key, value);
+void Scene::MarkTransformDirty(entt::entity entity) {
+    registry.emplace_or_replace<TransformDirtyTag>(entity);
+    NoteEdit(entity);
 }
 
-void Scene::MoveObject(const std::string& id, const glm::vec3& offset) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->position += offset;
+void Scene::UpdateTransforms() {
+    if (hierarchyChanged) {
+        RebuildHierarchyOrder();
     }
-}
 
-void Scene::RotateObject(const std::string& id, const glm::vec3& rotation) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->rotation += rotation;
+    auto& dirty = registry.storage<TransformDirtyTag>();
+    transformStats.dirty = static_cast<unsigned int>(dirty.size());
+    transformStats.propagated = 0;
+    transformStats.total = static_cast<unsigned int>(registry.storage<TransformComponent>().size());
+    if (dirty.empty()) return;
+
+    movedObjects.clear();
+    transformBatch.Clear();
+    for (entt::entity entity : dirty) {
+        transformBatch.Add(registry.get<TransformComponent>(entity));
     }
-}
 
-void Scene::ScaleObject(const std::string& id, const glm::vec3& scale) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->scale *= scale;
+    transformBatch.ComputeMatrices(transformMatrices);
+
+    size_t i = 0;
+    for (entt::entity entity : dirty) {
+        WorldMatrixComponent& world = registry.get<WorldMatrixComponent>(entity);
+        world.local = transformMatrices[i++];
+        world.matrix = world.local;
     }
-}
 
-void Scene::RenderScene(Renderer& renderer, const ICamera& camera) const {
-    glClearColor(bg_color.r, bg_color.g, bg_color.b, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Without any parenting every world matrix is already final
+    if (childObjects == 0) {
+        movedObjects.assign(dirty.begin(), dirty.end());
+    }
+    else {
+        dirtyOrder.clear();
+        for (entt::entity entity : dirty) {
+            dirtyOrder.push_back(registry.get<HierarchyComponent>(entity).order);
+        }
+        std::sort(dirtyOrder.begin(), dirtyOrder.end());
+
+        // A subtree is a contiguous range of the depth-first order and parents come before their
+        // children, so each dirty subtree is one linear pass. Subtrees inside one already
+        // recomputed are skipped.
+        uint32_t done = 0;
+        for (uint32_t first : dirtyOrder) {
+            if (first < done) continue;
+
+            for (uint32_t j = first; j < hierarchyEnd[first]; ++j) {
+                entt::entity entity = hierarchyOrder[j];
+                entt::entity parent = registry.get<HierarchyComponent>(entity).parent;
+                WorldMatrixComponent& world = registry.get<WorldMatrixComponent>(entity);
+                world.matrix = parent != entt::null ? registry.get<WorldMatrixComponent>(parent).matrix * world.local : world.local;
+                movedObjects.push_back(entity);
+            }
+
+            transformStats.propagated += hierarchyEnd[first] - first;
+            done = hierarchyEnd[first];
+        }
+        transformStats.propagated -= std::min(transformStats.propagated, transformStats.dirty);
+    }
+
+    dirty.clear();
 
-    for (const auto& [id, obj] : objects) {
-        glm::mat4 objTransform = obj.GetTransform();
-        renderer.RenderInstances(obj.instances, camera, objTransform);
+    for (entt::entity entity : movedObjects) {
+        UpdateBounds(entity);
+    }
+    if (spatialIndex.NeedsRebuild()) {
+        spatialIndex.Rebuild();
     }
 }
 
-bool Scene::LoadModel(const std::string& path, std::vector<ModelInstance>& instances) {
-    tinygltf::Model model;
-    tinygltf::TinyGLTF loader;
-    std::string err, warn;
+void Scene::UpdateBounds(entt::entity entity) {
+    const glm::mat4& objTransform = registry.get<WorldMatrixComponent>(entity).matrix;
+    const RenderableComponent& renderable = registry.get<RenderableComponent>(entity);
 
-    bool success = path.ends_with(".glb")
-        ? loader.LoadBinaryFromFile(&model, &err, &warn, path)
-        : loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    // Objects without any mesh still get a point so queries can find them
+    glm::vec3 position = glm::vec3(objTransform[3]);
+    AABB box{ position, position };
+    bool empty = true;
 
-    if (!success) {
-        return false;
+    for (const auto& instance : GetInstances(renderable)) {
+        const MeshPrimitive* mesh = ResourceManager::GetMesh(instance.mesh);
+        if (!mesh) continue;
+
+        AABB instanceBox = AABB{ mesh->bounds.min, mesh->bounds.max }.Transformed(objTransform * instance.transform);
+        box = empty ? instanceBox : AABB::Union(box, instanceBox);
+        empty = false;
+    }
+
+    BoundsComponent& bounds = registry.get<BoundsComponent>(entity);
+    bounds.box = box;
+    if (bounds.proxy == AABBTree::Null) {
+        bounds.proxy = spatialIndex.Insert(box, static_cast<uint32_t>(entity));
+    }
+    else {
+        spatialIndex.Update(bounds.proxy, box);
+    }
+}
+
+const std::vector<ModelInstance>& Scene::GetInstances(const RenderableComponent& renderable) const {
+    // Objects still waiting for their model are drawn as a unit cube
+    if (renderable.loading) {
+        placeholderInstances[0].mesh = ResourceManager::GetPlaceholderMesh();
+        return placeholderInstances;
     }
 
-    for (const auto& node : model.nodes) {
-        if (node.mesh < 0) continue;
-        const auto& mesh = model.meshes[node.mesh];
+    static const std::vector<ModelInstance> none;
+    const Prefab* prefab = ResourceManager::GetPrefab(renderable.prefab);
+    return prefab ? prefab->instances : none;
+}
 
-        glm::mat4 transform = glm::mat4(1.0f);
-        if (!node.matrix.empty()) {
-            transform = glm::make_mat4x4(node.matrix.data());
+void Scene::QueryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<entt::entity>& objects) const {
+    AABB query{ min, max };
+    spatialIndex.QueryAABB(query, [&](uint32_t userData) {
+        entt::entity entity = static_cast<entt::entity>(userData);
+        // The tree stores fattened boxes, the component holds the tight one
+        if (registry.get<BoundsComponent>(entity).box.Overlaps(query)) {
+            objects.push_back(entity);
         }
-        else {
-            glm::vec3 translation = node.translation.size() == 3 ?
-                glm::vec3(static_cast<float>(node.translation[0]),
-                    static_cast<float>(node.translation[1]),
-                    static_cast<float>(node.translation[2])) : glm::vec3(0.0f);
-            glm::vec3 scale = node.scale.size() == 3 ?
-                glm::vec3(static_cast<float>(node.scale[0]),
-                    static_cast<float>(node.scale[1]),
-                    static_cast<float>(node.scale[2])) : glm::vec3(1.0f);
-            glm::quat rotation = node.rotation.size() == 4 ?
-                glm::quat(static_cast<float>(node.rotation[3]),
-                    static_cast<float>(node.rotation[0]),
-                    static_cast<float>(node.rotation[1]),
-                    static_cast<float>(node.rotation[2])) : glm::quat();
-
-            transform = glm::translate(glm::mat4(1.0f), translation) *
-                glm::toMat4(rotation) *
-                glm::scale(glm::mat4(1.0f), scale);
+    });
+}
+
+void Scene::QuerySphere(const glm::vec3& center, float radius, std::vector<entt::entity>& objects) const {
+    spatialIndex.QuerySphere(center, radius, [&](uint32_t userData) {
+        entt::entity entity = static_cast<entt::entity>(userData);
+        const AABB& box = registry.get<BoundsComponent>(entity).box;
+        glm::vec3 offset = glm::clamp(center, box.min, box.max) - center;
+        if (glm::dot(offset, offset) <= radius * radius) {
+            objects.push_back(entity);
+        }
+    });
+}
+
+void Scene::QueryFrustum(const Frustum& frustum, std::vector<entt::entity>& objects) const {
+    spatialIndex.QueryFrustum(frustum, [&](uint32_t userData, bool inside) {
+        entt::entity entity = static_cast<entt::entity>(userData);
+        const AABB& box = registry.get<BoundsComponent>(entity).box;
+        if (inside || frustum.ClassifyAABB(box.min, box.max) != Frustum::Containment::Outside) {
+            objects.push_back(entity);
+        }
+    });
+}
+
+bool Scene::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const {
+    glm::vec3 inverse = 1.0f / direction;
+    hit.object = entt::null;
+
+    spatialIndex.QueryRay(origin, direction, maxDistance, [&](uint32_t userData, float) {
+        entt::entity entity = static_cast<entt::entity>(userData);
+        float entry;
+        if (registry.get<BoundsComponent>(entity).box.IntersectsRay(origin, inverse, maxDistance, entry)) {
+            hit.object = entity;
+            hit.distance = entry;
+            maxDistance = entry;
         }
+        return maxDistance;
+    });
 
-        for (size_t primIndex = 0; primIndex < mesh.primitives.size(); ++primIndex) {
-            const auto& prim = mesh.primitives[primIndex];
+    return hit.object != entt::null;
+}
 
-            std::string meshKey = path + "_mesh_" + std::to_string(node.mesh) + "_" + std::to_string(primIndex);
+bool Scene::SetObjectParent(const std::string& id, const std::string& parentId) {
+    entt::entity entity = FindObject(id);
+    if (entity == entt::null) return false;
 
-            MeshPrimitive* cachedMesh = ResourceManager::GetOrCreateMesh(meshKey, MeshPrimitive{});
+    entt::entity parent = entt::null;
+    if (!parentId.empty()) {
+        parent = FindObject(parentId);
+        if (parent == entt::null || !CanParent(entity, parent)) return false;
+    }
 
-            if (cachedMesh->vao == 0) {
-                if (!LoadPrimitive(path, model, prim, *cachedMesh)) {
-                    continue;
-                }
-            }
+    entt::entity previousParent = registry.get<HierarchyComponent>(entity).parent;
+    if (previousParent == parent) return true;
 
-            ModelInstance instance;
-            instance.mesh = cachedMesh;
-            instance.transform = transform;
-            instances.push_back(instance);
-        }
+    SceneEdit edit;
+    edit.type = SceneEdit::Type::Parent;
+    edit.id = id;
+    edit.parent = parentId;
+    if (previousParent != entt::null) {
+        edit.previousParent = registry.get<NameComponent>(previousParent).id;
     }
 
+    DetachFromParent(entity);
+    AttachToParent(entity, parent);
+    MarkTransformDirty(entity);
+    RecordEdit(edit);
     return true;
 }
 
-bool Scene::LoadPrimitive(const std::string path, const tinygltf::Model& model, const tinygltf::Primitive& primitive, MeshPrimitive& meshPrim) {
-    auto posIt = primitive.attributes.find("POSITION");
-    if (posIt == primitive.attributes.end()) {
-        return false;
+bool Scene::CanParent(entt::entity entity, entt::entity parent) const {
+    // An object cannot end up below itself
+    for (entt::entity ancestor = parent; ancestor != entt::null; ancestor = registry.get<HierarchyComponent>(ancestor).parent) {
+        if (ancestor == entity) return false;
     }
 
-    const tinygltf::Accessor& posAccessor = model.accessors[posIt->second];
-    const tinygltf::BufferView& posBufferView = model.bufferViews[posAccessor.bufferView];
-    const tinygltf::Buffer& posBuffer = model.buffers[posBufferView.buffer];
+    // Streamed cells come and go as a whole, so a hierarchy cannot span two of them
+    const CellComponent* cell = registry.try_get<CellComponent>(entity);
+    const CellComponent* parentCell = registry.try_get<CellComponent>(parent);
+    return (cell ? cell->cell : SceneStreamer::NoCell) == (parentCell ? parentCell->cell : SceneStreamer::NoCell);
+}
+
+std::string Scene::GetObjectParent(const std::string& id) const {
+    const HierarchyComponent* hierarchy = FindComponent<HierarchyComponent>(id);
+    if (!hierarchy || hierarchy->parent == entt::null) return "";
+    return registry.get<NameComponent>(hierarchy->parent).id;
+}
 
-    std::vector<float> normals;
-    auto normalIt = primitive.attributes.find("NORMAL");
-    if (normalIt != primitive.attributes.end()) {
-        const tinygltf::Accessor& normalAccessor = model.accessors[normalIt->second];
-        const tinygltf::BufferView& normalBufferView = model.bufferViews[normalAccessor.bufferView];
-        const tinygltf::Buffer& normalBuffer = model.buffers[normalBufferView.buffer];
+void Scene::AttachToParent(entt::entity entity, entt::entity parent) {
+    HierarchyComponent& hierarchy = registry.get<HierarchyComponent>(entity);
+    hierarchy.parent = parent;
+    hierarchyChanged = true;
+    if (parent == entt::null) return;
 
-        const float* normalData = reinterpret_cast<const float*>(
-            &normalBuffer.data[normalBufferView.byteOffset + normalAccessor.byteOffset]);
-        normals.assign(normalData, normalData + normalAccessor.count * 3);
+    HierarchyComponent& parentHierarchy = registry.get<HierarchyComponent>(parent);
+    hierarchy.nextSibling = parentHierarchy.firstChild;
+    if (parentHierarchy.firstChild != entt::null) {
+        registry.get<HierarchyComponent>(parentHierarchy.firstChild).prevSibling = entity;
     }
+    parentHierarchy.firstChild = entity;
+    childObjects++;
+}
 
-    std::vector<float> uvs;
-    auto uvIt = primitive.attributes.find("TEXCOORD_0");
-    if (uvIt != primitive.attributes.end()) {
-        const tinygltf::Accessor& uvAccessor = model.accessors[uvIt->second];
-        const tinygltf::BufferView& uvBufferView = model.bufferViews[uvAccessor.bufferView];
-        const tinygltf::Buffer& uvBuffer = model.buffers[uvBufferView.buffer];
+void Scene::DetachFromParent(entt::entity entity) {
+    HierarchyComponent& hierarchy = registry.get<HierarchyComponent>(entity);
+    if (hierarchy.parent == entt::null) return;
 
-        const float* uvData = reinterpret_cast<const float*>(
-            &uvBuffer.data[uvBufferView.byteOffset + uvAccessor.byteOffset]);
-        uvs.assign(uvData, uvData + uvAccessor.count * 2);
+    if (hierarchy.prevSibling != entt::null) {
+        registry.get<HierarchyComponent>(hierarchy.prevSibling).nextSibling = hierarchy.nextSibling;
+    }
+    else {
+        registry.get<HierarchyComponent>(hierarchy.parent).firstChild = hierarchy.nextSibling;
+    }
+    if (hierarchy.nextSibling != entt::null) {
+        registry.get<HierarchyComponent>(hierarchy.nextSibling).prevSibling = hierarchy.prevSibling;
     }
 
-    std::vector<unsigned int> indices;
-    if (primitive.indices >= 0) {
-        const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
-        const tinygltf::BufferView& indexBufferView = model.bufferViews[indexAccessor.bufferView];
-        const tinygltf::Buffer& indexBuffer = model.buffers[indexBufferView.buffer];
+    hierarchy.parent = entt::null;
+    hierarchy.nextSibling = entt::null;
+    hierarchy.prevSibling = entt::null;
+    hierarchyChanged = true;
+    childObjects--;
+}
+
+void Scene::RebuildHierarchyOrder() {
+    auto& hierarchies = registry.storage<HierarchyComponent>();
+    hierarchyOrder.clear();
+    hierarchyOrder.reserve(hierarchies.size());
+
+    std::vector<entt::entity> stack;
+    for (auto [root, rootHierarchy] : hierarchies.each()) {
+        if (rootHierarchy.parent != entt::null) continue;
 
-        const unsigned char* indexData = &indexBuffer.data[indexBufferView.byteOffset + indexAccessor.byteOffset];
+        stack.push_back(root);
+        while (!stack.empty()) {
+            entt::entity entity = stack.back();
+            stack.pop_back();
 
-        indices.resize(indexAccessor.count);
-        if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-            const unsigned short* shortIndices = reinterpret_cast<const unsigned short*>(indexData);
-            for (size_t i = 0; i < indexAccessor.count; ++i) {
-                indices[i] = shortIndices[i];
+            HierarchyComponent& hierarchy = registry.get<HierarchyComponent>(entity);
+            hierarchy.order = static_cast<uint32_t>(hierarchyOrder.size());
+            hierarchyOrder.push_back(entity);
+
+            for (entt::entity child = hierarchy.firstChild; child != entt::null; child = registry.get<HierarchyComponent>(child).nextSibling) {
+                stack.push_back(child);
             }
         }
-        else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
-            const unsigned int* intIndices = reinterpret_cast<const unsigned int*>(indexData);
-            indices.assign(intIndices, intIndices + indexAccessor.count);
-        }
+    }
 
-        meshPrim.indexCount = indices.size();
+    // Children sit after their parent, so walking backwards grows each parent's range by its
+    // children's before the parent itself is reached
+    hierarchyEnd.resize(hierarchyOrder.size());
+    for (uint32_t i = 0; i < hierarchyEnd.size(); ++i) {
+        hierarchyEnd[i] = i + 1;
+    }
+    for (size_t i = hierarchyOrder.size(); i-- > 0;) {
+        entt::entity parent = registry.get<HierarchyComponent>(hierarchyOrder[i]).parent;
+        if (parent != entt::null) {
+            uint32_t parentOrder = registry.get<HierarchyComponent>(parent).order;
+            hierarchyEnd[parentOrder] = std::max(hierarchyEnd[parentOrder], hierarchyEnd[i]);
+        }
     }
 
-    const float* posData = reinterpret_cast<const float*>(
-        &posBuffer.data[posBufferView.byteOffset + posAccessor.byteOffset]);
+    hierarchyChanged = false;
+}
 
-    std::vector<float> vertices;
-    size_t vertexCount = posAccessor.count;
+void Scene::SetObjectPosition(const std::string& id, const glm::vec3& position) {
+    SetTransformField(id, SceneEdit::Position, position);
+}
 
-    for (size_t i = 0; i < vertexCount; ++i) {
-        vertices.push_back(posData[i * 3 + 0]);
-        vertices.push_back(posData[i * 3 + 1]);
-        vertices.push_back(posData[i * 3 + 2]);
+void Scene::SetObjectRotation(const std::string& id, const glm::vec3& rotation) {
+    SetTransformField(id, SceneEdit::Rotation, rotation);
+}
 
-        if (!normals.empty()) {
-            vertices.push_back(normals[i * 3 + 0]);
-            vertices.push_back(normals[i * 3 + 1]);
-            vertices.push_back(normals[i * 3 + 2]);
-        }
-        else {
-            vertices.push_back(0.0f);
-            vertices.push_back(1.0f);
-            vertices.push_back(0.0f);
-        }
+void Scene::SetObjectScale(const std::string& id, const glm::vec3& scale) {
+    SetTransformField(id, SceneEdit::Scale, scale);
+}
 
-        if (!uvs.empty()) {
-            vertices.push_back(uvs[i * 2 + 0]);
-            vertices.push_back(uvs[i * 2 + 1]);
-        }
-        else {
-            vertices.push_back(0.0f);
-            vertices.push_back(0.0f);
+void Scene::SetBGColor(float r, float g, float b) {
+    SetBackground(glm::vec3(r, g, b) / 255.0f);
+}
+
+void Scene::SetBackground(const glm::vec3& color) {
+    bool merge = std::exchange(mergeNextEdit, false);
+    if (bg_color == color) return;
+
+    SceneEdit edit;
+    edit.type = SceneEdit::Type::Background;
+    edit.previousValue = bg_color;
+    edit.value = color;
+
+    bg_color = color;
+    mergeNextEdit = merge;
+    RecordEdit(edit);
+}
+
+void Scene::AddPathAlias(std::string key, std::string value) {
+    SceneEdit edit;
+    edit.type = SceneEdit::Type::AddAlias;
+    edit.id = key;
+    edit.text = value;
+
+    path_aliases.emplace_back(std::move(key), std::move(value));
+    RecordEdit(edit);
+}
+
+void Scene::RemovePathAlias(const std::string& key, const std::string& value) {
+    // The newest match, which is the one an undone AddPathAlias added
+    for (size_t i = path_aliases.size(); i-- > 0;) {
+        if (path_aliases[i].first == key && path_aliases[i].second == value) {
+            path_aliases.erase(path_aliases.begin() + i);
+
+            SceneEdit edit;
+            edit.type = SceneEdit::Type::RemoveAlias;
+            edit.id = key;
+            edit.text = value;
+            RecordEdit(edit);
+            return;
         }
     }
+}
 
-    glGenVertexArrays(1, &meshPrim.vao);
-    glGenBuffers(1, &meshPrim.vbo);
-    glGenBuffers(1, &meshPrim.ebo);
+void Scene::MoveObject(const std::string& id, const glm::vec3& offset) {
+    const TransformComponent* transform = FindComponent<TransformComponent>(id);
+    if (!transform) {
+        mergeNextEdit = false;
+        return;
+    }
+    SetTransformField(id, SceneEdit::Position, transform->position + offset);
+}
 
-    glBindVertexArray(meshPrim.vao);
+void Scene::RotateObject(const std::string& id, const glm::vec3& rotation) {
+    const TransformComponent* transform = FindComponent<TransformComponent>(id);
+    if (!transform) {
+        mergeNextEdit = false;
+        return;
+    }
+    SetTransformField(id, SceneEdit::Rotation, transform->rotation + rotation);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, meshPrim.vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+void Scene::ScaleObject(const std::string& id, const glm::vec3& scale) {
+    const TransformComponent* transform = FindComponent<TransformComponent>(id);
+    if (!transform) {
+        mergeNextEdit = false;
+        return;
+    }
+    SetTransformField(id, SceneEdit::Scale, transform->scale * scale);
+}
+
+void Scene::RenderScene(Renderer& renderer, const ICamera& camera) const {
+    glClearColor(bg_color.r, bg_color.g, bg_color.b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    Frustum frustum = Frustum::FromMatrix(renderer.GetProjectionMatrix() * camera.GetViewMatrix());
+
+    cullSpheres.Clear();
+    cullCandidates.clear();
+    cullLodStates.clear();
+
+    // The spatial index rejects whole groups of objects outside the frustum, the instances of the
+    // objects left are then tested one by one
+    cullObjects.clear();
+    QueryFrustum(frustum, cullObjects);
 
-    if (!indices.empty()) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshPrim.ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    for (entt::entity entity : cullObjects) {
+        const glm::mat4& objTransform = registry.get<WorldMatrixComponent>(entity).matrix;
+        const RenderableComponent& renderable = registry.get<RenderableComponent>(entity);
+        const std::vector<ModelInstance>& instances = GetInstances(renderable);
+
+        for (size_t i = 0; i < instances.size(); ++i) {
+            const ModelInstance& instance = instances[i];
+            const MeshPrimitive* mesh = ResourceManager::GetMesh(instance.mesh);
+            if (!mesh) continue;
+
+            glm::mat4 world = objTransform * instance.transform;
+            const MeshBounds& bounds = mesh->bounds;
+
+            float maxScale = std::max(glm::length(glm::vec3(world[0])),
+                std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+
+            cullSpheres.Add(glm::vec3(world * glm::vec4(bounds.center, 1.0f)), bounds.radius * maxScale);
+            cullCandidates.push_back({ world, instance.mesh });
+            cullLodStates.push_back(i < RenderableComponent::LodStates ? &renderable.lods[i] : nullptr);
+        }
+    }
+
+    size_t visibleCount = frustum.CullSpheres(cullSpheres, cullVisibility);
+
+    cullStats.tested = static_cast<unsigned int>(cullCandidates.size());
+    cullStats.visible = static_cast<unsigned int>(visibleCount);
+    cullStats.culled = cullStats.tested - cullStats.visible;
+
+    renderer.BeginFrame(camera);
+    for (size_t i = 0; i < cullCandidates.size(); ++i) {
+        if (cullVisibility[i]) {
+            renderer.Submit(cullCandidates[i].mesh, cullCandidates[i].transform, cullLodStates[i]);
+        }
     }
+    renderer.Flush();
+}
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+bool Scene::LoadModel(const std::string& path, PrefabHandle& prefab) {
+    if (AssetLoader::GetCachedModel(path, prefab)) {
+        return true;
+    }
 
-    glBindVertexArray(0);
+    CpuModel model;
+    if (!AssetLoader::BuildModel(path, model)) {
+        return false;
+    }
 
-    if (primitive.material >= 0) {
-        const tinygltf::Material& material = model.materials[primitive.material];
+    return AssetLoader::UploadModel(model, prefab);
+}
 
-        if (material.pbrMetallicRoughness.baseColorTexture.index >= 0) {
-            int textureIndex = material.pbrMetallicRoughness.baseColorTexture.index;
-            const tinygltf::Texture& texture = model.textures[textureIndex];
-            const tinygltf::Image& image = model.images[texture.source];
+void Scene::ProcessLoads(double budgetMs) {
+    auto start = std::chrono::steady_clock::now();
 
-            std::string textureKey = path + "_texture_" + std::to_string(textureIndex);
+    size_t kept = 0;
+    for (size_t i = 0; i < pendingLoads.size(); ++i) {
+        PendingLoad& pending = pendingLoads[i];
 
-            GLuint textureId = 0;
-            glGenTextures(1, &textureId);
-            glBindTexture(GL_TEXTURE_2D, textureId);
+        bool overBudget = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs;
+        if (overBudget || !pending.job->done.load(std::memory_order_acquire)) {
+            if (kept != i) {
+                pendingLoads[kept] = std::move(pending);
+            }
+            ++kept;
+            continue;
+        }
 
-            GLenum format = GL_RGB;
-            if (image.component == 4) {
-                format = GL_RGBA;
+        ModelJob& job = *pending.job;
+        if (!job.uploaded) {
+            job.uploaded = true;
+            if (job.success) {
+                job.success = AssetLoader::UploadModel(job.model, job.prefab);
             }
-            else if (image.component == 1) {
-                format = GL_RED;
+            if (job.success) {
+                ResourceManager::AcquirePrefab(job.prefab);
             }
+            // The CPU copy is no longer needed once it is on the GPU
+            job.model = CpuModel();
+        }
 
-            glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0,
-                format, GL_UNSIGNED_BYTE, image.image.data());
+        // The object may have been removed, or removed and its entity reused, while loading
+        RenderableComponent* renderable = registry.valid(pending.entity) ?
+            registry.try_get<RenderableComponent>(pending.entity) : nullptr;
+        if (renderable && renderable->loading) {
+            if (job.success) {
+                renderable->prefab = job.prefab;
+                renderable->loading = false;
+                ResourceManager::AcquirePrefab(renderable->prefab);
+                // Its bounds grow from the placeholder cube to the model. The object itself did not
+                // change, so this is not an edit of its cell.
+                registry.emplace_or_replace<TransformDirtyTag>(pending.entity);
+            }
+            else {
+                std::cerr << "Failed to load model for object: " << registry.get<NameComponent>(pending.entity).id
+                    << " at path: " << job.path << std::endl;
+                DestroyObject(pending.entity);
+            }
+        }
 
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glGenerateMipmap(GL_TEXTURE_2D);
+        if (!job.success) {
+            pending.handle.state->failed++;
+        }
+        pending.handle.state->finished++;
+        ReleasePendingJob(job);
+    }
+    pendingLoads.resize(kept);
+}
 
-            meshPrim.texture = ResourceManager::GetOrCreateTexture(textureKey, textureId);
+void Scene::WaitForLoad(const LoadHandle& handle) {
+    while (!handle.IsDone()) {
+        ProcessLoads(std::numeric_limits<double>::infinity());
+        if (!handle.IsDone()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
+}
+
+void Scene::CancelPendingLoads() {
+    // Anyone waiting on an abandoned load sees it finish as failed
+    for (PendingLoad& pending : pendingLoads) {
+        pending.handle.state->failed++;
+        pending.handle.state->finished++;
+        ReleasePendingJob(*pending.job);
+    }
+    pendingLoads.clear();
+}
 
-    return true;
+void Scene::ReleasePendingJob(ModelJob& job) {
+    if (--job.pendingObjects == 0 && job.uploaded && job.success) {
+        ResourceManager::ReleasePrefab(job.prefab);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "AABBTree.hpp"
+#include "ResourceHandle.hpp"
+#include "StringTable.hpp"
+#include <entt/entity/entity.hpp>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Components of a scene object. Scene keeps each type in its own packed EnTT pool, so passes
+// that only need transforms or physics settings never touch names or model references.
+
+struct NameComponent {
+    std::string id;
+};
+
+struct TransformComponent {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 rotation = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+// Cached matrices of the object, rebuilt by Scene::UpdateTransforms. local is translate * rotate
+// * scale of the TransformComponent, matrix is local composed with the parent's world matrix.
+struct WorldMatrixComponent {
+    glm::mat4 local = glm::mat4(1.0f);
+    glm::mat4 matrix = glm::mat4(1.0f);
+};
+
+// Links of an object in the scene's transform hierarchy. Its TransformComponent is relative to
+// the parent. Children of one parent form a doubly linked list.
+struct HierarchyComponent {
+    entt::entity parent = entt::null;
+    entt::entity firstChild = entt::null;
+    entt::entity nextSibling = entt::null;
+    entt::entity prevSibling = entt::null;
+    // Position in the scene's depth-first order, valid after UpdateTransforms
+    uint32_t order = 0;
+};
+
+// World space box around every instance of the object and its leaf in the scene's spatial index,
+// both as of the last UpdateTransforms
+struct BoundsComponent {
+    AABB box;
+    int proxy = AABBTree::Null;
+};
+
+// Present while the TransformComponent changed since the world matrix was last rebuilt
+struct TransformDirtyTag {};
+
+// Streamed cell the object was created from. Objects added in the editor have none.
+struct CellComponent {
+    uint32_t cell = 0;
+};
+
+// modelPath is the path as written in the scene, aliases unresolved. The model's instances live in
+// its shared prefab, the object only keeps a reference and what the renderer tracks per object.
+struct RenderableComponent {
+    static constexpr size_t LodStates = 8;
+
+    StringId modelPath = 0;
+    PrefabHandle prefab;
+    bool loading = false;
+    // Level the renderer picked last frame for each of the first LodStates instances, kept for its
+    // hysteresis. Instances past those pick their level without it.
+    mutable std::array<uint8_t, LodStates> lods{};
+};
+
+struct PhysicsProperties {
+    bool hasCollision = false;
+    bool isAffectedByPhysics = false;
+    bool isStatic = false;
+    float mass = 1.0f;
+    glm::vec3 collisionShapeSize = glm::vec3(1.0f);
+};
\ No newline at end of file
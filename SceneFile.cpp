@@ -1,11 +1,18 @@
 #include "Scene.hpp"
+#include "SceneFormat.hpp"
+#include "SceneJournal.hpp"
+#include "SceneStreamer.hpp"
+#include "ResourceManager.hpp"
 #include "Utils.hpp"
 
+#include <chrono>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 
-bool Scene::SaveToFile(const std::string& filePath) const {
+bool Scene::SaveToFile(const std::string& filePath) {
+    // Saves still being written go first, so this one lands last
+    activeSave.Wait();
+
     try {
         std::filesystem::path path(filePath);
         path = std::filesystem::absolute(path);
@@ -14,38 +21,22 @@ bool Scene::SaveToFile(const std::string& filePath) const {
             std::filesystem::create_directories(path.parent_path());
         }
 
-        std::ofstream file(path, std::ios::binary);
-        if (!file.is_open()) {
-            std::cerr << "Failed to open file for writing: " << path << std::endl;
-            return false;
+        SceneDescription description;
+        BuildDescription(description);
+        if (cellSize > 0.0f) {
+            SceneFormat::Partition(description, cellSize);
         }
 
-        const char* signature = "SCENE002";
-        file.write(signature, 8);
-
-        file.write(reinterpret_cast<const char*>(&bg_color), sizeof(bg_color));
-
-        size_t aliasCount = path_aliases.size();
-        file.write(reinterpret_cast<const char*>(&aliasCount), sizeof(aliasCount));
-
-        for (const auto& alias : path_aliases) {
-            size_t keyLen = alias.first.length();
-            file.write(reinterpret_cast<const char*>(&keyLen), sizeof(keyLen));
-            file.write(alias.first.c_str(), keyLen);
-
-            size_t valueLen = alias.second.length();
-            file.write(reinterpret_cast<const char*>(&valueLen), sizeof(valueLen));
-            file.write(alias.second.c_str(), valueLen);
+        // Saving elsewhere moves journaling to the new file once it is written
+        std::shared_ptr<SceneJournal> target = journal;
+        if (!target || target->GetScenePath() != path.string()) {
+            target = std::make_shared<SceneJournal>(path.string());
         }
-
-        size_t objectCount = objects.size();
-        file.write(reinterpret_cast<const char*>(&objectCount), sizeof(objectCount));
-
-        for (const auto& [id, obj] : objects) {
-            obj.WriteToBinary(file);
+        if (!target->WriteSnapshot(description, target->BeginSnapshot())) {
+            return false;
         }
+        journal = std::move(target);
 
-        file.close();
         std::cout << "Scene saved to: " << path << std::endl;
         return true;
     }
@@ -55,197 +46,331 @@ bool Scene::SaveToFile(const std::string& filePath) const {
     }
 }
 
-bool Scene::LoadFromFile(const std::string& filePath) {
+SaveHandle Scene::SaveToFileAsync(const std::string& filePath, std::function<void(const SaveHandle&)> onComplete) {
+    SaveHandle handle;
+    handle.state = std::make_shared<SaveHandle::State>();
+    handle.state->onComplete = std::move(onComplete);
+    if (handle.state->onComplete) {
+        pendingSaves.push_back(handle);
+    }
+
     try {
+        auto start = std::chrono::steady_clock::now();
         std::filesystem::path path(filePath);
         path = std::filesystem::absolute(path);
+        handle.state->path = path.string();
 
-        if (!std::filesystem::exists(path)) {
-            std::cerr << "File does not exist: " << path << std::endl;
-            return false;
-        }
-
-        std::ifstream file(path, std::ios::binary);
-        if (!file.is_open()) {
-            std::cerr << "Failed to open file for reading: " << path << std::endl;
-            return false;
+        if (path.has_parent_path()) {
+            std::filesystem::create_directories(path.parent_path());
         }
 
-        objects.clear();
-        path_aliases.clear();
+        // Flat arrays and the ids' text are all the frame pays for, partitioning and writing
+        // happen on the saver's thread
+        auto description = std::make_unique<SceneDescription>();
+        BuildDescription(*description);
+        handle.state->objectCount = static_cast<uint32_t>(description->GetObjectCount());
 
-        char signature[9] = { 0 };
-        if (!file.read(signature, 8)) {
-            std::cerr << "Failed to read file signature" << std::endl;
-            return false;
-        }
-
-        bool hasPhysicsData = false;
-        if (std::strncmp(signature, "SCENE002", 8) == 0) {
-            hasPhysicsData = true;
-        }
-        else if (std::strncmp(signature, "SCENE001", 8) != 0) {
-            std::cerr << "Invalid file format or version" << std::endl;
-            return false;
+        // Edits from here on are not in the snapshot, they go to the journal of the new file. It
+        // keeps them in memory until the file is written.
+        if (!journal || journal->GetScenePath() != handle.state->path) {
+            journal = std::make_shared<SceneJournal>(handle.state->path);
         }
+        uint64_t sequence = journal->BeginSnapshot();
 
-        if (!file.read(reinterpret_cast<char*>(&bg_color), sizeof(bg_color))) {
-            std::cerr << "Failed to read background color" << std::endl;
-            return false;
+        if (!saver) {
+            saver = std::make_unique<SceneSaver>();
         }
+        handle.state->snapshotMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        saver->Queue(handle, std::move(description), journal, sequence, cellSize);
+        activeSave = handle;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error saving scene to file: " << e.what() << std::endl;
+        handle.state->stage = SaveHandle::Stage::Failed;
+        handle.state->promise.set_value(false);
+    }
+    return handle;
+}
 
-        size_t aliasCount;
-        if (!file.read(reinterpret_cast<char*>(&aliasCount), sizeof(aliasCount))) {
-            std::cerr << "Failed to read alias count" << std::endl;
-            return false;
+void Scene::ProcessSaves() {
+    // Callbacks may start new saves, so the finished ones are taken out first
+    std::vector<SaveHandle> finished;
+    size_t kept = 0;
+    for (size_t i = 0; i < pendingSaves.size(); ++i) {
+        if (pendingSaves[i].IsDone()) {
+            finished.push_back(std::move(pendingSaves[i]));
         }
-
-        if (aliasCount > 1000) {
-            std::cerr << "Invalid alias count" << std::endl;
-            return false;
+        else {
+            if (kept != i) {
+                pendingSaves[kept] = std::move(pendingSaves[i]);
+            }
+            ++kept;
         }
+    }
+    pendingSaves.resize(kept);
 
-        for (size_t i = 0; i < aliasCount; ++i) {
-            size_t keyLen, valueLen;
-
-            if (!file.read(reinterpret_cast<char*>(&keyLen), sizeof(keyLen))) return false;
-            if (keyLen > 1024) return false;
-
-            std::string key(keyLen, '\0');
-            if (!file.read(&key[0], keyLen)) return false;
+    for (const SaveHandle& save : finished) {
+        save.state->onComplete(save);
+    }
+}
 
-            if (!file.read(reinterpret_cast<char*>(&valueLen), sizeof(valueLen))) return false;
-            if (valueLen > 2048) return false;
+void Scene::BuildDescription(SceneDescription& description) const {
+    description.backgroundColor = bg_color;
+    for (const auto& alias : path_aliases) {
+        description.aliases.emplace_back(description.AddString(alias.first), description.AddString(alias.second));
+    }
 
-            std::string value(valueLen, '\0');
-            if (!file.read(&value[0], valueLen)) return false;
+    size_t objectCount = streamer ? streamer->GetArchive().GetObjectCount() + names.size() : names.size();
+    description.ids.reserve(objectCount);
+    description.modelPaths.reserve(objectCount);
+    description.parents.reserve(objectCount);
+    description.transforms.reserve(objectCount);
+    description.physics.reserve(objectCount);
+    description.strings.reserve(objectCount + 16);
+
+    // Model paths are interned already, so most objects find theirs without hashing the text
+    ModelStrings modelStrings;
+    for (auto [root, rootHierarchy] : registry.view<const HierarchyComponent>().each()) {
+        if (rootHierarchy.parent != entt::null || (streamer && registry.all_of<CellComponent>(root))) continue;
+        DescribeSubtree(root, description, modelStrings);
+    }
 
-            path_aliases.emplace_back(key, value);
+    if (streamer) {
+        const SceneArchive& archive = streamer->GetArchive();
+        for (uint32_t i = 0; i < streamer->GetCellCount(); ++i) {
+            const SceneStreamer::Cell& cell = streamer->GetCell(i);
+            if (IsCellInRegistry(i)) {
+                DescribeCell(i, description);
+            }
+            else if (cell.edits) {
+                description.Append(*cell.edits, 0, cell.edits->GetObjectCount());
+            }
+            else if (cell.edited && cell.state == SceneStreamer::CellState::Ready) {
+                description.Append(*cell.objects, 0, cell.objects->GetObjectCount());
+            }
+            else {
+                const SceneCell& range = archive.GetCells()[i];
+                archive.ReadObjects(range.firstObject, range.objectCount, description);
+            }
         }
+    }
+}
 
-        size_t objectCount;
-        if (!file.read(reinterpret_cast<char*>(&objectCount), sizeof(objectCount))) {
-            std::cerr << "Failed to read object count" << std::endl;
-            return false;
+void Scene::DescribeSubtree(entt::entity root, SceneDescription& description, ModelStrings& modelStrings,
+    std::unordered_map<entt::entity, uint32_t>* objectIndices) const
+{
+    // Depth-first with each entity's parent index alongside it, so parents are written before
+    // their children
+    std::vector<std::pair<entt::entity, uint32_t>> stack;
+    stack.emplace_back(root, SceneDescription::NoParent);
+    while (!stack.empty()) {
+        auto [entity, parent] = stack.back();
+        stack.pop_back();
+
+        StringId modelPath = registry.get<RenderableComponent>(entity).modelPath;
+        auto model = modelStrings.find(modelPath);
+        if (model == modelStrings.end()) {
+            model = modelStrings.emplace(modelPath, description.AddString(StringTable::GetString(modelPath))).first;
         }
 
-        if (objectCount > 10000) {
-            std::cerr << "Invalid object count" << std::endl;
-            return false;
+        uint32_t index = static_cast<uint32_t>(description.ids.size());
+        if (objectIndices) {
+            objectIndices->emplace(entity, index);
         }
 
-        for (size_t i = 0; i < objectCount; ++i) {
-            SceneObject obj;
-            if (!obj.ReadFromBinary(file)) {
-                std::cerr << "Failed to read object " << i << std::endl;
-                return false;
-            }
-
-            std::string local_path = obj.modelPath;
-
-            if (obj.modelPath[0] == '@') {
-                int s_pos = obj.modelPath.find('/');
-                if (s_pos > obj.modelPath.find('\\')) {
-                    s_pos = obj.modelPath.find('\\');
-                }
+        // Ids are unique within the scene, so only model paths and aliases need deduplicating
+        description.ids.push_back(description.AppendString(registry.get<NameComponent>(entity).id));
+        description.modelPaths.push_back(model->second);
+        description.parents.push_back(parent);
+        description.transforms.push_back(registry.get<TransformComponent>(entity));
+        description.physics.push_back(registry.get<PhysicsProperties>(entity));
 
-                if (s_pos != std::string::npos) {
-                    std::string target = obj.modelPath.substr(1, s_pos - 1);
-
-                    auto alias = std::find_if(path_aliases.begin(), path_aliases.end(),
-                        [&target](const std::pair<std::string, std::string>& p) {
-                            return p.first == target;
-                        });
-
-                    if (alias != path_aliases.end()) {
-                        local_path = alias->second + obj.modelPath.substr(s_pos);
-                    }
-                }
-            }
+        const HierarchyComponent& hierarchy = registry.get<HierarchyComponent>(entity);
+        for (entt::entity child = hierarchy.firstChild; child != entt::null; child = registry.get<HierarchyComponent>(child).nextSibling) {
+            stack.emplace_back(child, index);
+        }
+    }
+}
 
-            local_path = Utils::GetFullPath(local_path.c_str());
+void Scene::DescribeCell(uint32_t index, SceneDescription& description) const {
+    const SceneStreamer::Cell& cell = streamer->GetCell(index);
+    bool creating = cell.state == SceneStreamer::CellState::Creating;
 
-            if (LoadModel(local_path, obj.instances)) {
-                objects[obj.id] = std::move(obj);
-            }
-            else {
-                std::cerr << "Failed to load model for object: " << obj.id
-                    << " at path: " << local_path << std::endl;
-            }
+    // Hierarchies never leave their cell, so the cell's roots reach all of its objects
+    ModelStrings modelStrings;
+    std::unordered_map<entt::entity, uint32_t> objectIndices;
+    for (entt::entity entity : cell.entities) {
+        if (registry.valid(entity) && registry.get<HierarchyComponent>(entity).parent == entt::null) {
+            DescribeSubtree(entity, description, modelStrings, creating ? &objectIndices : nullptr);
         }
-
-        file.close();
-        std::cout << "Scene loaded from: " << path << std::endl;
-        return true;
     }
-    catch (const std::exception& e) {
-        std::cerr << "Error loading scene from file: " << e.what() << std::endl;
-        return false;
+    if (!creating) return;
+
+    // Objects not created yet may be children of created ones
+    const SceneDescription& objects = *cell.objects;
+    size_t first = description.GetObjectCount();
+    description.Append(objects, cell.created, objects.GetObjectCount() - cell.created);
+    for (size_t i = cell.created; i < objects.GetObjectCount(); ++i) {
+        uint32_t parent = objects.parents[i];
+        if (parent == SceneDescription::NoParent || parent >= cell.created) continue;
+
+        auto written = objectIndices.find(cell.entities[parent]);
+        if (written != objectIndices.end()) {
+            description.parents[first + i - cell.created] = written->second;
+        }
     }
 }
 
-void SceneObject::WriteToBinary(std::ofstream& file) const {
-    size_t idLen = id.length();
-    file.write(reinterpret_cast<const char*>(&idLen), sizeof(idLen));
-    file.write(id.c_str(), idLen);
+entt::entity Scene::InstantiateObject(const SceneDescription& objects, size_t index, std::unordered_map<uint32_t, ModelSource>& models, const LoadHandle& handle) {
+    auto [model, added] = models.try_emplace(objects.modelPaths[index]);
+    ModelSource& source = model->second;
+    if (added) {
+        std::string modelPath(objects.strings[objects.modelPaths[index]]);
+        source.modelPath = StringTable::Intern(modelPath);
 
-    size_t pathLen = modelPath.length();
-    file.write(reinterpret_cast<const char*>(&pathLen), sizeof(pathLen));
-    file.write(modelPath.c_str(), pathLen);
+        // Unknown aliases fall back to the path as written
+        ResolveModelPath(modelPath, source.localPath);
+        source.cached = AssetLoader::GetCachedModel(source.localPath, source.prefab);
+    }
 
-    file.write(reinterpret_cast<const char*>(&position), sizeof(position));
-    file.write(reinterpret_cast<const char*>(&rotation), sizeof(rotation));
-    file.write(reinterpret_cast<const char*>(&scale), sizeof(scale));
+    entt::entity entity = CreateObject(std::string(objects.strings[objects.ids[index]]), source.modelPath,
+        objects.transforms[index], objects.physics[index]);
+    RenderableComponent& renderable = registry.get<RenderableComponent>(entity);
 
-    file.write(reinterpret_cast<const char*>(&physics.hasCollision), sizeof(physics.hasCollision));
-    file.write(reinterpret_cast<const char*>(&physics.isAffectedByPhysics), sizeof(physics.isAffectedByPhysics));
-    file.write(reinterpret_cast<const char*>(&physics.isStatic), sizeof(physics.isStatic));
-    file.write(reinterpret_cast<const char*>(&physics.mass), sizeof(physics.mass));
-    file.write(reinterpret_cast<const char*>(&physics.collisionShapeSize), sizeof(physics.collisionShapeSize));
+    handle.state->total++;
+    if (source.cached) {
+        renderable.prefab = source.prefab;
+        ResourceManager::AcquirePrefab(renderable.prefab);
+        handle.state->finished++;
+    }
+    else {
+        if (!source.job) {
+            source.job = assetLoader->Request(source.localPath);
+        }
+        renderable.loading = true;
+        pendingLoads.push_back({ entity, source.job, handle });
+        source.job->pendingObjects++;
+    }
+    return entity;
 }
 
-bool SceneObject::ReadFromBinary(std::ifstream& file) {
+LoadHandle Scene::LoadFromFile(const std::string& filePath) {
+    // The journal of the file being reloaded, kept from writing it while it is read
+    SceneJournal* suspendedJournal = nullptr;
     try {
-        std::streampos startPos = file.tellg();
+        std::filesystem::path path(filePath);
+        path = std::filesystem::absolute(path);
 
-        size_t idLen;
-        if (!file.read(reinterpret_cast<char*>(&idLen), sizeof(idLen))) return false;
-        if (idLen > 1024) return false;
+        if (!std::filesystem::exists(path)) {
+            std::cerr << "File does not exist: " << path << std::endl;
+            return LoadHandle();
+        }
 
-        id.resize(idLen);
-        if (!file.read(&id[0], idLen)) return false;
+        // Reloading the journaled file, neither a save nor the journal must write it behind the read.
+        // The journal stays until the file is read and its new journal open, a load that fails
+        // leaves the scene recording edits as before.
+        activeSave.Wait();
+        if (journal && journal->GetScenePath() == path.string()) {
+            suspendedJournal = journal.get();
+            suspendedJournal->Suspend();
+        }
 
-        size_t pathLen;
-        if (!file.read(reinterpret_cast<char*>(&pathLen), sizeof(pathLen))) return false;
-        if (pathLen > 2048) return false;
+        SceneDescription description;
+        std::shared_ptr<SceneArchive> archive;
+        std::unique_ptr<SceneJournal> loadedJournal;
+        if (!ReadJournaledFile(path.string(), description, archive, loadedJournal)) {
+            if (suspendedJournal) {
+                suspendedJournal->Resume();
+            }
+            return LoadHandle();
+        }
+        suspendedJournal = nullptr;
 
-        modelPath.resize(pathLen);
-        if (!file.read(&modelPath[0], pathLen)) return false;
+        CancelPendingLoads();
+        ClearObjects();
+        ClearHistory();
+        streamer.reset();
+        path_aliases.clear();
+        journal = std::move(loadedJournal);
 
-        if (!file.read(reinterpret_cast<char*>(&position), sizeof(position))) return false;
-        if (!file.read(reinterpret_cast<char*>(&rotation), sizeof(rotation))) return false;
-        if (!file.read(reinterpret_cast<char*>(&scale), sizeof(scale))) return false;
+        if (!assetLoader) {
+            assetLoader = std::make_unique<AssetLoader>();
+        }
 
-        std::streampos beforePhysics = file.tellg();
+        LoadHandle handle;
+        handle.state = std::make_shared<LoadHandle::State>();
 
-        bool readSuccess = true;
-        readSuccess &= (bool)file.read(reinterpret_cast<char*>(&physics.hasCollision), sizeof(physics.hasCollision));
-        readSuccess &= (bool)file.read(reinterpret_cast<char*>(&physics.isAffectedByPhysics), sizeof(physics.isAffectedByPhysics));
-        readSuccess &= (bool)file.read(reinterpret_cast<char*>(&physics.isStatic), sizeof(physics.isStatic));
-        readSuccess &= (bool)file.read(reinterpret_cast<char*>(&physics.mass), sizeof(physics.mass));
-        readSuccess &= (bool)file.read(reinterpret_cast<char*>(&physics.collisionShapeSize), sizeof(physics.collisionShapeSize));
+        const std::vector<std::string_view>& strings = description.strings;
+        bg_color = description.backgroundColor;
+        cellSize = description.cellSize;
+        for (const auto& alias : description.aliases) {
+            path_aliases.emplace_back(std::string(strings[alias.first]), std::string(strings[alias.second]));
+        }
+
+        // Partitioned scenes create their objects as UpdateStreaming brings their cells in
+        if (archive) {
+            streamer = std::make_unique<SceneStreamer>(std::move(archive));
+            activeLoad = handle;
+            std::cout << "Scene streaming from: " << path << " (" << streamer->GetCellCount() << " cells)" << std::endl;
+            return handle;
+        }
 
-        if (!readSuccess) {
-            file.clear();
-            file.seekg(beforePhysics);
+        // Paths are resolved and looked up in the model cache once per distinct model, not per object
+        std::unordered_map<uint32_t, ModelSource> models;
 
-            physics = PhysicsProperties{};
+        size_t objectCount = description.GetObjectCount();
+        names.reserve(objectCount);
+        std::vector<entt::entity> entities(objectCount);
+        for (size_t i = 0; i < objectCount; ++i) {
+            entities[i] = InstantiateObject(description, i, models, handle);
         }
 
-        return true;
+        // Parents come first in the file, so they all exist by now. An object whose parent was
+        // replaced by a later one with the same id stays a root.
+        for (size_t i = 0; i < objectCount; ++i) {
+            uint32_t parent = description.parents[i];
+            if (parent != SceneDescription::NoParent && registry.valid(entities[i]) && registry.valid(entities[parent])) {
+                AttachToParent(entities[i], entities[parent]);
+            }
+        }
+
+        activeLoad = handle;
+        std::cout << "Scene loading from: " << path << " (" << handle.GetTotal() << " objects)" << std::endl;
+        return handle;
     }
     catch (const std::exception& e) {
-        std::cerr << "Error reading SceneObject from binary: " << e.what() << std::endl;
+        std::cerr << "Error loading scene from file: " << e.what() << std::endl;
+        if (suspendedJournal) {
+            suspendedJournal->Resume();
+        }
+        return LoadHandle();
+    }
+}
+
+bool Scene::ReadJournaledFile(const std::string& path, SceneDescription& description, std::shared_ptr<SceneArchive>& archive,
+    std::unique_ptr<SceneJournal>& loadedJournal)
+{
+    if (!SceneFormat::Read(path, description, &archive)) {
+        return false;
+    }
+
+    // Edits that only reached the journal, because the editor crashed or was closed without
+    // saving, are applied as if the file had them
+    loadedJournal = std::make_unique<SceneJournal>(path);
+    std::vector<uint8_t> journalTail;
+    if (!loadedJournal->Open(description, journalTail)) {
+        std::cerr << "Failed to open scene journal: " << SceneJournal::GetJournalPath(path) << std::endl;
         return false;
     }
+    if (journalTail.empty()) return true;
+
+    std::cout << "Scene recovering journaled edits: " << SceneJournal::GetJournalPath(path) << std::endl;
+    if (archive) {
+        // A streamed scene is read from the file cell by cell, so they go into the file first
+        archive.reset();
+        description = SceneDescription();
+        return loadedJournal->Compact() && SceneFormat::Read(path, description, &archive);
+    }
+    SceneJournal::Replay(journalTail, 0, description);
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,669 @@
+#include "SceneFormat.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+static_assert(std::endian::native == std::endian::little, "scene file arrays are read and written as raw little-endian memory");
+
+struct SceneFormat::Header {
+    char magic[8];
+    uint32_t chunkCount;
+    uint32_t reserved;
+    uint64_t fileSize;
+};
+
+struct SceneFormat::ChunkEntry {
+    uint32_t id;
+    // Elements in the chunk, for chunks that hold one per object or string
+    uint32_t count;
+    uint64_t offset;
+    uint64_t size;
+};
+
+static constexpr uint32_t MakeChunkId(const char (&name)[5]) {
+    return uint32_t(uint8_t(name[0])) | uint32_t(uint8_t(name[1])) << 8 | uint32_t(uint8_t(name[2])) << 16 | uint32_t(uint8_t(name[3])) << 24;
+}
+
+// uint32 offsets[count + 1] into the string bytes, string i spans offsets[i] to offsets[i + 1]
+static constexpr uint32_t StringOffsetsChunk = MakeChunkId("STRO");
+static constexpr uint32_t StringDataChunk = MakeChunkId("STRD");
+// float backgroundColor[3], cellSize. Files without the cell size are not partitioned.
+static constexpr uint32_t SettingsChunk = MakeChunkId("SETT");
+// uint32 key, value string indices per alias
+static constexpr uint32_t AliasChunk = MakeChunkId("ALIA");
+// SceneCell per cell, in object order and covering every object
+static constexpr uint32_t CellChunk = MakeChunkId("CELL");
+// uint64 journal lineage and sequence of the last journal record in the file
+static constexpr uint32_t JournalChunk = MakeChunkId("JRNL");
+// uint32 per object: id string, model path string, parent object or NoParent
+static constexpr uint32_t ObjectIdChunk = MakeChunkId("OBID");
+static constexpr uint32_t ObjectModelChunk = MakeChunkId("OBMD");
+static constexpr uint32_t ObjectParentChunk = MakeChunkId("OBPA");
+// float arrays of positionX, Y, Z, rotationX, Y, Z, scaleX, Y, Z
+static constexpr uint32_t TransformChunk = MakeChunkId("XFRM");
+// uint8 per object of PhysicsFlag bits
+static constexpr uint32_t PhysicsFlagChunk = MakeChunkId("PHFL");
+// float arrays of mass, collisionShapeSize X, Y, Z
+static constexpr uint32_t PhysicsValueChunk = MakeChunkId("PHVL");
+
+enum PhysicsFlag : uint8_t {
+    HasCollision = 1,
+    IsAffectedByPhysics = 2,
+    IsStatic = 4
+};
+
+static_assert(sizeof(SceneCell) == 16, "cells are stored as they are laid out in memory");
+
+static const char ChunkedMagic[8] = { 'S', 'C', 'E', 'N', 'E', '0', '0', '3' };
+
+uint32_t SceneDescription::AddString(std::string_view text) {
+    auto it = lookup.find(text);
+    if (it != lookup.end()) {
+        return it->second;
+    }
+
+    uint32_t index = AppendString(text);
+    lookup.emplace(strings[index], index);
+    return index;
+}
+
+uint32_t SceneDescription::AppendString(std::string_view text) {
+    strings.push_back(storage.emplace_back(text));
+    return static_cast<uint32_t>(strings.size() - 1);
+}
+
+void SceneDescription::Append(const SceneDescription& other, size_t first, size_t count) {
+    size_t base = GetObjectCount();
+    size_t last = first + count;
+    for (size_t i = first; i < last; ++i) {
+        ids.push_back(AppendString(other.strings[other.ids[i]]));
+        modelPaths.push_back(AddString(other.strings[other.modelPaths[i]]));
+
+        uint32_t parent = other.parents[i];
+        parents.push_back(parent != NoParent && parent >= first && parent < last ? static_cast<uint32_t>(base + parent - first) : NoParent);
+    }
+    transforms.insert(transforms.end(), other.transforms.begin() + first, other.transforms.begin() + last);
+    physics.insert(physics.end(), other.physics.begin() + first, other.physics.begin() + last);
+}
+
+bool SceneArchive::ReadObjects(uint32_t first, uint32_t count, SceneDescription& objects) const {
+    if (first > objectCount || count > objectCount - first || (objects.mapping && objects.mapping != mapping)) {
+        std::cerr << "Invalid scene object range" << std::endl;
+        return false;
+    }
+
+    // Checked in one pass each rather than per field while reading records. Parents coming first
+    // is what rules out cycles.
+    uint32_t last = first + count;
+    bool valid = true;
+    for (uint32_t i = first; i < last; ++i) {
+        valid &= ids[i] < stringCount && modelPaths[i] < stringCount;
+    }
+    if (parents) {
+        for (uint32_t i = first; i < last; ++i) {
+            valid &= parents[i] == SceneDescription::NoParent || (parents[i] >= first && parents[i] < i);
+        }
+    }
+    if (!valid) {
+        std::cerr << "Scene file has an invalid string or parent index" << std::endl;
+        return false;
+    }
+
+    size_t base = objects.GetObjectCount();
+    if (first == 0 && count == objectCount) {
+        // The whole file takes over its string table as it is
+        uint32_t stringBase = static_cast<uint32_t>(objects.strings.size());
+        objects.strings.resize(stringBase + size_t(stringCount));
+        for (uint32_t i = 0; i < stringCount; ++i) {
+            objects.strings[stringBase + i] = GetString(i);
+        }
+        objects.ids.resize(base + count);
+        objects.modelPaths.resize(base + count);
+        for (uint32_t i = 0; i < count; ++i) {
+            objects.ids[base + i] = stringBase + ids[i];
+            objects.modelPaths[base + i] = stringBase + modelPaths[i];
+        }
+    }
+    else {
+        // Only the strings the range uses, model paths once each
+        std::unordered_map<uint32_t, uint32_t> models;
+        objects.ids.reserve(base + count);
+        objects.modelPaths.reserve(base + count);
+        for (uint32_t i = first; i < last; ++i) {
+            objects.ids.push_back(static_cast<uint32_t>(objects.strings.size()));
+            objects.strings.push_back(GetString(ids[i]));
+
+            auto [model, added] = models.try_emplace(modelPaths[i], static_cast<uint32_t>(objects.strings.size()));
+            if (added) {
+                objects.strings.push_back(GetString(modelPaths[i]));
+            }
+            objects.modelPaths.push_back(model->second);
+        }
+    }
+
+    objects.parents.resize(base + count, SceneDescription::NoParent);
+    if (parents) {
+        for (uint32_t i = first; i < last; ++i) {
+            if (parents[i] != SceneDescription::NoParent) {
+                objects.parents[base + i - first] = static_cast<uint32_t>(base + parents[i] - first);
+            }
+        }
+    }
+
+    objects.transforms.resize(base + count);
+    for (uint32_t i = first; i < last; ++i) {
+        TransformComponent& transform = objects.transforms[base + i - first];
+        transform.position = glm::vec3(transforms[i], transforms[objectCount + i], transforms[2 * objectCount + i]);
+        transform.rotation = glm::vec3(transforms[3 * objectCount + i], transforms[4 * objectCount + i], transforms[5 * objectCount + i]);
+        transform.scale = glm::vec3(transforms[6 * objectCount + i], transforms[7 * objectCount + i], transforms[8 * objectCount + i]);
+    }
+
+    objects.physics.resize(base + count);
+    if (physicsFlags) {
+        for (uint32_t i = first; i < last; ++i) {
+            PhysicsProperties& physics = objects.physics[base + i - first];
+            physics.hasCollision = (physicsFlags[i] & HasCollision) != 0;
+            physics.isAffectedByPhysics = (physicsFlags[i] & IsAffectedByPhysics) != 0;
+            physics.isStatic = (physicsFlags[i] & IsStatic) != 0;
+        }
+    }
+    if (physicsValues) {
+        for (uint32_t i = first; i < last; ++i) {
+            PhysicsProperties& physics = objects.physics[base + i - first];
+            physics.mass = physicsValues[i];
+            physics.collisionShapeSize = glm::vec3(physicsValues[objectCount + i], physicsValues[2 * objectCount + i], physicsValues[3 * objectCount + i]);
+        }
+    }
+
+    objects.mapping = mapping;
+    return true;
+}
+
+bool SceneFormat::Read(const std::string& path, SceneDescription& scene, std::shared_ptr<SceneArchive>* archive) {
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->Open(path)) {
+        std::cerr << "Failed to open file for reading: " << path << std::endl;
+        return false;
+    }
+
+    const char* magic = reinterpret_cast<const char*>(mapping->GetData());
+    if (mapping->GetSize() >= 8) {
+        if (std::memcmp(magic, ChunkedMagic, 8) == 0) {
+            auto opened = std::make_shared<SceneArchive>();
+            if (!OpenArchive(mapping, *opened, scene)) {
+                return false;
+            }
+            if (archive && !opened->cells.empty()) {
+                *archive = std::move(opened);
+                return true;
+            }
+            return opened->ReadObjects(0, opened->objectCount, scene);
+        }
+        if (std::memcmp(magic, "SCENE002", 8) == 0 || std::memcmp(magic, "SCENE001", 8) == 0) {
+            return ReadLegacy(mapping, magic[7] == '2', scene);
+        }
+    }
+
+    std::cerr << "Invalid file format or version" << std::endl;
+    return false;
+}
+
+bool SceneFormat::OpenArchive(const std::shared_ptr<MappedFile>& mapping, SceneArchive& archive, SceneDescription& scene) {
+    const uint8_t* data = mapping->GetData();
+    uint64_t size = mapping->GetSize();
+
+    Header header;
+    if (size < sizeof(Header)) {
+        std::cerr << "Scene file is truncated" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.fileSize != size || header.chunkCount > (size - sizeof(Header)) / sizeof(ChunkEntry)) {
+        std::cerr << "Scene file is truncated" << std::endl;
+        return false;
+    }
+
+    // Later chunks with the same id win, unknown ids are skipped
+    const ChunkEntry* strings = nullptr;
+    const ChunkEntry* stringData = nullptr;
+    const ChunkEntry* settings = nullptr;
+    const ChunkEntry* aliases = nullptr;
+    const ChunkEntry* cells = nullptr;
+    const ChunkEntry* journal = nullptr;
+    const ChunkEntry* ids = nullptr;
+    const ChunkEntry* models = nullptr;
+    const ChunkEntry* parents = nullptr;
+    const ChunkEntry* transforms = nullptr;
+    const ChunkEntry* physicsFlags = nullptr;
+    const ChunkEntry* physicsValues = nullptr;
+
+    std::vector<ChunkEntry> chunks(header.chunkCount);
+    std::memcpy(chunks.data(), data + sizeof(Header), chunks.size() * sizeof(ChunkEntry));
+    for (const ChunkEntry& chunk : chunks) {
+        if (chunk.offset % ChunkAlignment != 0 || chunk.offset > size || chunk.size > size - chunk.offset) {
+            std::cerr << "Scene file has a chunk outside the file" << std::endl;
+            return false;
+        }
+
+        switch (chunk.id) {
+        case StringOffsetsChunk: strings = &chunk; break;
+        case StringDataChunk: stringData = &chunk; break;
+        case SettingsChunk: settings = &chunk; break;
+        case AliasChunk: aliases = &chunk; break;
+        case CellChunk: cells = &chunk; break;
+        case JournalChunk: journal = &chunk; break;
+        case ObjectIdChunk: ids = &chunk; break;
+        case ObjectModelChunk: models = &chunk; break;
+        case ObjectParentChunk: parents = &chunk; break;
+        case TransformChunk: transforms = &chunk; break;
+        case PhysicsFlagChunk: physicsFlags = &chunk; break;
+        case PhysicsValueChunk: physicsValues = &chunk; break;
+        default: break;
+        }
+    }
+
+    if (!strings || !stringData || !ids || !models || !transforms) {
+        std::cerr << "Scene file is missing a required chunk" << std::endl;
+        return false;
+    }
+
+    // Every per-object chunk must hold exactly count elements of its size
+    uint32_t objectCount = ids->count;
+    auto holds = [objectCount](const ChunkEntry* chunk, uint64_t elementSize) {
+        return !chunk || (chunk->count == objectCount && chunk->size == objectCount * elementSize);
+    };
+    if (!holds(ids, sizeof(uint32_t)) || !holds(models, sizeof(uint32_t)) || !holds(parents, sizeof(uint32_t)) ||
+        !holds(transforms, 9 * sizeof(float)) || !holds(physicsFlags, sizeof(uint8_t)) || !holds(physicsValues, 4 * sizeof(float)) ||
+        strings->size != (uint64_t(strings->count) + 1) * sizeof(uint32_t) ||
+        (aliases && aliases->size != uint64_t(aliases->count) * 2 * sizeof(uint32_t)) ||
+        (cells && cells->size != uint64_t(cells->count) * sizeof(SceneCell)) ||
+        (settings && settings->size < 3 * sizeof(float)) ||
+        (journal && journal->size != 2 * sizeof(uint64_t))) {
+        std::cerr << "Scene file has a chunk of the wrong size" << std::endl;
+        return false;
+    }
+
+    // Chunks are aligned within the file and the mapping is page aligned, so they can be read in place
+    auto uints = [data](const ChunkEntry* chunk) { return reinterpret_cast<const uint32_t*>(data + chunk->offset); };
+    auto floats = [data](const ChunkEntry* chunk) { return reinterpret_cast<const float*>(data + chunk->offset); };
+
+    uint32_t stringCount = strings->count;
+    const uint32_t* stringOffsets = uints(strings);
+    if (stringOffsets[0] != 0 || stringOffsets[stringCount] != stringData->size) {
+        std::cerr << "Scene file has an invalid string table" << std::endl;
+        return false;
+    }
+
+    bool valid = true;
+    for (uint32_t i = 0; i < stringCount; ++i) {
+        valid &= stringOffsets[i] <= stringOffsets[i + 1];
+    }
+
+    SceneDescription result;
+    if (aliases) {
+        const uint32_t* aliasData = uints(aliases);
+        for (uint32_t i = 0; i < aliases->count; ++i) {
+            valid &= aliasData[2 * i] < stringCount && aliasData[2 * i + 1] < stringCount;
+        }
+    }
+
+    if (settings) {
+        std::memcpy(&result.backgroundColor, data + settings->offset, 3 * sizeof(float));
+        if (settings->size >= 4 * sizeof(float)) {
+            std::memcpy(&result.cellSize, data + settings->offset + 3 * sizeof(float), sizeof(float));
+        }
+    }
+
+    if (journal) {
+        std::memcpy(&result.journalLineage, data + journal->offset, sizeof(uint64_t));
+        std::memcpy(&result.journalSequence, data + journal->offset + sizeof(uint64_t), sizeof(uint64_t));
+    }
+
+    // Cells cover the objects in order without gaps
+    if (cells && cells->count > 0) {
+        result.cells.resize(cells->count);
+        std::memcpy(result.cells.data(), data + cells->offset, cells->size);
+
+        uint32_t covered = 0;
+        for (const SceneCell& cell : result.cells) {
+            valid &= cell.firstObject == covered && cell.objectCount <= objectCount - covered;
+            covered = cell.firstObject + std::min(cell.objectCount, objectCount - covered);
+        }
+        valid &= covered == objectCount && std::isfinite(result.cellSize) && result.cellSize > 0.0f;
+    }
+
+    if (!valid) {
+        std::cerr << "Scene file has an invalid string table, alias or cell" << std::endl;
+        return false;
+    }
+
+    archive.mapping = mapping;
+    archive.cellSize = result.cellSize;
+    archive.cells = result.cells;
+    archive.objectCount = objectCount;
+    archive.stringCount = stringCount;
+    archive.stringOffsets = stringOffsets;
+    archive.characters = reinterpret_cast<const char*>(data + stringData->offset);
+    archive.ids = uints(ids);
+    archive.modelPaths = uints(models);
+    archive.parents = parents ? uints(parents) : nullptr;
+    archive.transforms = floats(transforms);
+    archive.physicsFlags = physicsFlags ? data + physicsFlags->offset : nullptr;
+    archive.physicsValues = physicsValues ? floats(physicsValues) : nullptr;
+
+    // Copied, since a partitioned scene only reads the strings of the cells it needs
+    if (aliases) {
+        const uint32_t* aliasData = uints(aliases);
+        for (uint32_t i = 0; i < aliases->count; ++i) {
+            result.aliases.emplace_back(result.AddString(archive.GetString(aliasData[2 * i])), result.AddString(archive.GetString(aliasData[2 * i + 1])));
+        }
+    }
+
+    scene = std::move(result);
+    return true;
+}
+
+bool SceneFormat::ReadLegacy(const std::shared_ptr<MappedFile>& mapping, bool hasPhysics, SceneDescription& scene) {
+    const uint8_t* data = mapping->GetData();
+    uint64_t size = mapping->GetSize();
+    uint64_t position = 8;
+
+    // These files were written by x64 builds, lengths and counts are 8 bytes
+    auto read = [&](void* value, uint64_t length) {
+        if (length > size - position) return false;
+        std::memcpy(value, data + position, length);
+        position += length;
+        return true;
+    };
+
+    SceneDescription result;
+    std::unordered_map<std::string_view, uint32_t> lookup;
+
+    // Strings stay in the mapping. Equal aliases and model paths share an index, ids are unique.
+    auto readString = [&](uint64_t maxLength, bool deduplicate, uint32_t& index) {
+        uint64_t length;
+        if (!read(&length, sizeof(length)) || length > maxLength || length > size - position) return false;
+
+        std::string_view text(reinterpret_cast<const char*>(data + position), static_cast<size_t>(length));
+        position += length;
+
+        index = static_cast<uint32_t>(result.strings.size());
+        if (deduplicate) {
+            auto [it, added] = lookup.emplace(text, index);
+            if (!added) {
+                index = it->second;
+                return true;
+            }
+        }
+        result.strings.push_back(text);
+        return true;
+    };
+
+    if (!read(&result.backgroundColor, sizeof(result.backgroundColor))) {
+        std::cerr << "Failed to read background color" << std::endl;
+        return false;
+    }
+
+    uint64_t aliasCount;
+    if (!read(&aliasCount, sizeof(aliasCount))) {
+        std::cerr << "Failed to read alias count" << std::endl;
+        return false;
+    }
+
+    if (aliasCount > 1000) {
+        std::cerr << "Invalid alias count" << std::endl;
+        return false;
+    }
+
+    for (uint64_t i = 0; i < aliasCount; ++i) {
+        uint32_t key, value;
+        if (!readString(1024, true, key) || !readString(2048, true, value)) return false;
+        result.aliases.emplace_back(key, value);
+    }
+
+    uint64_t objectCount;
+    if (!read(&objectCount, sizeof(objectCount))) {
+        std::cerr << "Failed to read object count" << std::endl;
+        return false;
+    }
+
+    // Two lengths and the transform at least, so the count cannot claim more than the file holds
+    const uint64_t minObjectSize = 2 * sizeof(uint64_t) + 9 * sizeof(float) +
+        (hasPhysics ? 3 * sizeof(bool) + sizeof(float) + 3 * sizeof(float) : 0);
+    if (objectCount > (size - position) / minObjectSize) {
+        std::cerr << "Invalid object count" << std::endl;
+        return false;
+    }
+
+    result.ids.resize(objectCount);
+    result.modelPaths.resize(objectCount);
+    result.parents.assign(objectCount, SceneDescription::NoParent);
+    result.transforms.resize(objectCount);
+    result.physics.resize(objectCount);
+
+    for (uint64_t i = 0; i < objectCount; ++i) {
+        TransformComponent& transform = result.transforms[i];
+        bool success = readString(1024, false, result.ids[i]) && readString(2048, true, result.modelPaths[i]) &&
+            read(&transform.position, sizeof(transform.position)) &&
+            read(&transform.rotation, sizeof(transform.rotation)) &&
+            read(&transform.scale, sizeof(transform.scale));
+
+        if (success && hasPhysics) {
+            PhysicsProperties& physics = result.physics[i];
+            success = read(&physics.hasCollision, sizeof(physics.hasCollision)) &&
+                read(&physics.isAffectedByPhysics, sizeof(physics.isAffectedByPhysics)) &&
+                read(&physics.isStatic, sizeof(physics.isStatic)) &&
+                read(&physics.mass, sizeof(physics.mass)) &&
+                read(&physics.collisionShapeSize, sizeof(physics.collisionShapeSize));
+        }
+
+        if (!success) {
+            std::cerr << "Failed to read object " << i << std::endl;
+            return false;
+        }
+    }
+
+    result.mapping = mapping;
+    scene = std::move(result);
+    return true;
+}
+
+bool SceneFormat::Write(const std::string& path, const SceneDescription& scene) {
+    uint32_t objectCount = static_cast<uint32_t>(scene.GetObjectCount());
+    uint32_t stringCount = static_cast<uint32_t>(scene.strings.size());
+
+    std::vector<uint32_t> stringOffsets(stringCount + 1);
+    for (uint32_t i = 0; i < stringCount; ++i) {
+        stringOffsets[i + 1] = stringOffsets[i] + static_cast<uint32_t>(scene.strings[i].size());
+    }
+
+    std::vector<uint32_t> aliases;
+    for (const auto& alias : scene.aliases) {
+        aliases.push_back(alias.first);
+        aliases.push_back(alias.second);
+    }
+
+    std::vector<float> transforms(9 * size_t(objectCount));
+    std::vector<uint8_t> physicsFlags(objectCount);
+    std::vector<float> physicsValues(4 * size_t(objectCount));
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        const TransformComponent& transform = scene.transforms[i];
+        const glm::vec3* fields[3] = { &transform.position, &transform.rotation, &transform.scale };
+        for (int field = 0; field < 3; ++field) {
+            for (int axis = 0; axis < 3; ++axis) {
+                transforms[(3 * field + axis) * size_t(objectCount) + i] = (*fields[field])[axis];
+            }
+        }
+
+        const PhysicsProperties& physics = scene.physics[i];
+        physicsFlags[i] = (physics.hasCollision ? HasCollision : 0) | (physics.isAffectedByPhysics ? IsAffectedByPhysics : 0) |
+            (physics.isStatic ? IsStatic : 0);
+        physicsValues[i] = physics.mass;
+        for (int axis = 0; axis < 3; ++axis) {
+            physicsValues[(1 + axis) * size_t(objectCount) + i] = physics.collisionShapeSize[axis];
+        }
+    }
+
+    float settings[4] = { scene.backgroundColor.r, scene.backgroundColor.g, scene.backgroundColor.b, scene.cells.empty() ? 0.0f : scene.cellSize };
+    uint64_t journal[2] = { scene.journalLineage, scene.journalSequence };
+
+    struct Chunk {
+        ChunkEntry entry;
+        const void* bytes;
+    };
+
+    Chunk chunks[] = {
+        { { StringOffsetsChunk, stringCount, 0, stringOffsets.size() * sizeof(uint32_t) }, stringOffsets.data() },
+        { { StringDataChunk, 0, 0, stringOffsets[stringCount] }, nullptr },
+        { { SettingsChunk, 1, 0, sizeof(settings) }, settings },
+        { { AliasChunk, static_cast<uint32_t>(scene.aliases.size()), 0, aliases.size() * sizeof(uint32_t) }, aliases.data() },
+        { { CellChunk, static_cast<uint32_t>(scene.cells.size()), 0, scene.cells.size() * sizeof(SceneCell) }, scene.cells.data() },
+        { { JournalChunk, 1, 0, sizeof(journal) }, journal },
+        { { ObjectIdChunk, objectCount, 0, objectCount * sizeof(uint32_t) }, scene.ids.data() },
+        { { ObjectModelChunk, objectCount, 0, objectCount * sizeof(uint32_t) }, scene.modelPaths.data() },
+        { { ObjectParentChunk, objectCount, 0, objectCount * sizeof(uint32_t) }, scene.parents.data() },
+        { { TransformChunk, objectCount, 0, transforms.size() * sizeof(float) }, transforms.data() },
+        { { PhysicsFlagChunk, objectCount, 0, physicsFlags.size() }, physicsFlags.data() },
+        { { PhysicsValueChunk, objectCount, 0, physicsValues.size() * sizeof(float) }, physicsValues.data() },
+    };
+    constexpr uint32_t chunkCount = sizeof(chunks) / sizeof(chunks[0]);
+
+    Header header = {};
+    std::memcpy(header.magic, ChunkedMagic, sizeof(ChunkedMagic));
+    header.chunkCount = chunkCount;
+
+    uint64_t offset = sizeof(Header) + chunkCount * sizeof(ChunkEntry);
+    for (Chunk& chunk : chunks) {
+        chunk.entry.offset = Align(offset);
+        offset = chunk.entry.offset + chunk.entry.size;
+    }
+    header.fileSize = offset;
+
+    // Written under a temporary name so a crash never leaves a half-written scene behind
+    std::string tempPath = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open file for writing: " << tempPath << std::endl;
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const Chunk& chunk : chunks) {
+            file.write(reinterpret_cast<const char*>(&chunk.entry), sizeof(ChunkEntry));
+        }
+
+        for (const Chunk& chunk : chunks) {
+            static const char zeros[ChunkAlignment] = {};
+            uint64_t current = static_cast<uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(chunk.entry.offset - current));
+
+            if (chunk.entry.id == StringDataChunk) {
+                for (std::string_view text : scene.strings) {
+                    file.write(text.data(), static_cast<std::streamsize>(text.size()));
+                }
+            }
+            else {
+                file.write(static_cast<const char*>(chunk.bytes), static_cast<std::streamsize>(chunk.entry.size));
+            }
+        }
+
+        if (!file) {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            std::cerr << "Failed to write scene file: " << tempPath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        std::cerr << "Failed to replace scene file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Cell coordinate along one axis. Positions too far out for an int32 cell share the outermost one.
+static int32_t CellCoordinate(float position, float cellSize) {
+    float cell = std::floor(position / cellSize);
+    if (std::isnan(cell)) return 0;
+    return static_cast<int32_t>(std::clamp(cell, -2147483520.0f, 2147483520.0f));
+}
+
+void SceneFormat::Partition(SceneDescription& scene, float cellSize) {
+    size_t objectCount = scene.GetObjectCount();
+    scene.cells.clear();
+    scene.cellSize = 0.0f;
+    if (objectCount == 0 || !std::isfinite(cellSize) || cellSize <= 0.0f) return;
+
+    scene.cellSize = cellSize;
+
+    // Cell of every object's root as one sortable key, x in the high half. Parents come first, so
+    // a child copies its parent's key.
+    std::vector<uint64_t> keys(objectCount);
+    for (size_t i = 0; i < objectCount; ++i) {
+        uint32_t parent = scene.parents[i];
+        if (parent != SceneDescription::NoParent) {
+            keys[i] = keys[parent];
+            continue;
+        }
+
+        const glm::vec3& position = scene.transforms[i].position;
+        uint32_t x = static_cast<uint32_t>(CellCoordinate(position.x, cellSize)) ^ 0x80000000u;
+        uint32_t z = static_cast<uint32_t>(CellCoordinate(position.z, cellSize)) ^ 0x80000000u;
+        keys[i] = uint64_t(x) << 32 | z;
+    }
+
+    // A stable sort keeps parents ahead of their children within a cell
+    std::vector<uint32_t> order(objectCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    std::vector<uint32_t> newIndex(objectCount);
+    for (size_t i = 0; i < objectCount; ++i) {
+        newIndex[order[i]] = static_cast<uint32_t>(i);
+    }
+
+    auto permute = [&order](auto& values) {
+        std::remove_reference_t<decltype(values)> sorted;
+        sorted.reserve(values.size());
+        for (uint32_t index : order) {
+            sorted.push_back(values[index]);
+        }
+        values = std::move(sorted);
+    };
+    permute(scene.ids);
+    permute(scene.modelPaths);
+    permute(scene.transforms);
+    permute(scene.physics);
+    permute(scene.parents);
+    for (uint32_t& parent : scene.parents) {
+        if (parent != SceneDescription::NoParent) {
+            parent = newIndex[parent];
+        }
+    }
+
+    for (size_t i = 0; i < objectCount; ++i) {
+        uint64_t key = keys[order[i]];
+        if (i == 0 || key != keys[order[i - 1]]) {
+            SceneCell cell;
+            cell.x = static_cast<int32_t>(static_cast<uint32_t>(key >> 32) ^ 0x80000000u);
+            cell.z = static_cast<int32_t>(static_cast<uint32_t>(key) ^ 0x80000000u);
+            cell.firstObject = static_cast<uint32_t>(i);
+            scene.cells.push_back(cell);
+        }
+        scene.cells.back().objectCount++;
+    }
+}
\ No newline at end of file
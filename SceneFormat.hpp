@@ -0,0 +1,139 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include "SceneComponents.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Grid cell of a partitioned scene, the square [x, x + 1) * cellSize by [z, z + 1) * cellSize on
+// the XZ plane. Its objects are one contiguous range of the file.
+struct SceneCell {
+    int32_t x = 0;
+    int32_t z = 0;
+    uint32_t firstObject = 0;
+    uint32_t objectCount = 0;
+};
+
+// Contents of a scene file in the layout SCENE003 stores them: per-object arrays that refer to one
+// deduplicated string table by index. Strings read from a file point into mapping, strings added
+// with AddString into storage.
+struct SceneDescription {
+    static constexpr uint32_t NoParent = 0xffffffffu;
+
+    glm::vec3 backgroundColor = glm::vec3(0.0f);
+    std::vector<std::string_view> strings;
+    // Key and value string indices
+    std::vector<std::pair<uint32_t, uint32_t>> aliases;
+
+    // One entry per object, parents always before their children
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> modelPaths;
+    std::vector<uint32_t> parents;
+    std::vector<TransformComponent> transforms;
+    std::vector<PhysicsProperties> physics;
+
+    // Filled in by SceneFormat::Partition, no cells means the scene is not partitioned
+    float cellSize = 0.0f;
+    std::vector<SceneCell> cells;
+
+    // Journal the file is a snapshot of and the last journal record it contains, 0 when unknown
+    uint64_t journalLineage = 0;
+    uint64_t journalSequence = 0;
+
+    std::shared_ptr<MappedFile> mapping;
+    std::deque<std::string> storage;
+
+    // Returns the index of text in the string table, adding a copy the first time it is seen
+    uint32_t AddString(std::string_view text);
+    // Adds a copy without looking for an equal string, for strings known to be distinct such as ids
+    uint32_t AppendString(std::string_view text);
+    size_t GetObjectCount() const { return ids.size(); }
+
+    // Appends objects [first, first + count) of other with copies of their strings. Parents
+    // outside the range become NoParent.
+    void Append(const SceneDescription& other, size_t first, size_t count);
+
+private:
+    std::unordered_map<std::string_view, uint32_t> lookup;
+};
+
+// A partitioned SCENE003 file kept mapped after its settings were read, so the objects of each
+// cell can be read when they are needed. ReadObjects may be called from any thread.
+class SceneArchive {
+public:
+    float GetCellSize() const { return cellSize; }
+    const std::vector<SceneCell>& GetCells() const { return cells; }
+    uint32_t GetObjectCount() const { return objectCount; }
+    // Empty when the object's string index is out of range
+    std::string_view GetObjectId(uint32_t object) const {
+        return ids[object] < stringCount ? GetString(ids[object]) : std::string_view();
+    }
+
+    // Appends objects [first, first + count) to objects. Parents outside the range are an error.
+    bool ReadObjects(uint32_t first, uint32_t count, SceneDescription& objects) const;
+
+private:
+    friend class SceneFormat;
+
+    std::shared_ptr<MappedFile> mapping;
+    float cellSize = 0.0f;
+    std::vector<SceneCell> cells;
+    uint32_t objectCount = 0;
+    uint32_t stringCount = 0;
+
+    // Chunk arrays in the mapping, optional ones are null when the file has none
+    const uint32_t* stringOffsets = nullptr;
+    const char* characters = nullptr;
+    const uint32_t* ids = nullptr;
+    const uint32_t* modelPaths = nullptr;
+    const uint32_t* parents = nullptr;
+    const float* transforms = nullptr;
+    const uint8_t* physicsFlags = nullptr;
+    const float* physicsValues = nullptr;
+
+    std::string_view GetString(uint32_t index) const {
+        return std::string_view(characters + stringOffsets[index], stringOffsets[index + 1] - stringOffsets[index]);
+    }
+};
+
+// Reads and writes scene files.
+//
+// SCENE003 is a header, a table of chunks and the chunks themselves, each on a ChunkAlignment
+// boundary. Every chunk is a fixed-width little-endian array, so a reader maps the file once,
+// validates the arrays in bulk and copies them out without parsing record by record. Readers skip
+// chunks they do not know.
+//
+// A partitioned scene stores its objects ordered by cell and a CELL chunk with the range of each.
+// A JRNL chunk says which records of the scene's SceneJournal the file already contains.
+//
+// SCENE001 and SCENE002 files, a stream of size_t-prefixed records, are still read.
+class SceneFormat {
+public:
+    static constexpr uint64_t ChunkAlignment = 16;
+
+    // Reads the whole scene. When archive is given and the file is partitioned, only the settings,
+    // aliases and cells are read into scene and the objects are left to the returned archive.
+    static bool Read(const std::string& path, SceneDescription& scene, std::shared_ptr<SceneArchive>* archive = nullptr);
+    // Writes a SCENE003 file under a temporary name and renames it over path
+    static bool Write(const std::string& path, const SceneDescription& scene);
+
+    // Orders the objects by the cell their root object's position falls in and fills in cells.
+    // A hierarchy always stays together in its root's cell.
+    static void Partition(SceneDescription& scene, float cellSize);
+
+private:
+    struct Header;
+    struct ChunkEntry;
+
+    static bool OpenArchive(const std::shared_ptr<MappedFile>& mapping, SceneArchive& archive, SceneDescription& scene);
+    static bool ReadLegacy(const std::shared_ptr<MappedFile>& mapping, bool hasPhysics, SceneDescription& scene);
+
+    static uint64_t Align(uint64_t offset) { return (offset + ChunkAlignment - 1) & ~(ChunkAlignment - 1); }
+};
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "Scene.hpp"
+#include "SceneJournal.hpp"
+
+// Past this the older half of the undo history is dropped
+static constexpr size_t MaxUndoBytes = 8 * 1024 * 1024;
+
+void Scene::RecordEdit(const SceneEdit& edit) {
+    encodedEdit.clear();
+    edit.Encode(encodedEdit);
+    if (journal) {
+        journal->Append(encodedEdit);
+    }
+
+    bool merge = mergeNextEdit;
+    mergeNextEdit = false;
+    if (applyingHistory) return;
+
+    // A new edit drops the steps that were undone
+    if (undoCursor < undoSteps.size()) {
+        undoBuffer.resize(undoSteps[undoCursor]);
+        undoSteps.resize(undoCursor);
+    }
+
+    // Only the value before the first change of a merged step is kept
+    bool mergeable = edit.type == SceneEdit::Type::Transform || edit.type == SceneEdit::Type::Physics || edit.type == SceneEdit::Type::Background;
+    if (merge && mergeable && !undoSteps.empty()) {
+        SceneEdit last;
+        if (last.Decode(undoBuffer.data() + undoSteps.back(), undoBuffer.size() - undoSteps.back()) &&
+            last.type == edit.type && last.id == edit.id && last.field == edit.field) {
+            SceneEdit merged = edit;
+            merged.previousValue = last.previousValue;
+            merged.previousPhysics = last.previousPhysics;
+            undoBuffer.resize(undoSteps.back());
+            merged.Encode(undoBuffer);
+            return;
+        }
+    }
+
+    undoSteps.push_back(undoBuffer.size());
+    undoBuffer.insert(undoBuffer.end(), encodedEdit.begin(), encodedEdit.end());
+    undoCursor = undoSteps.size();
+
+    if (undoBuffer.size() > MaxUndoBytes && undoSteps.size() > 1) {
+        size_t dropped = undoSteps.size() / 2;
+        size_t droppedBytes = undoSteps[dropped];
+        undoBuffer.erase(undoBuffer.begin(), undoBuffer.begin() + droppedBytes);
+        undoSteps.erase(undoSteps.begin(), undoSteps.begin() + dropped);
+        for (size_t& step : undoSteps) {
+            step -= droppedBytes;
+        }
+        undoCursor = undoSteps.size();
+    }
+}
+
+void Scene::ApplyEdit(const SceneEdit& edit) {
+    switch (edit.type) {
+    case SceneEdit::Type::AddObject:
+        AddObject(edit.id, edit.text);
+        break;
+    case SceneEdit::Type::RemoveObject:
+        RemoveObject(edit.id);
+        break;
+    case SceneEdit::Type::RestoreObject:
+        RestoreObject(edit);
+        break;
+    case SceneEdit::Type::Transform:
+        SetTransformField(edit.id, edit.field, edit.value);
+        break;
+    case SceneEdit::Type::Physics:
+        SetPhysics(edit.id, edit.physics);
+        break;
+    case SceneEdit::Type::Parent:
+        SetObjectParent(edit.id, edit.parent);
+        break;
+    case SceneEdit::Type::AddAlias:
+        AddPathAlias(edit.id, edit.text);
+        break;
+    case SceneEdit::Type::RemoveAlias:
+        RemovePathAlias(edit.id, edit.text);
+        break;
+    case SceneEdit::Type::Background:
+        SetBackground(edit.value);
+        break;
+    }
+}
+
+void Scene::RestoreObject(const SceneEdit& edit) {
+    if (IsIdTaken(edit.id)) return;
+
+    entt::entity entity = SpawnObject(edit.id, edit.text, edit.transform, edit.physics);
+    if (entity == entt::null) return;
+
+    // Parent and children as they were, where they still exist. Replaying the edit from the
+    // journal does the same.
+    entt::entity parent = FindObject(edit.parent);
+    if (parent != entt::null && CanParent(entity, parent)) {
+        AttachToParent(entity, parent);
+    }
+    for (const std::string& id : edit.children) {
+        entt::entity child = FindObject(id);
+        if (child != entt::null && CanParent(child, entity)) {
+            DetachFromParent(child);
+            AttachToParent(child, entity);
+            MarkTransformDirty(child);
+        }
+    }
+    RecordEdit(edit);
+}
+
+void Scene::ApplyUndoStep(size_t step, bool inverse) {
+    size_t begin = undoSteps[step];
+    size_t end = step + 1 < undoSteps.size() ? undoSteps[step + 1] : undoBuffer.size();
+    SceneEdit edit;
+    if (!edit.Decode(undoBuffer.data() + begin, end - begin)) return;
+
+    // Objects a step names may be gone, such as with their streamed cell, the step then does nothing
+    applyingHistory = true;
+    ApplyEdit(inverse ? edit.Inverted() : edit);
+    applyingHistory = false;
+}
+
+bool Scene::Undo() {
+    if (undoCursor == 0) return false;
+
+    ApplyUndoStep(--undoCursor, true);
+    return true;
+}
+
+bool Scene::Redo() {
+    if (undoCursor == undoSteps.size()) return false;
+
+    ApplyUndoStep(undoCursor++, false);
+    return true;
+}
+
+void Scene::ClearHistory() {
+    undoBuffer.clear();
+    undoSteps.clear();
+    undoCursor = 0;
+    mergeNextEdit = false;
+}
\ No newline at end of file
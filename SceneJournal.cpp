@@ -0,0 +1,733 @@
+#include "SceneJournal.hpp"
+#include "SceneFormat.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+
+static_assert(std::endian::native == std::endian::little, "journal records are read and written as raw little-endian memory");
+
+struct SceneJournal::Header {
+    char magic[8];
+    uint64_t lineage;
+};
+
+struct SceneJournal::RecordHeader {
+    // Bytes of the encoded edit that follows
+    uint32_t size;
+    uint32_t checksum;
+    uint64_t sequence;
+};
+
+static const char JournalMagic[8] = { 'S', 'C', 'J', 'R', 'N', 'L', '0', '1' };
+
+// FNV-1a over the sequence and the encoded edit, folded to 32 bits
+static uint32_t Checksum(uint64_t sequence, const uint8_t* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const uint8_t* bytes, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(reinterpret_cast<const uint8_t*>(&sequence), sizeof(sequence));
+    mix(data, size);
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+static uint64_t NewLineage() {
+    std::random_device device;
+    uint64_t lineage = (uint64_t(device()) << 32 | device()) ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    return lineage != 0 ? lineage : 1;
+}
+
+template <typename T>
+static void Put(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void PutString(std::vector<uint8_t>& out, const std::string& text) {
+    Put(out, static_cast<uint32_t>(text.size()));
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+static void PutPhysics(std::vector<uint8_t>& out, const PhysicsProperties& physics) {
+    Put(out, static_cast<uint8_t>((physics.hasCollision ? 1 : 0) | (physics.isAffectedByPhysics ? 2 : 0) | (physics.isStatic ? 4 : 0)));
+    Put(out, physics.mass);
+    Put(out, physics.collisionShapeSize);
+}
+
+// Reads what Put wrote. Running past the end clears ok and yields zeroes from then on.
+struct EditReader {
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+    bool ok = true;
+
+    template <typename T>
+    T Get() {
+        T value{};
+        if (!ok || size - offset < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    std::string GetString() {
+        uint32_t length = Get<uint32_t>();
+        if (!ok || size - offset < length) {
+            ok = false;
+            return std::string();
+        }
+        std::string text(reinterpret_cast<const char*>(data + offset), length);
+        offset += length;
+        return text;
+    }
+
+    PhysicsProperties GetPhysics() {
+        PhysicsProperties physics;
+        uint8_t flags = Get<uint8_t>();
+        physics.hasCollision = (flags & 1) != 0;
+        physics.isAffectedByPhysics = (flags & 2) != 0;
+        physics.isStatic = (flags & 4) != 0;
+        physics.mass = Get<float>();
+        physics.collisionShapeSize = Get<glm::vec3>();
+        return physics;
+    }
+};
+
+SceneEdit SceneEdit::Inverted() const {
+    SceneEdit inverse = *this;
+    switch (type) {
+    case Type::AddObject:
+    case Type::RestoreObject:
+        inverse.type = Type::RemoveObject;
+        break;
+    case Type::RemoveObject:
+        inverse.type = Type::RestoreObject;
+        break;
+    case Type::AddAlias:
+        inverse.type = Type::RemoveAlias;
+        break;
+    case Type::RemoveAlias:
+        inverse.type = Type::AddAlias;
+        break;
+    default:
+        std::swap(inverse.parent, inverse.previousParent);
+        std::swap(inverse.physics, inverse.previousPhysics);
+        std::swap(inverse.value, inverse.previousValue);
+        break;
+    }
+    return inverse;
+}
+
+void SceneEdit::Encode(std::vector<uint8_t>& out) const {
+    Put(out, type);
+    switch (type) {
+    case Type::AddObject:
+    case Type::AddAlias:
+    case Type::RemoveAlias:
+        PutString(out, id);
+        PutString(out, text);
+        break;
+    case Type::RemoveObject:
+    case Type::RestoreObject:
+        PutString(out, id);
+        PutString(out, text);
+        PutString(out, parent);
+        Put(out, transform.position);
+        Put(out, transform.rotation);
+        Put(out, transform.scale);
+        PutPhysics(out, physics);
+        Put(out, static_cast<uint32_t>(children.size()));
+        for (const std::string& child : children) {
+            PutString(out, child);
+        }
+        break;
+    case Type::Transform:
+        PutString(out, id);
+        Put(out, field);
+        Put(out, previousValue);
+        Put(out, value);
+        break;
+    case Type::Physics:
+        PutString(out, id);
+        PutPhysics(out, previousPhysics);
+        PutPhysics(out, physics);
+        break;
+    case Type::Parent:
+        PutString(out, id);
+        PutString(out, previousParent);
+        PutString(out, parent);
+        break;
+    case Type::Background:
+        Put(out, previousValue);
+        Put(out, value);
+        break;
+    }
+}
+
+bool SceneEdit::Decode(const uint8_t* data, size_t size) {
+    EditReader reader{ data, size };
+    *this = SceneEdit();
+    type = reader.Get<Type>();
+
+    switch (type) {
+    case Type::AddObject:
+    case Type::AddAlias:
+    case Type::RemoveAlias:
+        id = reader.GetString();
+        text = reader.GetString();
+        break;
+    case Type::RemoveObject:
+    case Type::RestoreObject: {
+        id = reader.GetString();
+        text = reader.GetString();
+        parent = reader.GetString();
+        transform.position = reader.Get<glm::vec3>();
+        transform.rotation = reader.Get<glm::vec3>();
+        transform.scale = reader.Get<glm::vec3>();
+        physics = reader.GetPhysics();
+        // Each child takes at least its length, which bounds the count before reserving
+        uint32_t childCount = reader.Get<uint32_t>();
+        if (childCount > (size - reader.offset) / sizeof(uint32_t)) return false;
+        children.resize(childCount);
+        for (std::string& child : children) {
+            child = reader.GetString();
+        }
+        break;
+    }
+    case Type::Transform:
+        id = reader.GetString();
+        field = reader.Get<uint8_t>();
+        previousValue = reader.Get<glm::vec3>();
+        value = reader.Get<glm::vec3>();
+        reader.ok &= field <= Scale;
+        break;
+    case Type::Physics:
+        id = reader.GetString();
+        previousPhysics = reader.GetPhysics();
+        physics = reader.GetPhysics();
+        break;
+    case Type::Parent:
+        id = reader.GetString();
+        previousParent = reader.GetString();
+        parent = reader.GetString();
+        break;
+    case Type::Background:
+        previousValue = reader.Get<glm::vec3>();
+        value = reader.Get<glm::vec3>();
+        break;
+    default:
+        return false;
+    }
+    return reader.ok && reader.offset == size;
+}
+
+SceneJournal::SceneJournal(std::string scenePath) :
+    scenePath(std::move(scenePath)),
+    journalPath(GetJournalPath(this->scenePath)),
+    lineage(NewLineage())
+{
+}
+
+SceneJournal::~SceneJournal() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool SceneJournal::Open(const SceneDescription& snapshot, std::vector<uint8_t>& tail) {
+    std::lock_guard<std::mutex> lock(mutex);
+    started = true;
+    snapshotSequence = snapshot.journalSequence;
+    nextSequence = snapshotSequence + 1;
+
+    std::vector<uint8_t> contents;
+    {
+        std::ifstream in(journalPath, std::ios::binary | std::ios::ate);
+        if (in.is_open()) {
+            contents.resize(static_cast<size_t>(in.tellg()));
+            in.seekg(0);
+            in.read(reinterpret_cast<char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+            contents.resize(static_cast<size_t>(in.gcount()));
+        }
+    }
+
+    // A snapshot that was never stamped takes over whatever journal lies next to it
+    Header header = {};
+    bool belongs = contents.size() >= sizeof(Header) && std::memcmp(contents.data(), JournalMagic, sizeof(JournalMagic)) == 0;
+    if (belongs) {
+        std::memcpy(&header, contents.data(), sizeof(Header));
+        belongs = snapshot.journalLineage == 0 || header.lineage == snapshot.journalLineage;
+    }
+
+    if (!belongs) {
+        if (!contents.empty()) {
+            std::cerr << "Scene journal does not belong to the scene file, starting a new one: " << journalPath << std::endl;
+        }
+        lineage = snapshot.journalLineage != 0 ? snapshot.journalLineage : lineage;
+        bool restarted = Restart({});
+        Start();
+        return restarted;
+    }
+
+    lineage = header.lineage;
+    size_t offset = sizeof(Header);
+    uint64_t last = 0;
+    while (contents.size() - offset >= sizeof(RecordHeader)) {
+        RecordHeader record;
+        std::memcpy(&record, contents.data() + offset, sizeof(RecordHeader));
+        const uint8_t* edit = contents.data() + offset + sizeof(RecordHeader);
+        if (record.size > contents.size() - offset - sizeof(RecordHeader) || record.sequence <= last ||
+            Checksum(record.sequence, edit, record.size) != record.checksum) {
+            break;
+        }
+
+        size_t end = offset + sizeof(RecordHeader) + record.size;
+        if (record.sequence > snapshotSequence) {
+            tail.insert(tail.end(), contents.begin() + offset, contents.begin() + end);
+        }
+        last = record.sequence;
+        offset = end;
+    }
+    nextSequence = std::max(last, snapshotSequence) + 1;
+
+    bool opened = true;
+    if (offset < contents.size()) {
+        // New records must not land behind the damaged one, where nothing would read them
+        std::cerr << "Scene journal ends in a damaged record, dropped " << contents.size() - offset << " bytes: " << journalPath << std::endl;
+        opened = Restart(std::vector<uint8_t>(contents.begin() + sizeof(Header), contents.begin() + offset));
+    }
+    else {
+        file.open(journalPath, std::ios::binary | std::ios::app);
+        size = offset;
+        opened = file.is_open();
+    }
+    Start();
+    return opened;
+}
+
+void SceneJournal::Start() {
+    if (!worker.joinable()) {
+        worker = std::thread(&SceneJournal::CompactLoop, this);
+    }
+}
+
+bool SceneJournal::Restart(const std::vector<uint8_t>& records) {
+    file.close();
+    started = true;
+
+    Header header = {};
+    std::memcpy(header.magic, JournalMagic, sizeof(JournalMagic));
+    header.lineage = lineage;
+
+    // Replaced in one rename, so a crash leaves either journal whole
+    std::string tempPath = journalPath + ".tmp";
+    bool written;
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size()));
+        written = out.good();
+    }
+
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(tempPath, journalPath, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(tempPath, error);
+        std::cerr << "Failed to rewrite scene journal: " << journalPath << std::endl;
+        // Keep appending to the old one, whatever it holds is either newer or already in the snapshot
+        file.open(journalPath, std::ios::binary | std::ios::app);
+        return false;
+    }
+
+    file.open(journalPath, std::ios::binary | std::ios::app);
+    size = sizeof(Header) + records.size();
+    return file.is_open();
+}
+
+void SceneJournal::Append(const std::vector<uint8_t>& edit) {
+    std::lock_guard<std::mutex> lock(mutex);
+    RecordHeader record = { static_cast<uint32_t>(edit.size()), Checksum(nextSequence, edit.data(), edit.size()), nextSequence };
+
+    // Kept in memory until WriteSnapshot starts the journal, there is no file to go with it yet
+    if (!started) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+        unstartedRecords.insert(unstartedRecords.end(), bytes, bytes + sizeof(record));
+        unstartedRecords.insert(unstartedRecords.end(), edit.begin(), edit.end());
+        nextSequence++;
+        return;
+    }
+    if (!file.is_open()) return;
+
+    file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    file.write(reinterpret_cast<const char*>(edit.data()), static_cast<std::streamsize>(edit.size()));
+    file.flush();
+    if (!file) {
+        std::cerr << "Failed to append to scene journal, further edits are not journaled: " << journalPath << std::endl;
+        file.close();
+        return;
+    }
+
+    nextSequence++;
+    bool wasSmall = size < CompactBytes;
+    size += sizeof(record) + edit.size();
+    if (wasSmall && size >= CompactBytes) {
+        compactRequested = true;
+        wake.notify_one();
+    }
+}
+
+bool SceneJournal::ReadRecords(uint64_t begin, uint64_t end, std::vector<uint8_t>& records) {
+    records.resize(static_cast<size_t>(end - begin));
+    if (records.empty()) return true;
+
+    std::ifstream in(journalPath, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(begin));
+    in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size()));
+    if (!in) {
+        std::cerr << "Failed to read scene journal: " << journalPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+uint64_t SceneJournal::BeginSnapshot() {
+    std::lock_guard<std::mutex> lock(mutex);
+    pendingSnapshots.push_back(nextSequence - 1);
+    return nextSequence - 1;
+}
+
+bool SceneJournal::WriteSnapshot(SceneDescription& scene, uint64_t sequence) {
+    std::lock_guard<std::mutex> compactLock(compactMutex);
+
+    // Appending goes on while the file is written, records after sequence are kept for it
+    scene.journalLineage = lineage;
+    scene.journalSequence = sequence;
+    bool written = SceneFormat::Write(scenePath, scene);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingSnapshots.erase(std::find(pendingSnapshots.begin(), pendingSnapshots.end(), sequence));
+        if (!written) return false;
+    }
+
+    // A journal that failed to start over still only holds records the file has or newer ones
+    StartOver(sequence);
+    std::lock_guard<std::mutex> lock(mutex);
+    Start();
+    return true;
+}
+
+bool SceneJournal::StartOver(uint64_t sequence) {
+    // Most of the journal is read without holding up Append, which only adds past end
+    uint64_t end;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        end = size;
+    }
+    std::vector<uint8_t> records;
+    if (end > sizeof(Header) && !ReadRecords(sizeof(Header), end, records)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size > end) {
+        std::vector<uint8_t> newer;
+        if (!ReadRecords(end, size, newer)) {
+            return false;
+        }
+        records.insert(records.end(), newer.begin(), newer.end());
+    }
+    records.insert(records.end(), unstartedRecords.begin(), unstartedRecords.end());
+    unstartedRecords.clear();
+
+    // Snapshots still being written need the records after their own sequence
+    uint64_t keepAfter = sequence;
+    for (uint64_t pending : pendingSnapshots) {
+        keepAfter = std::min(keepAfter, pending);
+    }
+
+    std::vector<uint8_t> kept;
+    for (size_t offset = 0; records.size() - offset >= sizeof(RecordHeader);) {
+        RecordHeader record;
+        std::memcpy(&record, records.data() + offset, sizeof(RecordHeader));
+        size_t next = offset + sizeof(RecordHeader) + std::min<size_t>(record.size, records.size() - offset - sizeof(RecordHeader));
+        if (record.sequence > keepAfter) {
+            kept.insert(kept.end(), records.begin() + offset, records.begin() + next);
+        }
+        offset = next;
+    }
+
+    snapshotSequence = sequence;
+    compactRequested = false;
+    return Restart(kept);
+}
+
+bool SceneJournal::Compact() {
+    std::lock_guard<std::mutex> compactLock(compactMutex);
+
+    uint64_t end;
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        compactRequested = false;
+        if (!started || suspended || nextSequence - 1 == snapshotSequence) return true;
+        end = size;
+        sequence = nextSequence - 1;
+    }
+
+    // Records up to end are flushed and never change, Append only adds after them
+    SceneDescription scene;
+    std::vector<uint8_t> records;
+    if (!SceneFormat::Read(scenePath, scene) || !ReadRecords(sizeof(Header), end, records)) {
+        std::cerr << "Failed to compact scene journal: " << journalPath << std::endl;
+        return false;
+    }
+    if (scene.journalLineage != 0 && scene.journalLineage != lineage) {
+        std::cerr << "Scene file was replaced, not compacting its journal into it: " << scenePath << std::endl;
+        return false;
+    }
+
+    Replay(records, scene.journalLineage == lineage ? scene.journalSequence : 0, scene);
+    scene.journalLineage = lineage;
+    scene.journalSequence = sequence;
+    if (!scene.cells.empty()) {
+        SceneFormat::Partition(scene, scene.cellSize);
+    }
+    if (!SceneFormat::Write(scenePath, scene)) {
+        return false;
+    }
+    return StartOver(sequence);
+}
+
+void SceneJournal::Suspend() {
+    std::lock_guard<std::mutex> compactLock(compactMutex);
+    std::lock_guard<std::mutex> lock(mutex);
+    suspended = true;
+    file.close();
+}
+
+void SceneJournal::Resume() {
+    std::lock_guard<std::mutex> lock(mutex);
+    suspended = false;
+    if (!started) return;
+
+    // Whoever read the journal meanwhile may have started it over
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(journalPath, error);
+    size = error ? size : fileSize;
+    file.open(journalPath, std::ios::binary | std::ios::app);
+}
+
+void SceneJournal::CompactLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait_for(lock, CompactInterval, [this] { return stopping || compactRequested; });
+        if (stopping) return;
+        if (nextSequence - 1 == snapshotSequence) {
+            compactRequested = false;
+            continue;
+        }
+
+        lock.unlock();
+        Compact();
+        lock.lock();
+    }
+}
+
+// Drops removed objects and puts every parent ahead of its children again. Objects whose parent
+// is gone, or that a cycle cut off from every root, become roots.
+static void Reorder(SceneDescription& scene, const std::vector<uint8_t>& removed) {
+    constexpr uint32_t None = SceneDescription::NoParent;
+    uint32_t objectCount = static_cast<uint32_t>(scene.GetObjectCount());
+
+    std::vector<uint32_t> firstChild(objectCount, None);
+    std::vector<uint32_t> nextSibling(objectCount, None);
+    for (uint32_t i = objectCount; i-- > 0;) {
+        uint32_t parent = scene.parents[i];
+        if (removed[i] || parent == None || removed[parent]) continue;
+        nextSibling[i] = firstChild[parent];
+        firstChild[parent] = i;
+    }
+
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> newIndex(objectCount, None);
+    std::vector<uint32_t> stack;
+    order.reserve(objectCount);
+    auto visit = [&](uint32_t root) {
+        stack.push_back(root);
+        while (!stack.empty()) {
+            uint32_t index = stack.back();
+            stack.pop_back();
+            if (newIndex[index] != None) continue;
+
+            newIndex[index] = static_cast<uint32_t>(order.size());
+            order.push_back(index);
+            for (uint32_t child = firstChild[index]; child != None; child = nextSibling[child]) {
+                stack.push_back(child);
+            }
+        }
+    };
+
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        if (!removed[i] && (scene.parents[i] == None || removed[scene.parents[i]])) {
+            scene.parents[i] = None;
+            visit(i);
+        }
+    }
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        if (!removed[i] && newIndex[i] == None) {
+            scene.parents[i] = None;
+            visit(i);
+        }
+    }
+
+    auto permute = [&order](auto& values) {
+        std::remove_reference_t<decltype(values)> sorted;
+        sorted.reserve(order.size());
+        for (uint32_t index : order) {
+            sorted.push_back(values[index]);
+        }
+        values = std::move(sorted);
+    };
+    permute(scene.ids);
+    permute(scene.modelPaths);
+    permute(scene.transforms);
+    permute(scene.physics);
+    permute(scene.parents);
+    for (uint32_t& parent : scene.parents) {
+        if (parent != None) {
+            parent = newIndex[parent];
+        }
+    }
+}
+
+void SceneJournal::Replay(const std::vector<uint8_t>& records, uint64_t after, SceneDescription& scene) {
+    constexpr uint32_t None = SceneDescription::NoParent;
+
+    // A file listing an id twice keeps the last object, as loading does
+    std::unordered_map<std::string_view, uint32_t> objects;
+    objects.reserve(scene.GetObjectCount());
+    for (uint32_t i = 0; i < scene.GetObjectCount(); ++i) {
+        objects[scene.strings[scene.ids[i]]] = i;
+    }
+    auto find = [&objects](const std::string& id) {
+        auto it = objects.find(id);
+        return it != objects.end() ? it->second : None;
+    };
+
+    // Removed objects stay where they are until Reorder drops them
+    std::vector<uint8_t> removed(scene.GetObjectCount(), 0);
+    bool reorder = false;
+    auto add = [&](const SceneEdit& edit, const TransformComponent& transform, const PhysicsProperties& physics) {
+        uint32_t index = static_cast<uint32_t>(scene.GetObjectCount());
+        scene.ids.push_back(scene.AppendString(edit.id));
+        scene.modelPaths.push_back(scene.AddString(edit.text));
+        scene.parents.push_back(None);
+        scene.transforms.push_back(transform);
+        scene.physics.push_back(physics);
+        removed.push_back(0);
+        objects[scene.strings[scene.ids.back()]] = index;
+        return index;
+    };
+
+    SceneEdit edit;
+    for (size_t offset = 0; records.size() - offset >= sizeof(RecordHeader);) {
+        RecordHeader record;
+        std::memcpy(&record, records.data() + offset, sizeof(RecordHeader));
+        if (record.size > records.size() - offset - sizeof(RecordHeader)) break;
+
+        const uint8_t* data = records.data() + offset + sizeof(RecordHeader);
+        offset += sizeof(RecordHeader) + record.size;
+        if (record.sequence <= after || !edit.Decode(data, record.size)) continue;
+
+        uint32_t index = edit.type == SceneEdit::Type::Background ? None : find(edit.id);
+        switch (edit.type) {
+        case SceneEdit::Type::AddObject:
+            if (index == None) {
+                add(edit, TransformComponent(), PhysicsProperties());
+            }
+            break;
+        case SceneEdit::Type::RemoveObject:
+            if (index == None) break;
+            // Children move up to the removed object's parent, as Scene::RemoveObject does
+            for (const std::string& child : edit.children) {
+                uint32_t childIndex = find(child);
+                if (childIndex != None && scene.parents[childIndex] == index) {
+                    scene.parents[childIndex] = scene.parents[index];
+                }
+            }
+            removed[index] = 1;
+            objects.erase(edit.id);
+            reorder = true;
+            break;
+        case SceneEdit::Type::RestoreObject: {
+            if (index != None) break;
+            uint32_t parent = find(edit.parent);
+            index = add(edit, edit.transform, edit.physics);
+            scene.parents[index] = parent;
+            for (const std::string& child : edit.children) {
+                uint32_t childIndex = find(child);
+                if (childIndex != None) {
+                    scene.parents[childIndex] = index;
+                }
+            }
+            reorder = true;
+            break;
+        }
+        case SceneEdit::Type::Transform:
+            if (index == None) break;
+            (edit.field == SceneEdit::Position ? scene.transforms[index].position :
+                edit.field == SceneEdit::Rotation ? scene.transforms[index].rotation : scene.transforms[index].scale) = edit.value;
+            break;
+        case SceneEdit::Type::Physics:
+            if (index != None) {
+                scene.physics[index] = edit.physics;
+            }
+            break;
+        case SceneEdit::Type::Parent: {
+            uint32_t parent = find(edit.parent);
+            if (index == None || (!edit.parent.empty() && parent == None)) break;
+            scene.parents[index] = parent;
+            reorder = true;
+            break;
+        }
+        case SceneEdit::Type::AddAlias:
+            scene.aliases.emplace_back(scene.AddString(edit.id), scene.AddString(edit.text));
+            break;
+        case SceneEdit::Type::RemoveAlias:
+            for (size_t i = scene.aliases.size(); i-- > 0;) {
+                if (scene.strings[scene.aliases[i].first] == edit.id && scene.strings[scene.aliases[i].second] == edit.text) {
+                    scene.aliases.erase(scene.aliases.begin() + i);
+                    break;
+                }
+            }
+            break;
+        case SceneEdit::Type::Background:
+            scene.backgroundColor = edit.value;
+            break;
+        }
+    }
+
+    if (reorder) {
+        Reorder(scene, removed);
+    }
+}
\ No newline at end of file
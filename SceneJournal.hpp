@@ -0,0 +1,159 @@
+#pragma once
+
+#include "SceneComponents.hpp"
+#include <glm/glm.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SceneDescription;
+
+// One change made through Scene, with what it replaced so it can be taken back. Objects are named
+// by id. Only the fields of the edit's type are used.
+struct SceneEdit {
+    enum class Type : uint8_t {
+        AddObject = 1,
+        RemoveObject,
+        // Brings a removed object back as it was, under its parent and over the children that
+        // moved up when it was removed
+        RestoreObject,
+        Transform,
+        Physics,
+        Parent,
+        AddAlias,
+        RemoveAlias,
+        Background
+    };
+
+    enum Field : uint8_t {
+        Position,
+        Rotation,
+        Scale
+    };
+
+    Type type = Type::AddObject;
+    // Transform field the edit changed
+    uint8_t field = Position;
+    // Object id, the alias key for alias edits
+    std::string id;
+    // Model path, the alias value for alias edits
+    std::string text;
+    // Parent after a Parent edit, parent of a removed or restored object
+    std::string parent;
+    std::string previousParent;
+    std::vector<std::string> children;
+    // Removed or restored object
+    TransformComponent transform;
+    // Removed or restored object, settings after a Physics edit
+    PhysicsProperties physics;
+    PhysicsProperties previousPhysics;
+    // Transform field or background colour before and after
+    glm::vec3 value = glm::vec3(0.0f);
+    glm::vec3 previousValue = glm::vec3(0.0f);
+
+    // The edit that takes this one back
+    SceneEdit Inverted() const;
+
+    // Appends the edit's compact binary form to out
+    void Encode(std::vector<uint8_t>& out) const;
+    bool Decode(const uint8_t* data, size_t size);
+};
+
+// Append-only log of the edits made to a scene since its file was last written, kept next to the
+// file as <scene>.journal. Every edit costs one small write instead of rewriting the scene, and
+// edits still in the journal after a crash are replayed onto the file on the next load.
+//
+// A thread folds the journal into a new snapshot of the scene file every CompactInterval, or
+// sooner once it holds CompactBytes, and starts the journal over. The snapshot's JRNL chunk names
+// the journal (its lineage) and the last record it contains, so records a crash left behind after
+// a snapshot are not applied twice.
+//
+// The journal starts with a Header, then per edit a RecordHeader and the encoded SceneEdit. A
+// record that does not check out ends the journal, it is what a crash mid-write leaves behind.
+class SceneJournal {
+public:
+    static constexpr std::chrono::seconds CompactInterval = std::chrono::seconds(30);
+    static constexpr uint64_t CompactBytes = 4ull * 1024 * 1024;
+
+    explicit SceneJournal(std::string scenePath);
+    ~SceneJournal();
+
+    SceneJournal(const SceneJournal&) = delete;
+    SceneJournal& operator=(const SceneJournal&) = delete;
+
+    const std::string& GetScenePath() const { return scenePath; }
+    static std::string GetJournalPath(const std::string& scenePath) { return scenePath + ".journal"; }
+
+    // Continues the journal next to the scene when it belongs to snapshot, the scene just read
+    // from the file, and starts a new one otherwise. Records newer than the snapshot are appended
+    // to tail as they are stored, for Replay.
+    bool Open(const SceneDescription& snapshot, std::vector<uint8_t>& tail);
+
+    // Applies stored records newer than after to scene, keeping parents ahead of their children
+    static void Replay(const std::vector<uint8_t>& records, uint64_t after, SceneDescription& scene);
+
+    // Appends an encoded edit and hands it to the OS, so it survives the process crashing
+    void Append(const std::vector<uint8_t>& edit);
+
+    // Call when describing the scene for WriteSnapshot, on the thread that appends. Returns the
+    // last record the description contains.
+    uint64_t BeginSnapshot();
+
+    // Writes scene, described when BeginSnapshot returned sequence, to the scene file and starts
+    // the journal over with the records after sequence. Can run on another thread while edits are
+    // appended. Waits for a compaction in progress. A journal that was neither opened nor written
+    // a snapshot for keeps its records in memory until then.
+    bool WriteSnapshot(SceneDescription& scene, uint64_t sequence);
+
+    // Applies the journal to the scene file and starts the journal over with the records appended
+    // meanwhile. Runs on the journal's thread, or right away for a partitioned scene, which is
+    // streamed from the file and so cannot have the journal replayed in memory.
+    bool Compact();
+    // Stops compacting and closes the journal until Resume, for a reader that needs the scene file
+    // and journal as they are, such as a new SceneJournal opening them. Waits for a compaction in
+    // progress. Nothing may be appended meanwhile.
+    void Suspend();
+    void Resume();
+
+private:
+    struct Header;
+    struct RecordHeader;
+
+    std::string scenePath;
+    std::string journalPath;
+    uint64_t lineage = 0;
+
+    // Guards everything below, which Append shares with the thread
+    std::mutex mutex;
+    std::ofstream file;
+    uint64_t size = 0;
+    uint64_t nextSequence = 1;
+    uint64_t snapshotSequence = 0;
+    bool started = false;
+    std::vector<uint8_t> unstartedRecords;
+    // Sequences of snapshots begun and not written yet
+    std::vector<uint64_t> pendingSnapshots;
+    bool compactRequested = false;
+    bool suspended = false;
+    bool stopping = false;
+    std::condition_variable wake;
+    std::thread worker;
+
+    // Held for a whole compaction or snapshot, so only one writes the scene file at a time
+    std::mutex compactMutex;
+
+    void Start();
+    // Starts the journal over with the records after sequence, and those pending snapshots still
+    // need. Called with compactMutex held, so nothing else rewrites the journal meanwhile.
+    bool StartOver(uint64_t sequence);
+    // Replaces the journal with a header and records, reopened for appending. Called with mutex
+    // held.
+    bool Restart(const std::vector<uint8_t>& records);
+    bool ReadRecords(uint64_t begin, uint64_t end, std::vector<uint8_t>& records);
+    void CompactLoop();
+};
\ No newline at end of file
@@ -1,61 +1,72 @@
 #include "Scene.hpp"
+#include "SceneJournal.hpp"
+
+#include <utility>
 
 void Scene::SetObjectPhysicsEnabled(const std::string& id, bool enabled) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->physics.isAffectedByPhysics = enabled;
-    }
+    ChangePhysics(id, [enabled](PhysicsProperties& physics) { physics.isAffectedByPhysics = enabled; });
 }
 
 void Scene::SetObjectCollisionEnabled(const std::string& id, bool enabled) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->physics.hasCollision = enabled;
-    }
+    ChangePhysics(id, [enabled](PhysicsProperties& physics) { physics.hasCollision = enabled; });
 }
 
 void Scene::SetObjectStatic(const std::string& id, bool isStatic) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->physics.isStatic = isStatic;
-    }
+    ChangePhysics(id, [isStatic](PhysicsProperties& physics) { physics.isStatic = isStatic; });
 }
 
 void Scene::SetObjectMass(const std::string& id, float mass) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->physics.mass = mass;
-    }
+    ChangePhysics(id, [mass](PhysicsProperties& physics) { physics.mass = mass; });
 }
 
 void Scene::SetObjectCollisionShape(const std::string& id, const glm::vec3& shapeSize) {
-    SceneObject* obj = GetObject(id);
-    if (obj) {
-        obj->physics.collisionShapeSize = shapeSize;
+    ChangePhysics(id, [&shapeSize](PhysicsProperties& physics) { physics.collisionShapeSize = shapeSize; });
+}
+
+void Scene::SetPhysics(const std::string& id, const PhysicsProperties& physics) {
+    bool merge = std::exchange(mergeNextEdit, false);
+    entt::entity entity = FindObject(id);
+    if (entity == entt::null) return;
+
+    PhysicsProperties& current = registry.get<PhysicsProperties>(entity);
+    if (current.hasCollision == physics.hasCollision && current.isAffectedByPhysics == physics.isAffectedByPhysics &&
+        current.isStatic == physics.isStatic && current.mass == physics.mass && current.collisionShapeSize == physics.collisionShapeSize) {
+        return;
     }
+
+    SceneEdit edit;
+    edit.type = SceneEdit::Type::Physics;
+    edit.id = id;
+    edit.previousPhysics = current;
+    edit.physics = physics;
+
+    current = physics;
+    NoteEdit(entity);
+    mergeNextEdit = merge;
+    RecordEdit(edit);
 }
 
 bool Scene::GetObjectPhysicsEnabled(const std::string& id) const {
-    const SceneObject* obj = GetObject(id);
-    return obj ? obj->physics.isAffectedByPhysics : false;
+    const PhysicsProperties* physics = FindComponent<PhysicsProperties>(id);
+    return physics ? physics->isAffectedByPhysics : false;
 }
 
 bool Scene::GetObjectCollisionEnabled(const std::string& id) const {
-    const SceneObject* obj = GetObject(id);
-    return obj ? obj->physics.hasCollision : false;
+    const PhysicsProperties* physics = FindComponent<PhysicsProperties>(id);
+    return physics ? physics->hasCollision : false;
 }
 
 bool Scene::GetObjectStatic(const std::string& id) const {
-    const SceneObject* obj = GetObject(id);
-    return obj ? obj->physics.isStatic : false;
+    const PhysicsProperties* physics = FindComponent<PhysicsProperties>(id);
+    return physics ? physics->isStatic : false;
 }
 
 float Scene::GetObjectMass(const std::string& id) const {
-    const SceneObject* obj = GetObject(id);
-    return obj ? obj->physics.mass : 1.0f;
+    const PhysicsProperties* physics = FindComponent<PhysicsProperties>(id);
+    return physics ? physics->mass : 1.0f;
 }
 
 glm::vec3 Scene::GetObjectCollisionShape(const std::string& id) const {
-    const SceneObject* obj = GetObject(id);
-    return obj ? obj->physics.collisionShapeSize : glm::vec3(1.0f);
+    const PhysicsProperties* physics = FindComponent<PhysicsProperties>(id);
+    return physics ? physics->collisionShapeSize : glm::vec3(1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "SceneSaver.hpp"
+#include "SceneFormat.hpp"
+#include "SceneJournal.hpp"
+
+#include <chrono>
+#include <iostream>
+
+SceneSaver::SceneSaver() {
+    worker = std::thread(&SceneSaver::WriteScenes, this);
+}
+
+SceneSaver::~SceneSaver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void SceneSaver::Queue(const SaveHandle& handle, std::unique_ptr<SceneDescription> scene, std::shared_ptr<SceneJournal> journal,
+    uint64_t sequence, float cellSize)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({ handle, std::move(scene), std::move(journal), sequence, cellSize });
+    }
+    wake.notify_one();
+}
+
+void SceneSaver::WriteScenes() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) return;
+
+        Job job = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+
+        SaveHandle::State& state = *job.handle.state;
+        auto start = std::chrono::steady_clock::now();
+        if (job.cellSize > 0.0f) {
+            state.stage = SaveHandle::Stage::Partitioning;
+            SceneFormat::Partition(*job.scene, job.cellSize);
+        }
+
+        state.stage = SaveHandle::Stage::Writing;
+        bool saved = job.journal->WriteSnapshot(*job.scene, job.sequence);
+        if (saved) {
+            std::cout << "Scene saved to: " << state.path << std::endl;
+        }
+
+        // The snapshot and the journal may be the last references, they go before the handle says done
+        job.scene.reset();
+        job.journal.reset();
+        state.writeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        state.stage = saved ? SaveHandle::Stage::Saved : SaveHandle::Stage::Failed;
+        state.promise.set_value(saved);
+
+        lock.lock();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct SceneDescription;
+class SceneJournal;
+
+// Progress of a save started by Scene::SaveToFileAsync. Copies share the same state.
+class SaveHandle {
+public:
+    enum class Stage : uint8_t {
+        Queued,
+        // Bucketing the objects into cells, for a scene saved with a cell size
+        Partitioning,
+        Writing,
+        Saved,
+        Failed
+    };
+
+    bool IsValid() const { return state != nullptr; }
+    Stage GetStage() const { return state ? state->stage.load() : Stage::Failed; }
+    bool IsDone() const { return GetStage() == Stage::Saved || GetStage() == Stage::Failed; }
+    bool Succeeded() const { return GetStage() == Stage::Saved; }
+    const std::string& GetPath() const { return state->path; }
+    uint32_t GetObjectCount() const { return state ? state->objectCount : 0; }
+
+    // Time the calling thread spent taking the snapshot, and the worker writing it once done
+    double GetSnapshotMs() const { return state ? state->snapshotMs : 0.0; }
+    double GetWriteMs() const { return state ? state->writeMs : 0.0; }
+
+    // Ready with whether the file was written. Waiting on it blocks until then.
+    const std::shared_future<bool>& GetFuture() const { return state->future; }
+    bool Wait() const { return state && state->future.get(); }
+
+    explicit operator bool() const { return IsValid(); }
+
+private:
+    friend class Scene;
+    friend class SceneSaver;
+
+    struct State {
+        std::string path;
+        uint32_t objectCount = 0;
+        double snapshotMs = 0.0;
+        // Written by the worker before stage turns Saved or Failed
+        double writeMs = 0.0;
+        std::atomic<Stage> stage = Stage::Queued;
+        std::promise<bool> promise;
+        std::shared_future<bool> future = promise.get_future().share();
+        // Run by Scene::ProcessSaves on the thread that saved
+        std::function<void(const SaveHandle&)> onComplete;
+    };
+    std::shared_ptr<State> state;
+};
+
+// Partitions and writes scene snapshots on its own thread, one at a time in the order they were
+// queued, so a later save of the same file always lands last.
+class SceneSaver {
+public:
+    SceneSaver();
+    // Finishes the saves still queued
+    ~SceneSaver();
+
+    SceneSaver(const SceneSaver&) = delete;
+    SceneSaver& operator=(const SceneSaver&) = delete;
+
+    // The journal writes the file and starts over past sequence, see SceneJournal::WriteSnapshot.
+    // A cellSize above 0 partitions the scene first.
+    void Queue(const SaveHandle& handle, std::unique_ptr<SceneDescription> scene, std::shared_ptr<SceneJournal> journal,
+        uint64_t sequence, float cellSize);
+
+private:
+    struct Job {
+        SaveHandle handle;
+        std::unique_ptr<SceneDescription> scene;
+        std::shared_ptr<SceneJournal> journal;
+        uint64_t sequence = 0;
+        float cellSize = 0.0f;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> queue;
+    bool stopping = false;
+    std::thread worker;
+
+    void WriteScenes();
+};
\ No newline at end of file
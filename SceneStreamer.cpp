@@ -0,0 +1,209 @@
+#include "SceneStreamer.hpp"
+
+#include <algorithm>
+
+SceneStreamer::SceneStreamer(std::shared_ptr<SceneArchive> archive) :
+    archive(std::move(archive)),
+    cells(this->archive->GetCells().size())
+{
+    // A file listing an id twice keeps the last object, so does the index
+    const std::vector<SceneCell>& layout = this->archive->GetCells();
+    idCells.reserve(this->archive->GetObjectCount());
+    for (uint32_t i = 0; i < layout.size(); ++i) {
+        for (uint32_t object = layout[i].firstObject; object < layout[i].firstObject + layout[i].objectCount; ++object) {
+            std::string_view id = this->archive->GetObjectId(object);
+            if (!id.empty()) {
+                idCells[id] = i;
+            }
+        }
+    }
+
+    worker = std::thread(&SceneStreamer::ReadCells, this);
+}
+
+SceneStreamer::~SceneStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+uint32_t SceneStreamer::FindCell(const std::string& id) const {
+    auto it = idCells.find(std::string_view(id));
+    return it != idCells.end() ? it->second : NoCell;
+}
+
+void SceneStreamer::SetRadius(float load, float unload) {
+    loadRadius = std::max(load, 0.0f);
+    unloadRadius = std::max(unload, loadRadius);
+}
+
+void SceneStreamer::Update(const glm::vec3& position) {
+    const std::vector<SceneCell>& layout = archive->GetCells();
+    float cellSize = archive->GetCellSize();
+    glm::vec2 point(position.x, position.z);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.clear();
+
+    for (uint32_t i = 0; i < cells.size(); ++i) {
+        Cell& cell = cells[i];
+        glm::vec2 min(float(layout[i].x) * cellSize, float(layout[i].z) * cellSize);
+        cell.distance = glm::distance(glm::clamp(point, min, min + cellSize), point);
+        bool wanted = cell.distance <= loadRadius;
+        bool unwanted = cell.distance > unloadRadius;
+
+        switch (cell.state) {
+        case CellState::Unloaded:
+            if (wanted) {
+                // Edited cells come back from memory, the file does not have their changes
+                if (cell.edits) {
+                    cell.objects = std::move(cell.edits);
+                    cell.state = CellState::Ready;
+                }
+                else {
+                    cell.state = CellState::Queued;
+                }
+            }
+            break;
+        case CellState::Queued:
+        case CellState::Reading:
+            // The IO thread drops what it reads for a cell that is no longer Reading
+            if (unwanted) {
+                cell.state = CellState::Unloaded;
+            }
+            break;
+        case CellState::Ready:
+            if (unwanted) {
+                if (cell.edited) {
+                    cell.edits = std::move(cell.objects);
+                }
+                cell.objects.reset();
+                cell.state = CellState::Unloaded;
+            }
+            break;
+        case CellState::Resident:
+            if (unwanted) {
+                cell.state = CellState::Unloading;
+            }
+            break;
+        case CellState::Unloading:
+            if (wanted && i != unloadingCell) {
+                cell.state = CellState::Resident;
+            }
+            break;
+        default:
+            // The cell being created finishes first and is looked at again afterwards
+            break;
+        }
+
+        if (cell.state == CellState::Queued) {
+            queue.push_back(i);
+        }
+    }
+
+    std::sort(queue.begin(), queue.end(), [this](uint32_t a, uint32_t b) { return cells[a].distance > cells[b].distance; });
+    if (!queue.empty()) {
+        wake.notify_one();
+    }
+}
+
+void SceneStreamer::BeginCreating() {
+    if (creatingCell != NoCell) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t i = 0; i < cells.size(); ++i) {
+        if (cells[i].state == CellState::Ready && (creatingCell == NoCell || cells[i].distance < cells[creatingCell].distance)) {
+            creatingCell = i;
+        }
+    }
+    if (creatingCell != NoCell) {
+        cells[creatingCell].state = CellState::Creating;
+    }
+}
+
+void SceneStreamer::FinishCreating() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Cell& cell = cells[creatingCell];
+    cell.objects.reset();
+    cell.created = 0;
+    cell.state = CellState::Resident;
+    creatingCell = NoCell;
+}
+
+void SceneStreamer::BeginUnloading() {
+    if (unloadingCell != NoCell) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t i = 0; i < cells.size(); ++i) {
+        if (cells[i].state == CellState::Unloading && (unloadingCell == NoCell || cells[i].distance > cells[unloadingCell].distance)) {
+            unloadingCell = i;
+        }
+    }
+}
+
+void SceneStreamer::FinishUnloading() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Cell& cell = cells[unloadingCell];
+    cell.entities.clear();
+    cell.entities.shrink_to_fit();
+    cell.state = CellState::Unloaded;
+    unloadingCell = NoCell;
+}
+
+StreamingStats SceneStreamer::GetStats() const {
+    StreamingStats stats;
+    stats.cells = static_cast<uint32_t>(cells.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Cell& cell : cells) {
+        switch (cell.state) {
+        case CellState::Queued:
+        case CellState::Reading:
+        case CellState::Ready:
+        case CellState::Creating:
+            stats.loadingCells++;
+            break;
+        case CellState::Resident:
+            stats.residentCells++;
+            break;
+        case CellState::Unloading:
+            stats.unloadingCells++;
+            break;
+        default:
+            break;
+        }
+        stats.editedCells += cell.edited ? 1 : 0;
+    }
+    return stats;
+}
+
+void SceneStreamer::ReadCells() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) return;
+
+        uint32_t index = queue.back();
+        queue.pop_back();
+        Cell& cell = cells[index];
+        if (cell.state != CellState::Queued) continue;
+        cell.state = CellState::Reading;
+
+        // Reading touches the cell's pages of the mapping, so the page faults happen here rather
+        // than on the main thread
+        const SceneCell& range = archive->GetCells()[index];
+        lock.unlock();
+        auto objects = std::make_unique<SceneDescription>();
+        // A range that fails to validate leaves the cell empty rather than being read again
+        archive->ReadObjects(range.firstObject, range.objectCount, *objects);
+        lock.lock();
+
+        if (cell.state == CellState::Reading) {
+            cell.objects = std::move(objects);
+            cell.state = CellState::Ready;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "SceneFormat.hpp"
+#include <entt/entity/entity.hpp>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct StreamingStats {
+    uint32_t cells = 0;
+    uint32_t residentCells = 0;
+    // Queued, being read, or read and waiting for their objects to be created
+    uint32_t loadingCells = 0;
+    uint32_t unloadingCells = 0;
+    // Cells whose objects changed since they were read, kept in memory while unloaded
+    uint32_t editedCells = 0;
+};
+
+// Decides which cells of a partitioned scene should be resident around a position and reads their
+// objects from the scene file on its own IO thread, nearest cell first. Scene creates and removes
+// the objects themselves a little every frame.
+class SceneStreamer {
+public:
+    static constexpr uint32_t NoCell = 0xffffffffu;
+
+    enum class CellState : uint8_t {
+        Unloaded,
+        Queued,
+        Reading,
+        // Read, objects wait to be created
+        Ready,
+        Creating,
+        Resident,
+        Unloading
+    };
+
+    struct Cell {
+        CellState state = CellState::Unloaded;
+        // From the last Update's position to the nearest point of the cell on the XZ plane
+        float distance = 0.0f;
+        // Objects read for the cell and how many of them Scene has created so far
+        std::unique_ptr<SceneDescription> objects;
+        size_t created = 0;
+        // Entities created for the cell, in object order. Removed ones stay listed.
+        std::vector<entt::entity> entities;
+        // Set once an object of the cell changes. The file no longer matches the cell then, so its
+        // objects are kept in edits while it is unloaded.
+        bool edited = false;
+        std::unique_ptr<SceneDescription> edits;
+    };
+
+    explicit SceneStreamer(std::shared_ptr<SceneArchive> archive);
+    ~SceneStreamer();
+
+    SceneStreamer(const SceneStreamer&) = delete;
+    SceneStreamer& operator=(const SceneStreamer&) = delete;
+
+    const SceneArchive& GetArchive() const { return *archive; }
+
+    // Cells start loading once they are within loadRadius and unload once they are farther than
+    // unloadRadius. The gap keeps cells on the boundary from loading and unloading every frame.
+    void SetRadius(float loadRadius, float unloadRadius);
+    float GetLoadRadius() const { return loadRadius; }
+    float GetUnloadRadius() const { return unloadRadius; }
+
+    // Queues the cells that came into range, nearest first, drops reads that are no longer wanted
+    // and starts unloading resident cells that left the range
+    void Update(const glm::vec3& position);
+
+    // Moves the nearest cell whose objects are read to Creating. One cell is created at a time,
+    // GetCreatingCell is NoCell while none is.
+    void BeginCreating();
+    uint32_t GetCreatingCell() const { return creatingCell; }
+    void FinishCreating();
+    // Same for the farthest cell waiting for its objects to be removed. Cells still waiting turn
+    // Resident again if they come back into range.
+    void BeginUnloading();
+    uint32_t GetUnloadingCell() const { return unloadingCell; }
+    void FinishUnloading();
+
+    size_t GetCellCount() const { return cells.size(); }
+    // Cell the file puts the object with this id in, NoCell when it has none
+    uint32_t FindCell(const std::string& id) const;
+    // The IO thread only touches cells while they are Queued or Reading, everything else about a
+    // cell belongs to the main thread
+    Cell& GetCell(uint32_t cell) { return cells[cell]; }
+    const Cell& GetCell(uint32_t cell) const { return cells[cell]; }
+
+    StreamingStats GetStats() const;
+
+private:
+    std::shared_ptr<SceneArchive> archive;
+    std::vector<Cell> cells;
+    // Ids of every object in the file, loaded or not. They point into the archive's mapping.
+    std::unordered_map<std::string_view, uint32_t> idCells;
+    float loadRadius = 100.0f;
+    float unloadRadius = 125.0f;
+    uint32_t creatingCell = NoCell;
+    uint32_t unloadingCell = NoCell;
+
+    // Guards the cells' state and objects and the queue, which the IO thread shares
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    // Queued cells, farthest first so the nearest is taken off the back
+    std::vector<uint32_t> queue;
+    bool stopping = false;
+    std::thread worker;
+
+    void ReadCells();
+};
\ No newline at end of file
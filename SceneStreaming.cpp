@@ -0,0 +1,154 @@
+#include "Scene.hpp"
+#include "SceneStreamer.hpp"
+
+#include <chrono>
+
+// The clock is read once per this many objects created or removed, each takes a few microseconds
+static constexpr size_t BudgetCheckInterval = 32;
+
+void Scene::UpdateStreaming(const glm::vec3& position, double budgetMs) {
+    if (!streamer) return;
+
+    auto start = std::chrono::steady_clock::now();
+    auto overBudget = [start, budgetMs]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs;
+    };
+
+    streamer->Update(position);
+
+    // Removing comes first so the meshes of cells left behind can be evicted before new cells
+    // need the memory
+    while (!overBudget()) {
+        streamer->BeginUnloading();
+        uint32_t index = streamer->GetUnloadingCell();
+        if (index == SceneStreamer::NoCell) break;
+
+        SceneStreamer::Cell& cell = streamer->GetCell(index);
+        if (cell.edited && !cell.edits) {
+            cell.edits = std::make_unique<SceneDescription>();
+            DescribeCell(index, *cell.edits);
+        }
+
+        // Children were created after their parents, so removing from the back never re-parents
+        for (size_t n = 1; !cell.entities.empty() && (n % BudgetCheckInterval != 0 || !overBudget()); ++n) {
+            entt::entity entity = cell.entities.back();
+            cell.entities.pop_back();
+            if (registry.valid(entity)) {
+                DestroyObject(entity);
+            }
+        }
+        if (!cell.entities.empty()) break;
+
+        // A cell edited while it was being removed goes back to what the file has
+        cell.edited = cell.edits != nullptr;
+        streamer->FinishUnloading();
+    }
+
+    while (!overBudget()) {
+        streamer->BeginCreating();
+        uint32_t index = streamer->GetCreatingCell();
+        if (index == SceneStreamer::NoCell) break;
+
+        SceneStreamer::Cell& cell = streamer->GetCell(index);
+        const SceneDescription& objects = *cell.objects;
+        size_t objectCount = objects.GetObjectCount();
+        cell.entities.reserve(objectCount);
+
+        // String indices are per cell, so are the model lookups
+        std::unordered_map<uint32_t, ModelSource> models;
+        for (size_t n = 1; cell.created < objectCount && (n % BudgetCheckInterval != 0 || !overBudget()); ++n) {
+            size_t i = cell.created++;
+
+            // An object added or brought back outside of any cell keeps the id. The cell no
+            // longer matches the file without it.
+            auto existing = names.find(std::string(objects.strings[objects.ids[i]]));
+            if (existing != names.end() && !registry.all_of<CellComponent>(existing->second)) {
+                cell.edited = true;
+                cell.entities.push_back(entt::null);
+                continue;
+            }
+
+            entt::entity entity = InstantiateObject(objects, i, models, activeLoad);
+            registry.emplace<CellComponent>(entity, index);
+
+            uint32_t parent = objects.parents[i];
+            if (parent != SceneDescription::NoParent && registry.valid(cell.entities[parent])) {
+                AttachToParent(entity, cell.entities[parent]);
+            }
+            cell.entities.push_back(entity);
+        }
+        if (cell.created < objectCount) break;
+
+        streamer->FinishCreating();
+    }
+}
+
+void Scene::SetStreamingRadius(float loadRadius, float unloadRadius) {
+    if (streamer) {
+        streamer->SetRadius(loadRadius, unloadRadius);
+    }
+}
+
+StreamingStats Scene::GetStreamingStats() const {
+    return streamer ? streamer->GetStats() : StreamingStats();
+}
+
+void Scene::NoteEdit(entt::entity entity) {
+    if (!streamer) return;
+
+    if (const CellComponent* cell = registry.try_get<CellComponent>(entity)) {
+        streamer->GetCell(cell->cell).edited = true;
+    }
+}
+
+bool Scene::IsCellInRegistry(uint32_t index) const {
+    const SceneStreamer::Cell& cell = streamer->GetCell(index);
+    if (!cell.edited || cell.edits) return false;
+
+    // The cell being removed took its snapshot first if it had been edited by then
+    switch (cell.state) {
+    case SceneStreamer::CellState::Creating:
+    case SceneStreamer::CellState::Resident:
+        return true;
+    case SceneStreamer::CellState::Unloading:
+        return index != streamer->GetUnloadingCell();
+    default:
+        return false;
+    }
+}
+
+bool Scene::IsIdTaken(const std::string& id) const {
+    if (names.find(id) != names.end()) return true;
+    if (!streamer) return false;
+
+    uint32_t index = streamer->FindCell(id);
+    if (index == SceneStreamer::NoCell) return false;
+
+    // Objects of a cell are in names once created, cells that are not come back from the file or
+    // from their edits
+    const SceneStreamer::Cell& cell = streamer->GetCell(index);
+    const SceneDescription* pending = cell.edits.get();
+    size_t first = 0;
+    switch (cell.state) {
+    case SceneStreamer::CellState::Resident:
+        return false;
+    case SceneStreamer::CellState::Unloading:
+        if (index != streamer->GetUnloadingCell()) return false;
+        break;
+    case SceneStreamer::CellState::Creating:
+        pending = cell.objects.get();
+        first = cell.created;
+        break;
+    case SceneStreamer::CellState::Ready:
+        pending = cell.objects.get();
+        break;
+    default:
+        break;
+    }
+    if (!pending) return true;
+
+    for (size_t i = first; i < pending->GetObjectCount(); ++i) {
+        if (pending->strings[pending->ids[i]] == id) return true;
+    }
+    return false;
+}
\ No newline at end of file
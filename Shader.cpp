@@ -2,6 +2,7 @@
 #include <SDL3/SDL.h>
 #include <fstream>
 #include <sstream>
+#include <vector>
 
 Shader::~Shader() {
     Delete();
@@ -29,7 +30,18 @@ bool Shader::CreateFromSource(const char* vertexSource, const char* fragmentSour
 
     GLint success;
     glGetProgramiv(programID, GL_LINK_STATUS, &success);
-    return success == GL_TRUE;
+    if (success != GL_TRUE) {
+        return false;
+    }
+
+    ReflectUniforms();
+
+    GLuint frameBlock = glGetUniformBlockIndex(programID, "FrameData");
+    if (frameBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(programID, frameBlock, FrameDataBinding);
+    }
+
+    return true;
 }
 
 bool Shader::CreateFromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
@@ -70,34 +82,89 @@ void Shader::Delete() {
         glDeleteProgram(programID);
         programID = 0;
     }
+    uniformLocations.clear();
 }
 
 void Shader::SetBool(const std::string& name, bool value) const {
-    glUniform1i(glGetUniformLocation(programID, name.c_str()), (int)value);
+    glUniform1i(GetUniformLocation(HashName(name)), (int)value);
 }
 
 void Shader::SetInt(const std::string& name, int value) const {
-    glUniform1i(glGetUniformLocation(programID, name.c_str()), value);
+    glUniform1i(GetUniformLocation(HashName(name)), value);
 }
 
 void Shader::SetFloat(const std::string& name, float value) const {
-    glUniform1f(glGetUniformLocation(programID, name.c_str()), value);
+    glUniform1f(GetUniformLocation(HashName(name)), value);
 }
 
 void Shader::SetVec2(const std::string& name, const glm::vec2& value) const {
-    glUniform2fv(glGetUniformLocation(programID, name.c_str()), 1, &value[0]);
+    glUniform2fv(GetUniformLocation(HashName(name)), 1, &value[0]);
 }
 
 void Shader::SetVec3(const std::string& name, const glm::vec3& value) const {
-    glUniform3fv(glGetUniformLocation(programID, name.c_str()), 1, &value[0]);
+    glUniform3fv(GetUniformLocation(HashName(name)), 1, &value[0]);
 }
 
 void Shader::SetVec4(const std::string& name, const glm::vec4& value) const {
-    glUniform4fv(glGetUniformLocation(programID, name.c_str()), 1, &value[0]);
+    glUniform4fv(GetUniformLocation(HashName(name)), 1, &value[0]);
 }
 
 void Shader::SetMat4(const std::string& name, const glm::mat4& mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(GetUniformLocation(HashName(name)), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::SetInt(uint32_t nameHash, int value) const {
+    glUniform1i(GetUniformLocation(nameHash), value);
+}
+
+void Shader::SetFloat(uint32_t nameHash, float value) const {
+    glUniform1f(GetUniformLocation(nameHash), value);
+}
+
+void Shader::SetVec3(uint32_t nameHash, const glm::vec3& value) const {
+    glUniform3fv(GetUniformLocation(nameHash), 1, &value[0]);
+}
+
+void Shader::SetVec4(uint32_t nameHash, const glm::vec4& value) const {
+    glUniform4fv(GetUniformLocation(nameHash), 1, &value[0]);
+}
+
+void Shader::SetMat4(uint32_t nameHash, const glm::mat4& mat) const {
+    glUniformMatrix4fv(GetUniformLocation(nameHash), 1, GL_FALSE, &mat[0][0]);
+}
+
+GLint Shader::GetUniformLocation(uint32_t nameHash) const {
+    auto it = uniformLocations.find(nameHash);
+    return (it != uniformLocations.end()) ? it->second : -1;
+}
+
+void Shader::ReflectUniforms() {
+    uniformLocations.clear();
+
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<char> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+
+    for (GLint i = 0; i < uniformCount; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programID, static_cast<GLuint>(i), maxNameLength, &length, &size, &type, nameBuffer.data());
+
+        // Members of uniform blocks have no location and are fed through their buffer instead
+        GLint location = glGetUniformLocation(programID, nameBuffer.data());
+        if (location < 0) continue;
+
+        std::string_view name(nameBuffer.data(), length);
+        if (name.ends_with("[0]")) {
+            name.remove_suffix(3);
+        }
+
+        uniformLocations[HashName(name)] = location;
+    }
 }
 
 GLuint Shader::CompileShader(GLenum type, const char* source) {
@@ -3,10 +3,26 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 class Shader {
 public:
+    // Binding point of the per-frame "FrameData" uniform block, attached to every program at link time
+    static constexpr GLuint FrameDataBinding = 0;
+
+    // FNV-1a, usable at compile time so hot paths can pass precomputed uniform ids
+    static constexpr uint32_t HashName(std::string_view name) {
+        uint32_t hash = 2166136261u;
+        for (char c : name) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
     Shader() = default;
     ~Shader();
 
@@ -24,10 +40,21 @@ public:
     void SetVec4(const std::string& name, const glm::vec4& value) const;
     void SetMat4(const std::string& name, const glm::mat4& mat) const;
 
+    void SetInt(uint32_t nameHash, int value) const;
+    void SetFloat(uint32_t nameHash, float value) const;
+    void SetVec3(uint32_t nameHash, const glm::vec3& value) const;
+    void SetVec4(uint32_t nameHash, const glm::vec4& value) const;
+    void SetMat4(uint32_t nameHash, const glm::mat4& mat) const;
+
+    GLint GetUniformLocation(uint32_t nameHash) const;
+
     GLuint GetID() const { return programID; }
 
 private:
     GLuint programID = 0;
+    std::unordered_map<uint32_t, GLint> uniformLocations;
+
+    void ReflectUniforms();
 
     GLuint CompileShader(GLenum type, const char* source);
     void CheckShaderCompilation(GLuint shader, const std::string& type);
@@ -0,0 +1,39 @@
+#include "StringTable.hpp"
+
+// The deque never moves its elements, so the views used as keys stay valid
+std::deque<std::string> StringTable::strings(1);
+std::unordered_map<std::string_view, StringId> StringTable::ids;
+std::mutex StringTable::mutex;
+
+StringId StringTable::Intern(std::string_view text) {
+    if (text.empty()) return 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = ids.find(text);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    StringId id = static_cast<StringId>(strings.size());
+    strings.emplace_back(text);
+    ids.emplace(strings.back(), id);
+    return id;
+}
+
+StringId StringTable::Find(std::string_view text) {
+    if (text.empty()) return 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = ids.find(text);
+    return (it != ids.end()) ? it->second : 0;
+}
+
+const std::string& StringTable::GetString(StringId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return id < strings.size() ? strings[id] : strings[0];
+}
+
+size_t StringTable::Size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return strings.size();
+}
\ No newline at end of file
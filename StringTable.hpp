@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Dense id of an interned string. Ids are never reused, 0 is the empty string.
+using StringId = uint32_t;
+
+// Interns strings such as model paths once so they can be stored, compared and hashed as ids.
+// Interned strings live until the program exits. Safe to use from any thread.
+class StringTable {
+public:
+    static StringId Intern(std::string_view text);
+
+    // Returns 0 for the empty string and for strings that were never interned
+    static StringId Find(std::string_view text);
+
+    static const std::string& GetString(StringId id);
+    static size_t Size();
+
+private:
+    static std::deque<std::string> strings;
+    static std::unordered_map<std::string_view, StringId> ids;
+    static std::mutex mutex;
+};
\ No newline at end of file
@@ -4,8 +4,11 @@
 #include <imterm/terminal_helpers.hpp>
 
 #include "Scene.hpp"
+#include "ResourceManager.hpp"
 #include "Utils.hpp"
 
+#include <cstdio>
+
 class TerminalHelper : public ImTerm::basic_terminal_helper<TerminalHelper, void> {
 public:
     static Scene* scene;
@@ -64,6 +67,48 @@ public:
         arg.term.add_message(std::move(msg));
     }
 
+    static void setparent(argument_type& arg) {
+        ImTerm::message msg;
+        if (arg.command_line.size() < 2) {
+            msg.value = std::move("Syntax Error! \nUsage: setparent <id/name> [parent id/name]");
+        }
+        else if (scene != NULL && scene->SetObjectParent(arg.command_line[1], arg.command_line.size() > 2 ? arg.command_line[2] : "")) {
+            msg.value = std::move("Parent set succesfully!");
+        }
+        else {
+            msg.value = std::move("Failed to set parent!");
+        }
+
+        msg.color_beg = msg.color_end = 0;
+        arg.term.add_message(std::move(msg));
+    }
+
+    static void undo(argument_type& arg) {
+        ImTerm::message msg;
+        if (scene != NULL && scene->Undo()) {
+            msg.value = std::move("Edit undone");
+        }
+        else {
+            msg.value = std::move("Nothing to undo!");
+        }
+
+        msg.color_beg = msg.color_end = 0;
+        arg.term.add_message(std::move(msg));
+    }
+
+    static void redo(argument_type& arg) {
+        ImTerm::message msg;
+        if (scene != NULL && scene->Redo()) {
+            msg.value = std::move("Edit redone");
+        }
+        else {
+            msg.value = std::move("Nothing to redo!");
+        }
+
+        msg.color_beg = msg.color_end = 0;
+        arg.term.add_message(std::move(msg));
+    }
+
     static void bgcolor(argument_type& arg) {
         ImTerm::message msg;
         if (arg.command_line.size() < 4) {
@@ -109,11 +154,26 @@ public:
         if (arg.command_line.size() < 2) {
             msg.value = std::move("Syntax Error! \nUsage: savescene <filename>");
         }
-        else if (scene->SaveToFile(arg.command_line[1].c_str())) {
-            msg.value = std::move("Scene saved succesfully!");
-        }
         else {
-            msg.value = std::move("Error ocurred while saving scene!");
+            // The terminal outlives the scene's saves, ProcessSaves reports back on this thread
+            ImTerm::terminal<TerminalHelper>& term = arg.term;
+            SaveHandle handle = scene->SaveToFileAsync(arg.command_line[1], [&term](const SaveHandle& save) {
+                ImTerm::message done;
+                if (save.Succeeded()) {
+                    char line[128];
+                    snprintf(line, sizeof(line), "Scene saved succesfully, written in %.1f ms", save.GetWriteMs());
+                    done.value = line;
+                }
+                else {
+                    done.value = std::move("Error ocurred while saving scene!");
+                }
+                done.color_beg = done.color_end = 0;
+                term.add_message(std::move(done));
+            });
+
+            char line[128];
+            snprintf(line, sizeof(line), "Saving %u objects in the background, snapshot took %.1f ms", handle.GetObjectCount(), handle.GetSnapshotMs());
+            msg.value = line;
         }
 
         msg.color_beg = msg.color_end = 0;
@@ -126,8 +186,13 @@ public:
         if (arg.command_line.size() < 2) {
             msg.value = std::move("Syntax Error! \nUsage: loadscene <filename>");
         }
-        else if (scene->LoadFromFile(arg.command_line[1].c_str())) {
-            msg.value = std::move("Scene loaded succesfully!");
+        else if (LoadHandle handle = scene->LoadFromFile(arg.command_line[1].c_str())) {
+            if (scene->IsStreaming()) {
+                msg.value = std::move("Scene opened, streaming its cells around the camera");
+            }
+            else {
+                msg.value = "Scene opened, loading " + std::to_string(handle.GetTotal()) + " objects in the background";
+            }
         }
         else {
             msg.value = std::move("Error ocurred while loading scene!");
@@ -137,18 +202,78 @@ public:
         arg.term.add_message(std::move(msg));
     }
 
+    static void cellsize(argument_type& arg) {
+        ImTerm::message msg;
+        if (arg.command_line.size() < 2) {
+            msg.value = "Cell size: " + std::to_string(scene->GetCellSize()) + "\nUsage: cellsize <size>, 0 saves without cells";
+        }
+        else {
+            scene->SetCellSize(static_cast<float>(atof(arg.command_line[1].c_str())));
+            msg.value = std::move("Cell size set, it is used from the next save on!");
+        }
+
+        msg.color_beg = msg.color_end = 0;
+        arg.term.add_message(std::move(msg));
+    }
+
+    static void streamradius(argument_type& arg) {
+        ImTerm::message msg;
+        if (arg.command_line.size() < 3) {
+            msg.value = std::move("Syntax Error! \nUsage: streamradius <load radius> <unload radius>");
+        }
+        else if (scene->IsStreaming()) {
+            scene->SetStreamingRadius(static_cast<float>(atof(arg.command_line[1].c_str())), static_cast<float>(atof(arg.command_line[2].c_str())));
+            msg.value = std::move("Streaming radius set succesfully!");
+        }
+        else {
+            msg.value = std::move("The scene is not streamed!");
+        }
+
+        msg.color_beg = msg.color_end = 0;
+        arg.term.add_message(std::move(msg));
+    }
+
+    static void meshstats(argument_type& arg) {
+        if (ResourceManager::GetStats().meshes == 0) {
+            ImTerm::message msg;
+            msg.value = std::move("No meshes loaded!");
+            msg.color_beg = msg.color_end = 0;
+            arg.term.add_message(std::move(msg));
+            return;
+        }
+
+        ResourceManager::ForEachMesh([&arg](MeshHandle handle, const MeshPrimitive& mesh) {
+            const MeshCacheStats& stats = mesh.cacheStats;
+            char line[128];
+            snprintf(line, sizeof(line), ": %zu tris, %u lods, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+                mesh.indexCount / 3, mesh.lodCount, stats.acmrBefore, stats.acmrAfter, stats.atvrBefore, stats.atvrAfter);
+
+            ImTerm::message msg;
+            msg.value = ResourceManager::GetMeshName(handle) + line;
+            msg.color_beg = msg.color_end = 0;
+            arg.term.add_message(std::move(msg));
+        });
+    }
+
     TerminalHelper() {
         add_command_({ "clear", "clear the screen", clear, no_completion });
         add_command_({ "echo", "echoes your text", echo, no_completion });
         
         add_command_({ "addobject", "adds object to scene", addobject, no_completion });
         add_command_({ "rmobject", "removes object from scene", rmobject, no_completion });
+        add_command_({ "setparent", "attaches object to a parent, no parent detaches it", setparent, no_completion });
+        add_command_({ "undo", "takes back the last edit", undo, no_completion });
+        add_command_({ "redo", "redoes the last undone edit", redo, no_completion });
 
         add_command_({ "bgcolor", "change color of renderer background", bgcolor, no_completion });
         add_command_({ "alias", "adds path alias", alias, no_completion });
 
         add_command_({ "savescene", "save scene to file", savescene, no_completion });
         add_command_({ "loadscene", "load scene from file", loadscene, no_completion });
+        add_command_({ "cellsize", "size of the streaming cells scenes are saved with", cellsize, no_completion });
+        add_command_({ "streamradius", "distances cells stream in and out at", streamradius, no_completion });
+
+        add_command_({ "meshstats", "show vertex cache stats of loaded meshes", meshstats, no_completion });
     }
 };
 
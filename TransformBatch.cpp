@@ -0,0 +1,126 @@
+#include "TransformBatch.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+void TransformBatch::Clear() {
+    positionX.clear();
+    positionY.clear();
+    positionZ.clear();
+    rotationX.clear();
+    rotationY.clear();
+    rotationZ.clear();
+    rotationW.clear();
+    scaleX.clear();
+    scaleY.clear();
+    scaleZ.clear();
+    count = 0;
+}
+
+void TransformBatch::Add(const TransformComponent& transform) {
+    if (count % 4 == 0) {
+        positionX.resize(count + 4, 0.0f);
+        positionY.resize(count + 4, 0.0f);
+        positionZ.resize(count + 4, 0.0f);
+        rotationX.resize(count + 4, 0.0f);
+        rotationY.resize(count + 4, 0.0f);
+        rotationZ.resize(count + 4, 0.0f);
+        rotationW.resize(count + 4, 1.0f);
+        scaleX.resize(count + 4, 1.0f);
+        scaleY.resize(count + 4, 1.0f);
+        scaleZ.resize(count + 4, 1.0f);
+    }
+
+    // Quaternion of rotate(x) * rotate(y) * rotate(z), the order the euler angles are applied in
+    float cx = std::cos(transform.rotation.x * 0.5f), sx = std::sin(transform.rotation.x * 0.5f);
+    float cy = std::cos(transform.rotation.y * 0.5f), sy = std::sin(transform.rotation.y * 0.5f);
+    float cz = std::cos(transform.rotation.z * 0.5f), sz = std::sin(transform.rotation.z * 0.5f);
+
+    positionX[count] = transform.position.x;
+    positionY[count] = transform.position.y;
+    positionZ[count] = transform.position.z;
+    rotationX[count] = sx * cy * cz + cx * sy * sz;
+    rotationY[count] = cx * sy * cz - sx * cy * sz;
+    rotationZ[count] = cx * cy * sz + sx * sy * cz;
+    rotationW[count] = cx * cy * cz - sx * sy * sz;
+    scaleX[count] = transform.scale.x;
+    scaleY[count] = transform.scale.y;
+    scaleZ[count] = transform.scale.z;
+    count++;
+}
+
+void TransformBatch::ComputeMatrices(std::vector<glm::mat4>& matrices) const {
+    matrices.resize(count);
+
+#ifdef TRANSFORM_USE_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 x = _mm_loadu_ps(&rotationX[i]);
+        __m128 y = _mm_loadu_ps(&rotationY[i]);
+        __m128 z = _mm_loadu_ps(&rotationZ[i]);
+        __m128 w = _mm_loadu_ps(&rotationW[i]);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        __m128 sx = _mm_loadu_ps(&scaleX[i]);
+        __m128 sy = _mm_loadu_ps(&scaleY[i]);
+        __m128 sz = _mm_loadu_ps(&scaleZ[i]);
+
+        // Each register holds one matrix element for four transforms
+        __m128 columns[4][4] = {
+            {
+                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+                zero
+            },
+            {
+                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+                zero
+            },
+            {
+                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+                zero
+            },
+            {
+                _mm_loadu_ps(&positionX[i]),
+                _mm_loadu_ps(&positionY[i]),
+                _mm_loadu_ps(&positionZ[i]),
+                one
+            }
+        };
+
+        size_t lanes = (count - i) < 4 ? (count - i) : 4;
+        for (int c = 0; c < 4; ++c) {
+            // Afterwards columns[c][lane] is column c of that lane's matrix
+            _MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                _mm_storeu_ps(&matrices[i + lane][c][0], columns[c][lane]);
+            }
+        }
+    }
+#else
+    for (size_t i = 0; i < count; ++i) {
+        float x = rotationX[i], y = rotationY[i], z = rotationZ[i], w = rotationW[i];
+        glm::mat4& m = matrices[i];
+
+        m[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f) * scaleX[i];
+        m[1] = glm::vec4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f) * scaleY[i];
+        m[2] = glm::vec4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f) * scaleZ[i];
+        m[3] = glm::vec4(positionX[i], positionY[i], positionZ[i], 1.0f);
+    }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "SceneComponents.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+// Packed structure-of-arrays of object transforms waiting for their world matrix, padded so the
+// update kernel can always consume four lanes at a time. Rotations are stored as quaternions.
+struct TransformBatch {
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+    std::vector<float> rotationX;
+    std::vector<float> rotationY;
+    std::vector<float> rotationZ;
+    std::vector<float> rotationW;
+    std::vector<float> scaleX;
+    std::vector<float> scaleY;
+    std::vector<float> scaleZ;
+
+    void Clear();
+    void Add(const TransformComponent& transform);
+    size_t Size() const { return count; }
+
+    // Writes translate * rotate(x, y, z) * scale for every transform, in the order they were added
+    void ComputeMatrices(std::vector<glm::mat4>& matrices) const;
+
+private:
+    size_t count = 0;
+};
\ No newline at end of file
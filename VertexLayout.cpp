@@ -0,0 +1,21 @@
+#include "VertexLayout.hpp"
+
+void VertexLayout::Apply() const {
+    for (const VertexAttribute& attribute : attributes) {
+        glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized,
+            static_cast<GLsizei>(stride), reinterpret_cast<const void*>(static_cast<uintptr_t>(attribute.offset)));
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
+
+const VertexLayout& VertexLayout::Compact() {
+    static const VertexLayout layout = {
+        16,
+        {
+            { 0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 0 },
+            { 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 8 },
+            { 2, 2, GL_HALF_FLOAT, GL_FALSE, 12 },
+        }
+    };
+    return layout;
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+struct VertexAttribute {
+    GLuint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    uint32_t offset;
+};
+
+// Describes one interleaved vertex buffer so attribute setup is not hard-coded per format
+struct VertexLayout {
+    uint32_t stride = 0;
+    std::vector<VertexAttribute> attributes;
+
+    // Points the attributes at the GL_ARRAY_BUFFER bound to the current VAO
+    void Apply() const;
+
+    // 16 bytes: position as three unorm16 relative to the mesh bounds plus padding,
+    // normal as snorm 10:10:10:2 and uv as two half floats
+    static const VertexLayout& Compact();
+};
\ No newline at end of file
@@ -21,7 +21,7 @@ Window::Window(std::string title, int w, int h, SDL_WindowFlags flags)
     }
 
     SDL_SetHint(SDL_HINT_OPENGL_ES_DRIVER, "0"); // Desktop OpenGL
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
@@ -36,6 +36,13 @@ Window::Window(std::string title, int w, int h, SDL_WindowFlags flags)
     }
 
     gl_context = SDL_GL_CreateContext(sdl_window);
+    if (!gl_context) {
+        // 4.3 is only needed for multi-draw indirect, the renderer falls back to per-draw submission on 3.3
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+        gl_context = SDL_GL_CreateContext(sdl_window);
+    }
+
     if (!gl_context) {
         SDL_Log("Failed to create OpenGL context: %s", SDL_GetError());
         SDL_DestroyWindow(sdl_window);